@@ -134,6 +134,7 @@ SOURCES += \
     backend/nvhttp.cpp \
     backend/nvpairingmanager.cpp \
     backend/computermanager.cpp \
+    backend/computerpoller.cpp \
     backend/boxartmanager.cpp \
     backend/richpresencemanager.cpp \
     cli/commandlineparser.cpp \
@@ -150,19 +151,24 @@ SOURCES += \
     streaming/input/reltouch.cpp \
     streaming/session.cpp \
     streaming/audio/audio.cpp \
+    streaming/audio/jitterbuffer.cpp \
     streaming/audio/renderers/sdlaud.cpp \
     gui/computermodel.cpp \
     gui/appmodel.cpp \
+    gui/boxartimageprovider.cpp \
     streaming/streamutils.cpp \
     backend/autoupdatechecker.cpp \
     path.cpp \
     settings/mappingmanager.cpp \
     gui/sdlgamepadkeynavigation.cpp \
     streaming/video/overlaymanager.cpp \
+    streaming/video/frametracer.cpp \
+    streaming/video/latencyhistogram.cpp \
     backend/systemproperties.cpp \
     vigem/vigemclient.cpp \
     vigem/vigemhintwidget.cpp \
     vigem/vigemkeymapper.cpp \
+    vigem/vigemreportsender.cpp \
     vigem/vigemwidget.cpp \
     wm.cpp
 
@@ -178,6 +184,7 @@ HEADERS += \
     backend/nvhttp.h \
     backend/nvpairingmanager.h \
     backend/computermanager.h \
+    backend/computerpoller.h \
     backend/boxartmanager.h \
     backend/richpresencemanager.h \
     cli/commandlineparser.h \
@@ -186,10 +193,12 @@ HEADERS += \
     settings/streamingpreferences.h \
     streaming/input/input.h \
     streaming/session.h \
+    streaming/audio/jitterbuffer.h \
     streaming/audio/renderers/renderer.h \
     streaming/audio/renderers/sdl.h \
     gui/computermodel.h \
     gui/appmodel.h \
+    gui/boxartimageprovider.h \
     streaming/video/decoder.h \
     streaming/streamutils.h \
     backend/autoupdatechecker.h \
@@ -197,11 +206,14 @@ HEADERS += \
     settings/mappingmanager.h \
     gui/sdlgamepadkeynavigation.h \
     streaming/video/overlaymanager.h \
+    streaming/video/frametracer.h \
+    streaming/video/latencyhistogram.h \
     backend/systemproperties.h \
     vigem/vigem_defs.h \
     vigem/vigemclient.h \
     vigem/vigemhintwidget.h \
     vigem/vigemkeymapper.h \
+    vigem/vigemreportsender.h \
     vigem/vigemwidget.h \
     vigemwidget.h
 
@@ -212,16 +224,23 @@ ffmpeg {
     DEFINES += HAVE_FFMPEG
     SOURCES += \
         streaming/video/ffmpeg.cpp \
+        streaming/video/decoderprobecache.cpp \
         streaming/video/ffmpeg-renderers/sdlvid.cpp \
         streaming/video/ffmpeg-renderers/pacer/pacer.cpp \
         streaming/video/ffmpeg-renderers/pacer/nullthreadedvsyncsource.cpp
 
     HEADERS += \
         streaming/video/ffmpeg.h \
+        streaming/video/decoderprobecache.h \
         streaming/video/ffmpeg-renderers/renderer.h \
         streaming/video/ffmpeg-renderers/sdlvid.h \
         streaming/video/ffmpeg-renderers/pacer/pacer.h \
         streaming/video/ffmpeg-renderers/pacer/nullthreadedvsyncsource.h
+
+    linux {
+        SOURCES += streaming/video/ffmpeg-renderers/pacer/timervsyncsource.cpp
+        HEADERS += streaming/video/ffmpeg-renderers/pacer/timervsyncsource.h
+    }
 }
 libva {
     message(VAAPI renderer selected)
@@ -267,8 +286,12 @@ libdrm {
     message(DRM renderer selected)
 
     DEFINES += HAVE_DRM
-    SOURCES += streaming/video/ffmpeg-renderers/drm.cpp
-    HEADERS += streaming/video/ffmpeg-renderers/drm.h
+    SOURCES += \
+        streaming/video/ffmpeg-renderers/drm.cpp \
+        streaming/video/ffmpeg-renderers/pacer/drmvsyncsource.cpp
+    HEADERS += \
+        streaming/video/ffmpeg-renderers/drm.h \
+        streaming/video/ffmpeg-renderers/pacer/drmvsyncsource.h
 
     linux {
         message(Master hooks enabled)
@@ -290,8 +313,11 @@ config_EGL {
     DEFINES += HAVE_EGL
     SOURCES += \
         streaming/video/ffmpeg-renderers/eglvid.cpp \
-        streaming/video/ffmpeg-renderers/egl_extensions.cpp
-    HEADERS += streaming/video/ffmpeg-renderers/eglvid.h
+        streaming/video/ffmpeg-renderers/egl_extensions.cpp \
+        streaming/video/ffmpeg-renderers/eglimagecache.cpp
+    HEADERS += \
+        streaming/video/ffmpeg-renderers/eglvid.h \
+        streaming/video/ffmpeg-renderers/eglimagecache.h
 }
 config_SL {
     message(Steam Link build configuration selected)
@@ -1,13 +1,32 @@
 #include "boxartmanager.h"
 #include "../path.h"
 
+#include <QBuffer>
+#include <QCache>
+#include <QGuiApplication>
 #include <QImageReader>
-#include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtMath>
+
+// Size of the box art in AppView.qml
+#define THUMBNAIL_WIDTH 200
+#define THUMBNAIL_HEIGHT 267
+
+// Enough for several hundred apps at 1x scaling, or about 75 on a 2x display
+#define THUMBNAIL_CACHE_BUDGET_KB (64 * 1024)
+
+// The thumbnail cache is shared by every AppView, so going back to an
+// app grid or switching between hosts doesn't decode anything again.
+static QMutex s_ThumbnailCacheLock;
+static QCache<QString, BoxArtManager::Thumbnail> s_ThumbnailCache(THUMBNAIL_CACHE_BUDGET_KB);
 
 BoxArtManager::BoxArtManager(QObject *parent) :
     QObject(parent),
     m_BoxArtDir(Path::getBoxArtCacheDir()),
-    m_ThreadPool(this)
+    m_ThreadPool(this),
+    m_ThumbnailSize(getThumbnailSize())
 {
     // 4 is a good balance between fast loading for large
     // app grids and not crushing GFE with tons of requests
@@ -36,51 +55,149 @@ BoxArtManager::getFilePathForBoxArt(NvComputer* computer, int appId)
     return dir.filePath(QString::number(appId) + ".png");
 }
 
-class NetworkBoxArtLoadTask : public QObject, public QRunnable
+QString
+BoxArtManager::getThumbnailId(NvComputer* computer, int appId)
+{
+    // This is also the path of the box art within the cache directory
+    return computer->uuid + "/" + QString::number(appId);
+}
+
+QSize BoxArtManager::getThumbnailSize()
+{
+    // Decode at the resolution of the densest screen, so the grid
+    // never has to scale box art up.
+    qreal dpr = qApp->devicePixelRatio();
+    return QSize(qCeil(THUMBNAIL_WIDTH * dpr), qCeil(THUMBNAIL_HEIGHT * dpr));
+}
+
+QImage BoxArtManager::insertThumbnail(const QString& id, const QImage& image, QSize thumbnailSize, QSize* originalSize)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    Thumbnail* thumbnail = new Thumbnail();
+    thumbnail->originalSize = image.size();
+
+    // GFE's box art is 628x888, which is several times larger than it is drawn
+    if (image.width() > thumbnailSize.width() || image.height() > thumbnailSize.height()) {
+        thumbnail->image = image.scaled(thumbnailSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    else {
+        thumbnail->image = image;
+    }
+
+    // This is the format the scene graph uploads without converting
+    thumbnail->image = thumbnail->image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    if (originalSize != nullptr) {
+        *originalSize = thumbnail->originalSize;
+    }
+
+    QImage thumbnailImage = thumbnail->image;
+    int costKb = qMax(1, thumbnailImage.bytesPerLine() * thumbnailImage.height() / 1024);
+
+    QMutexLocker lock(&s_ThumbnailCacheLock);
+    s_ThumbnailCache.insert(id, thumbnail, costKb);
+    return thumbnailImage;
+}
+
+QImage BoxArtManager::loadThumbnail(const QString& id, QSize thumbnailSize, QSize* originalSize)
+{
+    {
+        QMutexLocker lock(&s_ThumbnailCacheLock);
+        Thumbnail* thumbnail = s_ThumbnailCache.object(id);
+        if (thumbnail != nullptr) {
+            if (originalSize != nullptr) {
+                *originalSize = thumbnail->originalSize;
+            }
+            return thumbnail->image;
+        }
+    }
+
+    // IDs only come from our own URLs, but don't let one escape the cache directory
+    if (id.contains("..")) {
+        return QImage();
+    }
+
+    QImage image = QImageReader(Path::getBoxArtCacheDir() + "/" + id + ".png").read();
+    return insertThumbnail(id, image, thumbnailSize, originalSize);
+}
+
+QSize BoxArtManager::getBoxArtSize(NvComputer* computer, int appId)
+{
+    QMutexLocker lock(&s_ThumbnailCacheLock);
+    Thumbnail* thumbnail = s_ThumbnailCache.object(getThumbnailId(computer, appId));
+    return thumbnail != nullptr ? thumbnail->originalSize : QSize();
+}
+
+class BoxArtLoadTask : public QObject, public QRunnable
 {
     Q_OBJECT
 
 public:
-    NetworkBoxArtLoadTask(BoxArtManager* boxArtManager, NvComputer* computer, NvApp& app)
+    BoxArtLoadTask(BoxArtManager* boxArtManager, NvComputer* computer, NvApp& app, bool fetch)
         : m_Bam(boxArtManager),
           m_Computer(computer),
-          m_App(app)
+          m_App(app),
+          m_Fetch(fetch),
+          m_ThumbnailId(BoxArtManager::getThumbnailId(computer, app.id)),
+          m_ThumbnailSize(boxArtManager->m_ThumbnailSize)
     {
-        connect(this, &NetworkBoxArtLoadTask::boxArtFetchCompleted,
+        connect(this, &BoxArtLoadTask::boxArtLoadCompleted,
                 boxArtManager, &BoxArtManager::handleBoxArtLoadComplete);
     }
 
 signals:
-    void boxArtFetchCompleted(NvComputer* computer, NvApp app, QUrl image);
+    void boxArtLoadCompleted(NvComputer* computer, NvApp app, QUrl image);
 
 private:
     void run()
     {
-        QUrl image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
-        if (image.isEmpty()) {
-            // Give it another shot if it fails once
-            image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
+        if (m_Fetch) {
+            if (!m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id)) {
+                // Give it another shot if it fails once
+                m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
+            }
+        }
+
+        QUrl image;
+        if (!BoxArtManager::loadThumbnail(m_ThumbnailId, m_ThumbnailSize, nullptr).isNull()) {
+            image = QUrl("image://boxart/" + m_ThumbnailId);
         }
-        emit boxArtFetchCompleted(m_Computer, m_App, image);
+        emit boxArtLoadCompleted(m_Computer, m_App, image);
     }
 
     BoxArtManager* m_Bam;
     NvComputer* m_Computer;
     NvApp m_App;
+    bool m_Fetch;
+    QString m_ThumbnailId;
+    QSize m_ThumbnailSize;
 };
 
 QUrl BoxArtManager::loadBoxArt(NvComputer* computer, NvApp& app)
 {
-    // Try to open the cached file if it exists and contains data
-    QFile cacheFile(getFilePathForBoxArt(computer, app.id));
-    if (cacheFile.exists() && cacheFile.size() > 0) {
-        return QUrl::fromLocalFile(cacheFile.fileName());
+    QString thumbnailId = getThumbnailId(computer, app.id);
+
+    // If the thumbnail is already decoded, QML can have it right away
+    if (getBoxArtSize(computer, app.id).isValid()) {
+        return QUrl("image://boxart/" + thumbnailId);
     }
 
-    // If we get here, we need to fetch asynchronously.
-    // Kick off a worker on our thread pool to do just that.
-    NetworkBoxArtLoadTask* netLoadTask = new NetworkBoxArtLoadTask(this, computer, app);
-    m_ThreadPool.start(netLoadTask);
+    // Otherwise we need to decode or fetch it asynchronously, so the
+    // GUI thread never waits on the disk or the network. The grid view
+    // asks for rows just outside of the visible area too, so by the time
+    // they are scrolled into view they're usually already decoded.
+    if (!m_PendingLoads.contains(thumbnailId)) {
+        QFile cacheFile(getFilePathForBoxArt(computer, app.id));
+        bool fetch = !cacheFile.exists() || cacheFile.size() == 0;
+
+        m_PendingLoads.insert(thumbnailId);
+
+        // Decoding from disk is quick, so don't queue it behind network fetches
+        m_ThreadPool.start(new BoxArtLoadTask(this, computer, app, fetch), fetch ? 0 : 1);
+    }
 
     // Return the placeholder then we can notify the caller
     // later when the real image is ready.
@@ -95,37 +212,51 @@ void BoxArtManager::deleteBoxArt(NvComputer* computer)
     if (dir.cd(computer->uuid)) {
         dir.removeRecursively();
     }
+
+    // And any thumbnails we decoded from it
+    QMutexLocker lock(&s_ThumbnailCacheLock);
+    for (const QString& id : s_ThumbnailCache.keys()) {
+        if (id.startsWith(computer->uuid + "/")) {
+            s_ThumbnailCache.remove(id);
+        }
+    }
 }
 
 void BoxArtManager::handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image)
 {
+    m_PendingLoads.remove(getThumbnailId(computer, app.id));
+
     if (!image.isEmpty()) {
         emit boxArtLoadComplete(computer, app, image);
     }
 }
 
-QUrl BoxArtManager::loadBoxArtFromNetwork(NvComputer* computer, int appId)
+bool BoxArtManager::loadBoxArtFromNetwork(NvComputer* computer, int appId)
 {
     NvHTTP http(computer);
 
     QString cachePath = getFilePathForBoxArt(computer, appId);
-    QImage image;
+    QByteArray imageData;
     try {
-        image = http.getBoxArt(appId);
+        imageData = http.getBoxArt(appId);
     } catch (...) {}
 
-    // Cache the box art on disk if it loaded
-    if (!image.isNull()) {
-        if (image.save(cachePath)) {
-            return QUrl::fromLocalFile(cachePath);
-        }
-        else {
-            // A failed save() may leave a zero byte file. Make sure that's removed.
-            QFile(cachePath).remove();
-        }
+    // Make sure it's actually an image before we cache it
+    QBuffer imageBuffer(&imageData);
+    if (imageData.isEmpty() || !QImageReader(&imageBuffer).canRead()) {
+        return false;
+    }
+
+    // Store the image exactly as the host sent it. Re-encoding it as PNG
+    // is much slower than decoding it, and the result is no faster to load.
+    QSaveFile cacheFile(cachePath);
+    if (!cacheFile.open(QIODevice::WriteOnly) ||
+            cacheFile.write(imageData) != imageData.size() ||
+            !cacheFile.commit()) {
+        return false;
     }
 
-    return QUrl();
+    return true;
 }
 
 #include "boxartmanager.moc"
@@ -3,6 +3,7 @@
 #include "computermanager.h"
 #include <QDir>
 #include <QImage>
+#include <QSet>
 #include <QThreadPool>
 #include <QRunnable>
 
@@ -10,18 +11,43 @@ class BoxArtManager : public QObject
 {
     Q_OBJECT
 
-    friend class NetworkBoxArtLoadTask;
+    friend class BoxArtLoadTask;
 
 public:
     explicit BoxArtManager(QObject *parent = nullptr);
 
+    // Returns an image://boxart URL once the thumbnail is decoded,
+    // or a placeholder while it is loaded in the background.
     QUrl
     loadBoxArt(NvComputer* computer, NvApp& app);
 
+    // Returns the size of the box art before it was scaled down,
+    // or an invalid size if its thumbnail isn't loaded.
+    static
+    QSize
+    getBoxArtSize(NvComputer* computer, int appId);
+
+    // Returns the thumbnail for an image://boxart ID, decoding it
+    // from the disk cache if it is not in memory. Thread-safe.
+    static
+    QImage
+    loadThumbnail(const QString& id, QSize thumbnailSize, QSize* originalSize);
+
+    // Returns the size thumbnails are decoded at for the app grid.
+    // Must be called on the GUI thread.
+    static
+    QSize
+    getThumbnailSize();
+
     static
     void
     deleteBoxArt(NvComputer* computer);
 
+    struct Thumbnail {
+        QImage image;
+        QSize originalSize;
+    };
+
 signals:
     void
     boxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
@@ -33,12 +59,22 @@ private slots:
     handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
 
 private:
-    QUrl
+    bool
     loadBoxArtFromNetwork(NvComputer* computer, int appId);
 
     QString
     getFilePathForBoxArt(NvComputer* computer, int appId);
 
+    static
+    QString
+    getThumbnailId(NvComputer* computer, int appId);
+
+    static
+    QImage
+    insertThumbnail(const QString& id, const QImage& image, QSize thumbnailSize, QSize* originalSize);
+
     QDir m_BoxArtDir;
     QThreadPool m_ThreadPool;
+    QSize m_ThumbnailSize;
+    QSet<QString> m_PendingLoads;
 };
@@ -0,0 +1,432 @@
+#include "computerpoller.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QNetworkProxy>
+#include <QReadLocker>
+#include <QThread>
+
+#define POLL_INTERVAL_MS 3000
+#define MAX_OFFLINE_POLL_INTERVAL_MS 15000
+#define SERVERINFO_TIMEOUT_MS 2000
+#define APPLIST_TIMEOUT_MS 5000
+#define TRIES_BEFORE_OFFLINING 2
+#define POLLS_PER_APPLIST_FETCH 10
+
+ComputerPoller::ComputerPoller(QObject* parent)
+    : QObject(parent)
+{
+    // Never use a proxy server
+    m_Nam.setProxy(QNetworkProxy(QNetworkProxy::NoProxy));
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0) && QT_VERSION < QT_VERSION_CHECK(5, 15, 1) && !defined(QT_NO_BEARERMANAGEMENT)
+    // HACK: Set network accessibility to work around QTBUG-80947 (introduced in Qt 5.14.0 and fixed in Qt 5.15.1)
+    QT_WARNING_PUSH
+    QT_WARNING_DISABLE_DEPRECATED
+    m_Nam.setNetworkAccessible(QNetworkAccessManager::Accessible);
+    QT_WARNING_POP
+#endif
+}
+
+ComputerPoller::~ComputerPoller()
+{
+    stopPolling();
+}
+
+void ComputerPoller::startPollingComputer(NvComputer* computer)
+{
+    // Callers may hold ComputerManager's lock on a worker thread,
+    // so the computer is picked up later on our own thread.
+    QMutexLocker lock(&m_PendingLock);
+
+    m_PendingComputers.append(computer);
+    if (m_PendingComputers.count() == 1) {
+        QMetaObject::invokeMethod(this, "handlePendingComputers", Qt::QueuedConnection);
+    }
+}
+
+void ComputerPoller::handlePendingComputers()
+{
+    QList<NvComputer*> computers;
+
+    {
+        QMutexLocker lock(&m_PendingLock);
+        computers.swap(m_PendingComputers);
+    }
+
+    for (NvComputer* computer : computers) {
+        PollingHost* host = m_Hosts.value(computer->uuid);
+        if (host == nullptr) {
+            host = new PollingHost();
+            host->computer = computer;
+            host->timer = new QTimer(this);
+            host->timer->setSingleShot(true);
+            connect(host->timer, &QTimer::timeout, this, [this, host]() { startPoll(host); });
+            host->pendingAddresses = 0;
+            host->failedPolls = 0;
+            host->offlineIntervalMs = POLL_INTERVAL_MS;
+
+            // Always fetch the applist the first time
+            host->pollsSinceLastAppListFetch = POLLS_PER_APPLIST_FETCH;
+            host->wasOnline = false;
+
+            m_Hosts[computer->uuid] = host;
+        }
+
+        // Poll right away, since the host may have just come back
+        host->offlineIntervalMs = POLL_INTERVAL_MS;
+        if (host->replies.isEmpty()) {
+            host->timer->stop();
+            startPoll(host);
+        }
+    }
+}
+
+void ComputerPoller::stopPollingComputer(NvComputer* computer)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    {
+        QMutexLocker lock(&m_PendingLock);
+        m_PendingComputers.removeAll(computer);
+    }
+
+    PollingHost* host = m_Hosts.take(computer->uuid);
+    if (host != nullptr) {
+        abortReplies(host);
+        delete host->timer;
+        delete host;
+    }
+}
+
+void ComputerPoller::stopPolling()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    {
+        QMutexLocker lock(&m_PendingLock);
+        m_PendingComputers.clear();
+    }
+
+    for (PollingHost* host : m_Hosts) {
+        abortReplies(host);
+        delete host->timer;
+        delete host;
+    }
+    m_Hosts.clear();
+}
+
+void ComputerPoller::startPoll(PollingHost* host)
+{
+    QVector<NvAddress> addresses;
+    uint16_t httpsPort;
+    QSslCertificate serverCert;
+
+    {
+        QReadLocker lock(&host->computer->lock);
+
+        addresses = host->computer->uniqueAddresses();
+        httpsPort = host->computer->activeHttpsPort;
+        serverCert = host->computer->serverCert;
+
+        if (host->failedPolls == 0) {
+            host->wasOnline = host->computer->state == NvComputer::CS_ONLINE;
+        }
+    }
+
+    if (addresses.isEmpty()) {
+        completePoll(host, false, false);
+        return;
+    }
+
+    // Race all addresses and take whichever responds first
+    host->pendingAddresses = addresses.count();
+    for (const NvAddress& address : addresses) {
+        requestServerInfo(host, address, httpsPort, serverCert,
+                          !serverCert.isNull() && httpsPort != 0 ? SisHttps : SisHttp);
+    }
+}
+
+// This follows the same sequence as NvHTTP::getServerInfo()
+void ComputerPoller::requestServerInfo(PollingHost* host, NvAddress address, uint16_t httpsPort,
+                                       QSslCertificate serverCert, ServerInfoStage stage)
+{
+    QUrl baseUrl;
+
+    baseUrl.setScheme(stage == SisHttps ? "https" : "http");
+    baseUrl.setHost(address.address());
+    baseUrl.setPort(stage == SisHttps ? httpsPort : address.port());
+
+    QNetworkReply* reply = sendRequest(host, baseUrl, "serverinfo", serverCert, SERVERINFO_TIMEOUT_MS);
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        takeReply(host, reply);
+        reply->deleteLater();
+
+        QString serverInfo;
+        bool certRejected = false;
+
+        if (reply->error() == QNetworkReply::NoError) {
+            serverInfo = QString::fromUtf8(reply->readAll());
+            try {
+                NvHTTP::verifyResponseStatus(serverInfo);
+            } catch (const GfeHttpResponseException& e) {
+                certRejected = e.getStatusCode() == 401;
+                serverInfo.clear();
+            }
+        }
+        else {
+            certRejected = reply->error() == QNetworkReply::SslHandshakeFailedError;
+        }
+
+        if (serverInfo.isEmpty()) {
+            if (certRejected && stage == SisHttps) {
+                // Certificate validation error, fallback to HTTP
+                requestServerInfo(host, address, httpsPort, serverCert, SisHttpFallback);
+            }
+            else {
+                handleAddressFailed(host);
+            }
+            return;
+        }
+
+        if (stage == SisHttp) {
+            // Populate the HTTPS port
+            uint16_t newHttpsPort = NvHTTP::getXmlString(serverInfo, "HttpsPort").toUShort();
+            if (newHttpsPort == 0) {
+                newHttpsPort = DEFAULT_HTTPS_PORT;
+            }
+
+            // If we just needed to determine the HTTPS port, we'll try again over
+            // HTTPS now that we have the port number
+            if (!serverCert.isNull()) {
+                requestServerInfo(host, address, newHttpsPort, serverCert, SisHttps);
+                return;
+            }
+
+            handleServerInfo(host, address, newHttpsPort, serverCert, serverInfo);
+        }
+        else {
+            handleServerInfo(host, address, httpsPort, serverCert, serverInfo);
+        }
+    });
+}
+
+void ComputerPoller::handleServerInfo(PollingHost* host, NvAddress address, uint16_t httpsPort,
+                                      QSslCertificate serverCert, QString serverInfo)
+{
+    NvHTTP http(address, httpsPort, serverCert);
+    NvComputer newState(http, serverInfo);
+
+    // Ensure the machine that responded is the one we intended to contact
+    if (host->computer->uuid != newState.uuid) {
+        qInfo() << "Found unexpected PC " << newState.name << " looking for " << host->computer->name;
+        handleAddressFailed(host);
+        return;
+    }
+
+    // We have our answer, so the other addresses are no longer needed
+    abortReplies(host);
+    host->pendingAddresses = 0;
+
+    bool changed = host->computer->update(newState);
+    if (!host->wasOnline) {
+        qInfo() << host->computer->name << "is now online at" << host->computer->activeAddress.toString();
+    }
+
+    completePoll(host, true, changed);
+}
+
+void ComputerPoller::handleAddressFailed(PollingHost* host)
+{
+    Q_ASSERT(host->pendingAddresses > 0);
+    if (--host->pendingAddresses > 0) {
+        // Wait for the rest of the addresses
+        return;
+    }
+
+    // Give a host that was online another try before declaring it offline
+    host->failedPolls++;
+    if (host->wasOnline && host->failedPolls < TRIES_BEFORE_OFFLINING) {
+        startPoll(host);
+        return;
+    }
+
+    bool changed = false;
+    {
+        QWriteLocker lock(&host->computer->lock);
+        if (host->computer->state != NvComputer::CS_OFFLINE) {
+            qInfo() << host->computer->name << "is now offline";
+            host->computer->state = NvComputer::CS_OFFLINE;
+            changed = true;
+        }
+    }
+
+    completePoll(host, false, changed);
+}
+
+void ComputerPoller::completePoll(PollingHost* host, bool online, bool changed)
+{
+    host->failedPolls = 0;
+
+    if (!online) {
+        if (changed) {
+            emit computerStateChanged(host->computer);
+        }
+
+        // Back off while the host stays offline. It's polled right
+        // away again if it's rediscovered or added again.
+        scheduleNextPoll(host, host->offlineIntervalMs);
+        host->offlineIntervalMs = qMin(host->offlineIntervalMs * 2, MAX_OFFLINE_POLL_INTERVAL_MS);
+        return;
+    }
+
+    host->offlineIntervalMs = POLL_INTERVAL_MS;
+
+    // Grab the applist if it's empty or it's been long enough that we need to refresh
+    bool fetchAppList;
+    host->pollsSinceLastAppListFetch++;
+    {
+        QReadLocker lock(&host->computer->lock);
+        fetchAppList = host->computer->state == NvComputer::CS_ONLINE &&
+                host->computer->pairState == NvComputer::PS_PAIRED &&
+                (host->computer->appList.isEmpty() || host->pollsSinceLastAppListFetch >= POLLS_PER_APPLIST_FETCH);
+    }
+
+    // Notify prior to the app list fetch since it may take a while, and we don't
+    // want to delay onlining of a machine, especially if we already have a cached list.
+    if (changed) {
+        emit computerStateChanged(host->computer);
+    }
+
+    if (fetchAppList) {
+        requestAppList(host);
+    }
+    else {
+        scheduleNextPoll(host, POLL_INTERVAL_MS);
+    }
+}
+
+void ComputerPoller::requestAppList(PollingHost* host)
+{
+    QUrl baseUrl;
+    QSslCertificate serverCert;
+
+    {
+        QReadLocker lock(&host->computer->lock);
+
+        baseUrl.setScheme("https");
+        baseUrl.setHost(host->computer->activeAddress.address());
+        baseUrl.setPort(host->computer->activeHttpsPort);
+        serverCert = host->computer->serverCert;
+    }
+
+    QNetworkReply* reply = sendRequest(host, baseUrl, "applist", serverCert, APPLIST_TIMEOUT_MS);
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        takeReply(host, reply);
+        reply->deleteLater();
+
+        QVector<NvApp> appList;
+        if (reply->error() == QNetworkReply::NoError) {
+            QByteArray appxmlBytes = reply->readAll();
+
+            // The applist almost never changes between polls, so skip parsing
+            // it and diffing it against our list if the response is identical
+            // to the last one we applied.
+            QByteArray appListHash = QCryptographicHash::hash(appxmlBytes, QCryptographicHash::Sha1);
+            if (appListHash == host->appListHash) {
+                bool haveAppList;
+                {
+                    QReadLocker lock(&host->computer->lock);
+                    haveAppList = !host->computer->appList.isEmpty();
+                }
+
+                if (haveAppList) {
+                    host->pollsSinceLastAppListFetch = 0;
+                    scheduleNextPoll(host, POLL_INTERVAL_MS);
+                    return;
+                }
+            }
+
+            QString appxml = QString::fromUtf8(appxmlBytes);
+            try {
+                NvHTTP::verifyResponseStatus(appxml);
+                appList = NvHTTP::parseAppList(appxml);
+                host->appListHash = appListHash;
+            } catch (...) {
+            }
+        }
+
+        if (!appList.isEmpty()) {
+            bool changed;
+            {
+                QWriteLocker lock(&host->computer->lock);
+                changed = host->computer->updateAppList(appList);
+            }
+
+            host->pollsSinceLastAppListFetch = 0;
+            if (changed) {
+                emit computerStateChanged(host->computer);
+            }
+        }
+
+        scheduleNextPoll(host, POLL_INTERVAL_MS);
+    });
+}
+
+void ComputerPoller::scheduleNextPoll(PollingHost* host, int delayMs)
+{
+    host->timer->start(delayMs);
+}
+
+QNetworkReply* ComputerPoller::sendRequest(PollingHost* host, QUrl baseUrl, QString command,
+                                           QSslCertificate serverCert, int timeoutMs)
+{
+    QNetworkRequest request = NvHTTP::createRequest(baseUrl, command, nullptr);
+
+    // GFE misbehaves if connections are reused, and the access cache can't be
+    // cleared (like NvHTTP does) while other hosts' requests are in flight.
+    request.setRawHeader("Connection", "close");
+
+    QNetworkReply* reply = m_Nam.get(request);
+
+    // Only accept the certificate we pinned when pairing
+    connect(reply, &QNetworkReply::sslErrors, this, [reply, serverCert](const QList<QSslError>& errors) {
+        if (serverCert.isNull()) {
+            return;
+        }
+
+        for (const QSslError& error : errors) {
+            if (serverCert != error.certificate()) {
+                return;
+            }
+        }
+
+        reply->ignoreSslErrors(errors);
+    });
+
+    // Aborting the request completes it with OperationCanceledError
+    QTimer::singleShot(timeoutMs, reply, [reply]() {
+        reply->abort();
+    });
+
+    host->replies.append(reply);
+    return reply;
+}
+
+void ComputerPoller::takeReply(PollingHost* host, QNetworkReply* reply)
+{
+    host->replies.removeOne(reply);
+}
+
+void ComputerPoller::abortReplies(PollingHost* host)
+{
+    QList<QNetworkReply*> replies;
+    replies.swap(host->replies);
+
+    for (QNetworkReply* reply : replies) {
+        // Disconnect first so our finished handler doesn't run
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
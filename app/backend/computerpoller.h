@@ -0,0 +1,93 @@
+#pragma once
+
+#include "nvcomputer.h"
+
+#include <QMap>
+#include <QMutex>
+#include <QNetworkAccessManager>
+#include <QTimer>
+
+// Polls all known hosts from a single thread. Each poll sends a serverinfo
+// request to every address of the host at once on a shared
+// QNetworkAccessManager and takes the first one that answers, so an
+// unreachable address no longer delays the others. Offline hosts are
+// polled less often the longer they stay offline.
+class ComputerPoller : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ComputerPoller(QObject* parent = nullptr);
+
+    virtual ~ComputerPoller();
+
+    // Starts polling the computer, or polls it again right away if it
+    // was already being polled. This may be called from any thread.
+    void startPollingComputer(NvComputer* computer);
+
+    // Must be called on the poller's thread. The computer is no longer
+    // referenced once this returns.
+    void stopPollingComputer(NvComputer* computer);
+
+    // Must be called on the poller's thread
+    void stopPolling();
+
+signals:
+    void computerStateChanged(NvComputer* computer);
+
+private slots:
+    void handlePendingComputers();
+
+private:
+    struct PollingHost {
+        NvComputer* computer;
+        QTimer* timer;
+        QList<QNetworkReply*> replies;
+        int pendingAddresses;
+        int failedPolls;
+        int offlineIntervalMs;
+        int pollsSinceLastAppListFetch;
+        QByteArray appListHash;
+        bool wasOnline;
+    };
+
+    enum ServerInfoStage {
+        // Over HTTPS with the pinned certificate
+        SisHttps,
+
+        // Over HTTP after the server rejected our certificate
+        SisHttpFallback,
+
+        // Over HTTP to find the HTTPS port of a host we haven't paired with
+        SisHttp,
+    };
+
+    void startPoll(PollingHost* host);
+
+    void requestServerInfo(PollingHost* host, NvAddress address, uint16_t httpsPort,
+                           QSslCertificate serverCert, ServerInfoStage stage);
+
+    void handleServerInfo(PollingHost* host, NvAddress address, uint16_t httpsPort,
+                          QSslCertificate serverCert, QString serverInfo);
+
+    void handleAddressFailed(PollingHost* host);
+
+    void completePoll(PollingHost* host, bool online, bool changed);
+
+    void requestAppList(PollingHost* host);
+
+    void scheduleNextPoll(PollingHost* host, int delayMs);
+
+    QNetworkReply* sendRequest(PollingHost* host, QUrl baseUrl, QString command,
+                               QSslCertificate serverCert, int timeoutMs);
+
+    void takeReply(PollingHost* host, QNetworkReply* reply);
+
+    void abortReplies(PollingHost* host);
+
+    QNetworkAccessManager m_Nam;
+    QMap<QString, PollingHost*> m_Hosts;
+
+    QMutex m_PendingLock;
+    QList<NvComputer*> m_PendingComputers;
+};
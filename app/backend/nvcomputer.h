@@ -10,7 +10,7 @@
 
 class NvComputer
 {
-    friend class PcMonitorThread;
+    friend class ComputerPoller;
     friend class ComputerManager;
     friend class PendingQuitTask;
 
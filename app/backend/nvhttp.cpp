@@ -8,7 +8,6 @@
 #include <QTimer>
 #include <QXmlStreamReader>
 #include <QSslKey>
-#include <QImageReader>
 #include <QtEndian>
 #include <QNetworkProxy>
 
@@ -105,14 +104,20 @@ NvHTTP::parseQuad(QString quad)
 
 int
 NvHTTP::getCurrentGame(QString serverInfo)
+{
+    return getCurrentGame(getXmlStrings(serverInfo));
+}
+
+int
+NvHTTP::getCurrentGame(const QHash<QString, QString>& serverInfoStrings)
 {
     // GFE 2.8 started keeping currentgame set to the last game played. As a result, it no longer
     // has the semantics that its name would indicate. To contain the effects of this change as much
     // as possible, we'll force the current game to zero if the server isn't in a streaming session.
-    QString serverState = getXmlString(serverInfo, "state");
+    QString serverState = serverInfoStrings.value("state");
     if (serverState != nullptr && serverState.endsWith("_SERVER_BUSY"))
     {
-        return getXmlString(serverInfo, "currentgame").toInt();
+        return serverInfoStrings.value("currentgame").toInt();
     }
     else
     {
@@ -314,6 +319,12 @@ NvHTTP::getAppList()
                                             NvLogLevel::NVLL_ERROR);
     verifyResponseStatus(appxml);
 
+    return parseAppList(appxml);
+}
+
+QVector<NvApp>
+NvHTTP::parseAppList(QString appxml)
+{
     QXmlStreamReader xmlReader(appxml);
     QVector<NvApp> apps;
     while (!xmlReader.atEnd()) {
@@ -385,7 +396,7 @@ NvHTTP::verifyResponseStatus(QString xml)
     throw GfeHttpResponseException(-1, "Malformed GFE XML (missing root element)");
 }
 
-QImage
+QByteArray
 NvHTTP::getBoxArt(int appId)
 {
     QNetworkReply* reply = openConnection(m_BaseUrlHttps,
@@ -394,7 +405,7 @@ NvHTTP::getBoxArt(int appId)
                                           "&AssetType=2&AssetIdx=0",
                                           REQUEST_TIMEOUT_MS,
                                           NvLogLevel::NVLL_VERBOSE);
-    QImage image = QImageReader(reply).read();
+    QByteArray image = reply->readAll();
     delete reply;
 
     return image;
@@ -413,6 +424,45 @@ NvHTTP::getXmlStringFromHex(QString xml,
     return QByteArray::fromHex(str.toLatin1());
 }
 
+QHash<QString, QString>
+NvHTTP::getXmlStrings(QString xml)
+{
+    QXmlStreamReader xmlReader(xml);
+    QHash<QString, QString> strings;
+    QString elementName;
+    QString elementText;
+
+    while (!xmlReader.atEnd())
+    {
+        switch (xmlReader.readNext())
+        {
+        case QXmlStreamReader::StartElement:
+            elementName = xmlReader.name().toString();
+            elementText.clear();
+            break;
+
+        case QXmlStreamReader::Characters:
+            elementText += xmlReader.text();
+            break;
+
+        case QXmlStreamReader::EndElement:
+            // Only elements without children are recorded. Like getXmlString(),
+            // the first occurrence of a tag wins.
+            if (!elementName.isEmpty() && !strings.contains(elementName))
+            {
+                strings.insert(elementName, elementText);
+            }
+            elementName.clear();
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return strings;
+}
+
 QString
 NvHTTP::getXmlString(QString xml,
                      QString tagName)
@@ -481,12 +531,10 @@ NvHTTP::openConnectionToString(QUrl baseUrl,
     return ret;
 }
 
-QNetworkReply*
-NvHTTP::openConnection(QUrl baseUrl,
-                       QString command,
-                       QString arguments,
-                       int timeoutMs,
-                       NvLogLevel logLevel)
+QNetworkRequest
+NvHTTP::createRequest(QUrl baseUrl,
+                      QString command,
+                      QString arguments)
 {
     // Port must be set
     Q_ASSERT(baseUrl.port(0) != 0);
@@ -512,6 +560,19 @@ NvHTTP::openConnection(QUrl baseUrl,
     request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
 #endif
 
+    return request;
+}
+
+QNetworkReply*
+NvHTTP::openConnection(QUrl baseUrl,
+                       QString command,
+                       QString arguments,
+                       int timeoutMs,
+                       NvLogLevel logLevel)
+{
+    QNetworkRequest request = createRequest(baseUrl, command, arguments);
+    QUrl url = request.url();
+
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0) && QT_VERSION < QT_VERSION_CHECK(5, 15, 1) && !defined(QT_NO_BEARERMANAGEMENT)
     // HACK: Set network accessibility to work around QTBUG-80947 (introduced in Qt 5.14.0 and fixed in Qt 5.15.1)
     QT_WARNING_PUSH
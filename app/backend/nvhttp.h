@@ -6,6 +6,7 @@
 
 #include <Limelight.h>
 
+#include <QHash>
 #include <QUrl>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -117,6 +118,10 @@ public:
     int
     getCurrentGame(QString serverInfo);
 
+    static
+    int
+    getCurrentGame(const QHash<QString, QString>& serverInfoStrings);
+
     QString
     getServerInfo(NvLogLevel logLevel, bool fastFail = false);
 
@@ -129,6 +134,12 @@ public:
     getXmlString(QString xml,
                  QString tagName);
 
+    // Returns the text of every element without children in a single
+    // pass over the document, for responses where many tags are read.
+    static
+    QHash<QString, QString>
+    getXmlStrings(QString xml);
+
     static
     QByteArray
     getXmlStringFromHex(QString xml,
@@ -141,6 +152,14 @@ public:
                            int timeoutMs,
                            NvLogLevel logLevel = NvLogLevel::NVLL_VERBOSE);
 
+    // Builds a request with our client certificate for use
+    // on a QNetworkAccessManager other than our own
+    static
+    QNetworkRequest
+    createRequest(QUrl baseUrl,
+                  QString command,
+                  QString arguments);
+
     void setServerCert(QSslCertificate serverCert);
 
     void setAddress(NvAddress address);
@@ -176,7 +195,11 @@ public:
     QVector<NvApp>
     getAppList();
 
-    QImage
+    static
+    QVector<NvApp>
+    parseAppList(QString appxml);
+
+    QByteArray
     getBoxArt(int appId);
 
     static
@@ -3,6 +3,8 @@
 #include <QCommandLineParser>
 #include <QRegularExpression>
 
+#include <Limelight.h>
+
 #if defined(Q_OS_WIN)
 #include <qt_windows.h>
 #endif
@@ -313,9 +315,14 @@ void StreamCommandLineParser::parse(const QStringList &args, StreamingPreference
     parser.addToggleOption("reverse-scroll-direction", "inverted scroll direction");
     parser.addToggleOption("swap-gamepad-buttons", "swap A/B and X/Y gamepad buttons (Nintendo-style)");
     parser.addToggleOption("keep-awake", "prevent display sleep while streaming");
+    parser.addToggleOption("video-pipelining", "a separate thread for video FEC recovery and depacketization (needs a spare CPU core)");
     parser.addChoiceOption("capture-system-keys", "capture system key combos", m_CaptureSysKeysModeMap.keys());
     parser.addChoiceOption("video-codec", "video codec", m_VideoCodecMap.keys());
     parser.addChoiceOption("video-decoder", "video decoder", m_VideoDecoderMap.keys());
+    parser.addValueOption("frame-trace", "file to write a Chrome trace of video frame latency");
+    parser.addValueOption("packet-capture", "file to record raw video and audio packets to for offline replay");
+    parser.addFlagOption("packet-capture-keys", "stream encryption keys in the packet capture (needed to replay encrypted audio; keep the file private)");
+    parser.addValueOption("network-impairment", "simulated packet loss, reordering, duplication and jitter (e.g. loss=1,reorder=1,jitter=5)");
 
     if (!parser.parse(args)) {
         parser.showError(parser.errorText());
@@ -427,6 +434,9 @@ void StreamCommandLineParser::parse(const QStringList &args, StreamingPreference
     // Resolve --keep-awake and --no-keep-awake options
     preferences->keepAwake = parser.getToggleOptionValue("keep-awake", preferences->keepAwake);
 
+    // Resolve --video-pipelining and --no-video-pipelining options
+    preferences->videoPipelining = parser.getToggleOptionValue("video-pipelining", preferences->videoPipelining);
+
     // Resolve --capture-system-keys option
     if (parser.isSet("capture-system-keys")) {
         preferences->captureSysKeysMode = mapValue(m_CaptureSysKeysModeMap, parser.getChoiceOptionValue("capture-system-keys"));
@@ -442,6 +452,25 @@ void StreamCommandLineParser::parse(const QStringList &args, StreamingPreference
         preferences->videoDecoderSelection = mapValue(m_VideoDecoderMap, parser.getChoiceOptionValue("video-decoder"));
     }
 
+    // Resolve --frame-trace option
+    if (parser.isSet("frame-trace")) {
+        preferences->frameTracePath = parser.value("frame-trace");
+    }
+
+    // Resolve --packet-capture option
+    if (parser.isSet("packet-capture")) {
+        preferences->packetCapturePath = parser.value("packet-capture");
+        preferences->packetCaptureIncludeKeys = parser.isSet("packet-capture-keys");
+    }
+
+    // Resolve --network-impairment option
+    if (parser.isSet("network-impairment")) {
+        preferences->networkImpairment = parser.value("network-impairment");
+        if (!LiSetNetworkImpairment(qPrintable(preferences->networkImpairment))) {
+            parser.showError(QString("Invalid network-impairment value: %1").arg(preferences->networkImpairment));
+        }
+    }
+
     // This method will not return and terminates the process if --version or
     // --help is specified
     parser.handleHelpAndVersionOptions();
@@ -19,6 +19,10 @@ CenteredGridView {
     bottomMargin: 5
     cellWidth: 230; cellHeight: 297;
 
+    // Create delegates for a couple of rows beyond the visible area, so
+    // their box art is decoded before they scroll into view
+    cacheBuffer: cellHeight * 2
+
     function computerLost()
     {
         // Go back to the PC view on PC loss
@@ -80,34 +84,26 @@ CenteredGridView {
         opacity: model.hidden ? 0.4 : 1.0
 
         Image {
-            property bool isPlaceholder: false
+            // Nearly all of Nvidia's official box art does not match the dimensions of placeholder
+            // images, however the one known exeception is Overcooked. Therefore, we only execute
+            // the image size checks if this is not an app collector game. We know the officially
+            // supported games all have box art, so this check is not required.
+            //
+            // Box art is scaled down to a thumbnail, so boxartSize is the size it had before that.
+            // It is invalid while we're still showing our no_app_image.png.
+            property bool isPlaceholder: !model.isAppCollectorGame &&
+                                         (model.boxartSize.width < 0 ||
+                                          (model.boxartSize.width == 130 && model.boxartSize.height == 180) || // GFE 2.0 placeholder image
+                                          (model.boxartSize.width == 628 && model.boxartSize.height == 888) || // GFE 3.0 placeholder image
+                                          (model.boxartSize.width == 200 && model.boxartSize.height == 266))   // Our no_app_image.png
 
             id: appIcon
             anchors.horizontalCenter: parent.horizontalCenter
             y: 10
+            width: 200
+            height: 267
             source: model.boxart
 
-            onSourceSizeChanged: {
-                // Nearly all of Nvidia's official box art does not match the dimensions of placeholder
-                // images, however the one known exeception is Overcooked. Therefore, we only execute
-                // the image size checks if this is not an app collector game. We know the officially
-                // supported games all have box art, so this check is not required.
-                if (!model.isAppCollectorGame &&
-                    ((sourceSize.width == 130 && sourceSize.height == 180) || // GFE 2.0 placeholder image
-                     (sourceSize.width == 628 && sourceSize.height == 888) || // GFE 3.0 placeholder image
-                     (sourceSize.width == 200 && sourceSize.height == 266)))  // Our no_app_image.png
-                {
-                    isPlaceholder = true
-                }
-                else
-                {
-                    isPlaceholder = false
-                }
-
-                width = 200
-                height = 267
-            }
-
             // Display a tooltip with the full name if it's truncated
             ToolTip.text: model.name
             ToolTip.delay: 1000
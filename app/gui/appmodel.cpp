@@ -85,6 +85,8 @@ QVariant AppModel::data(const QModelIndex &index, int role) const
     case BoxArtRole:
         // FIXME: const-correctness
         return const_cast<BoxArtManager&>(m_BoxArtManager).loadBoxArt(m_Computer, app);
+    case BoxArtSizeRole:
+        return BoxArtManager::getBoxArtSize(m_Computer, app.id);
     case HiddenRole:
         return app.hidden;
     case AppIdRole:
@@ -105,6 +107,7 @@ QHash<int, QByteArray> AppModel::roleNames() const
     names[NameRole] = "name";
     names[RunningRole] = "running";
     names[BoxArtRole] = "boxart";
+    names[BoxArtSizeRole] = "boxartSize";
     names[HiddenRole] = "hidden";
     names[AppIdRole] = "appid";
     names[DirectLaunchRole] = "directLaunch";
@@ -312,7 +315,7 @@ void AppModel::handleBoxArtLoaded(NvComputer* computer, NvApp app, QUrl /* image
         // Let our view know the box art data has changed for this app
         emit dataChanged(createIndex(index, 0),
                          createIndex(index, 0),
-                         QVector<int>() << BoxArtRole);
+                         QVector<int>() << BoxArtRole << BoxArtSizeRole);
     }
     else {
         qWarning() << "App not found for box art callback:" << app.name;
@@ -15,6 +15,7 @@ class AppModel : public QAbstractListModel
         NameRole = Qt::UserRole,
         RunningRole,
         BoxArtRole,
+        BoxArtSizeRole,
         HiddenRole,
         AppIdRole,
         DirectLaunchRole,
@@ -0,0 +1,21 @@
+#include "boxartimageprovider.h"
+#include "backend/boxartmanager.h"
+
+BoxArtImageProvider::BoxArtImageProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image),
+      m_ThumbnailSize(BoxArtManager::getThumbnailSize())
+{
+
+}
+
+QImage BoxArtImageProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+{
+    QImage image = BoxArtManager::loadThumbnail(id,
+                                                requestedSize.isValid() ? requestedSize : m_ThumbnailSize,
+                                                nullptr);
+    if (size != nullptr) {
+        *size = image.size();
+    }
+
+    return image;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QQuickImageProvider>
+
+// Serves box art thumbnails from BoxArtManager's cache for image://boxart
+// URLs. BoxArtManager only hands out these URLs once the thumbnail is
+// decoded, so requestImage() only touches the disk if it was evicted.
+class BoxArtImageProvider : public QQuickImageProvider
+{
+public:
+    BoxArtImageProvider();
+
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+
+private:
+    QSize m_ThumbnailSize;
+};
@@ -36,6 +36,7 @@
 #include "utils.h"
 #include "gui/computermodel.h"
 #include "gui/appmodel.h"
+#include "gui/boxartimageprovider.h"
 #include "backend/autoupdatechecker.h"
 #include "backend/systemproperties.h"
 #include "streaming/session.h"
@@ -590,6 +591,9 @@ int main(int argc, char *argv[])
     QQmlApplicationEngine engine;
     QString initialView;
 
+    // The engine takes ownership of the provider
+    engine.addImageProvider("boxart", new BoxArtImageProvider());
+
     GlobalCommandLineParser parser;
     switch (parser.parse(app.arguments())) {
     case GlobalCommandLineParser::NormalStartRequested:
@@ -169,6 +169,13 @@ public:
     Language language;
     CaptureSysKeysMode captureSysKeysMode;
 
+    // Not persisted. These are only set from the command line.
+    QString frameTracePath;
+    QString packetCapturePath;
+    bool packetCaptureIncludeKeys = false;
+    bool videoPipelining = false;
+    QString networkImpairment;
+
 signals:
     void displayModeChanged();
     void bitrateChanged();
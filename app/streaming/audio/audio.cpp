@@ -137,6 +137,16 @@ int Session::arInit(int /* audioConfiguration */,
         return -1;
     }
 
+    if (!s_ActiveSession->m_AudioJitterBuffer.initialize(s_ActiveSession->m_AudioConfig.sampleRate,
+                                                         s_ActiveSession->m_AudioConfig.channelCount,
+                                                         s_ActiveSession->m_AudioConfig.samplesPerFrame)) {
+        opus_multistream_decoder_destroy(s_ActiveSession->m_OpusDecoder);
+        s_ActiveSession->m_OpusDecoder = nullptr;
+        delete s_ActiveSession->m_AudioRenderer;
+        s_ActiveSession->m_AudioRenderer = nullptr;
+        return -1;
+    }
+
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                 "Audio stream has %d channels",
                 s_ActiveSession->m_AudioConfig.channelCount);
@@ -151,6 +161,8 @@ void Session::arCleanup()
 
     opus_multistream_decoder_destroy(s_ActiveSession->m_OpusDecoder);
     s_ActiveSession->m_OpusDecoder = nullptr;
+
+    s_ActiveSession->m_AudioJitterBuffer.cleanup();
 }
 
 void Session::arDecodeAndPlaySample(char* sampleData, int sampleLength)
@@ -194,26 +206,66 @@ void Session::arDecodeAndPlaySample(char* sampleData, int sampleLength)
     }
 
     if (s_ActiveSession->m_AudioRenderer != nullptr) {
-        int desiredSize = sizeof(short) * s_ActiveSession->m_AudioConfig.samplesPerFrame * s_ActiveSession->m_AudioConfig.channelCount;
-        void* buffer = s_ActiveSession->m_AudioRenderer->getAudioBuffer(&desiredSize);
-        if (buffer == nullptr) {
-            return;
-        }
-
-        samplesDecoded = opus_multistream_decode(s_ActiveSession->m_OpusDecoder,
-                                                 (unsigned char*)sampleData,
-                                                 sampleLength,
-                                                 (short*)buffer,
-                                                 desiredSize / sizeof(short) / s_ActiveSession->m_AudioConfig.channelCount,
-                                                 0);
-
-        // Update desiredSize with the number of bytes actually populated by the decoding operation
-        if (samplesDecoded > 0) {
-            SDL_assert(desiredSize >= (int)(sizeof(short) * samplesDecoded * s_ActiveSession->m_AudioConfig.channelCount));
-            desiredSize = sizeof(short) * samplesDecoded * s_ActiveSession->m_AudioConfig.channelCount;
+        AudioJitterBuffer& jitterBuffer = s_ActiveSession->m_AudioJitterBuffer;
+        int queuedSamples = s_ActiveSession->m_AudioRenderer->getQueuedSamples();
+        int desiredSize;
+
+        if (queuedSamples >= 0) {
+            bool keepPacket = jitterBuffer.update(queuedSamples);
+
+            // Decode into the jitter buffer, which resamples the output
+            // slightly to hold the renderer's queue at the target depth.
+            // Packets we drop are still decoded so the decoder's state
+            // stays continuous with the next packet.
+            samplesDecoded = opus_multistream_decode(s_ActiveSession->m_OpusDecoder,
+                                                     (unsigned char*)sampleData,
+                                                     sampleLength,
+                                                     jitterBuffer.getDecodeBuffer(),
+                                                     s_ActiveSession->m_AudioConfig.samplesPerFrame,
+                                                     0);
+            if (!keepPacket) {
+                // Far too much audio is queued already
+                return;
+            }
+
+            desiredSize = sizeof(short) * jitterBuffer.getMaxOutputSamples() * s_ActiveSession->m_AudioConfig.channelCount;
+            void* buffer = s_ActiveSession->m_AudioRenderer->getAudioBuffer(&desiredSize);
+            if (buffer == nullptr) {
+                return;
+            }
+
+            if (samplesDecoded > 0) {
+                samplesDecoded = jitterBuffer.resample(samplesDecoded,
+                                                       (short*)buffer,
+                                                       desiredSize / sizeof(short) / s_ActiveSession->m_AudioConfig.channelCount);
+                desiredSize = sizeof(short) * samplesDecoded * s_ActiveSession->m_AudioConfig.channelCount;
+            }
+            else {
+                desiredSize = 0;
+            }
         }
         else {
-            desiredSize = 0;
+            desiredSize = sizeof(short) * s_ActiveSession->m_AudioConfig.samplesPerFrame * s_ActiveSession->m_AudioConfig.channelCount;
+            void* buffer = s_ActiveSession->m_AudioRenderer->getAudioBuffer(&desiredSize);
+            if (buffer == nullptr) {
+                return;
+            }
+
+            samplesDecoded = opus_multistream_decode(s_ActiveSession->m_OpusDecoder,
+                                                     (unsigned char*)sampleData,
+                                                     sampleLength,
+                                                     (short*)buffer,
+                                                     desiredSize / sizeof(short) / s_ActiveSession->m_AudioConfig.channelCount,
+                                                     0);
+
+            // Update desiredSize with the number of bytes actually populated by the decoding operation
+            if (samplesDecoded > 0) {
+                SDL_assert(desiredSize >= (int)(sizeof(short) * samplesDecoded * s_ActiveSession->m_AudioConfig.channelCount));
+                desiredSize = sizeof(short) * samplesDecoded * s_ActiveSession->m_AudioConfig.channelCount;
+            }
+            else {
+                desiredSize = 0;
+            }
         }
 
         if (!s_ActiveSession->m_AudioRenderer->submitAudio(desiredSize)) {
@@ -237,6 +289,9 @@ void Session::arDecodeAndPlaySample(char* sampleData, int sampleLength)
 
         s_ActiveSession->m_AudioRenderer = s_ActiveSession->createAudioRenderer(&s_ActiveSession->m_AudioConfig);
 
+        // The new renderer starts with an empty queue
+        s_ActiveSession->m_AudioJitterBuffer.reset();
+
         Uint32 audioReinitStopTime = SDL_GetTicks();
 
         s_ActiveSession->m_DropAudioEndTime = audioReinitStopTime + (audioReinitStopTime - audioReinitStartTime);
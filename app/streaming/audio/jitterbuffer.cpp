@@ -0,0 +1,200 @@
+#include "jitterbuffer.h"
+
+#include <Limelight.h>
+
+#include <math.h>
+
+AudioJitterBuffer::AudioJitterBuffer()
+    : m_SampleRate(0),
+      m_ChannelCount(0),
+      m_SamplesPerFrame(0),
+      m_DecodeBuffer(nullptr),
+      m_PreviousSample(nullptr),
+      m_ArrivalVariance(0),
+      m_DriftPpm(0),
+      m_DroppedPackets(0)
+{
+    SDL_AtomicSet(&m_Active, 0);
+    SDL_AtomicSet(&m_StatsDepthUs, 0);
+    SDL_AtomicSet(&m_StatsTargetUs, 0);
+    SDL_AtomicSet(&m_StatsDriftPpm, 0);
+    SDL_AtomicSet(&m_StatsDroppedPackets, 0);
+    reset();
+}
+
+AudioJitterBuffer::~AudioJitterBuffer()
+{
+    cleanup();
+}
+
+bool AudioJitterBuffer::initialize(int sampleRate, int channelCount, int samplesPerFrame)
+{
+    cleanup();
+
+    m_SampleRate = sampleRate;
+    m_ChannelCount = channelCount;
+    m_SamplesPerFrame = samplesPerFrame;
+
+    m_DecodeBuffer = (short*)SDL_malloc(sizeof(short) * samplesPerFrame * channelCount);
+    m_PreviousSample = (short*)SDL_calloc(channelCount, sizeof(short));
+    if (m_DecodeBuffer == nullptr || m_PreviousSample == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to allocate audio jitter buffer");
+        cleanup();
+        return false;
+    }
+
+    m_ArrivalVariance = 0;
+    m_DriftPpm = 0;
+    m_DroppedPackets = 0;
+    SDL_AtomicSet(&m_StatsDroppedPackets, 0);
+    reset();
+
+    return true;
+}
+
+void AudioJitterBuffer::cleanup()
+{
+    SDL_AtomicSet(&m_Active, 0);
+
+    SDL_free(m_DecodeBuffer);
+    m_DecodeBuffer = nullptr;
+
+    SDL_free(m_PreviousSample);
+    m_PreviousSample = nullptr;
+}
+
+void AudioJitterBuffer::reset()
+{
+    // The arrival variance and drift estimate describe the network and the
+    // clocks, so they survive a reset. Everything tied to the queue doesn't.
+    m_Phase = 0;
+    m_Step = 1.0;
+    m_LastArrivalTime = 0;
+    m_SmoothedDepth = 0;
+    m_TargetDepth = m_SamplesPerFrame * k_MinTargetPackets;
+    m_HaveDepth = false;
+
+    if (m_PreviousSample != nullptr) {
+        SDL_memset(m_PreviousSample, 0, sizeof(short) * m_ChannelCount);
+    }
+}
+
+bool AudioJitterBuffer::update(int queuedSamples)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    SDL_assert(m_DecodeBuffer != nullptr);
+    SDL_AtomicSet(&m_Active, 1);
+
+    // Track the variance of the packet inter-arrival time around the packet duration
+    if (m_LastArrivalTime != 0) {
+        double intervalMs = ((now - m_LastArrivalTime) * 1000.0) / SDL_GetPerformanceFrequency();
+        double deviationMs = intervalMs - (m_SamplesPerFrame * 1000.0) / m_SampleRate;
+
+        // Don't let a stall (like a renderer reinitialization) dominate the estimate
+        deviationMs = SDL_max(-100.0, SDL_min(deviationMs, 100.0));
+        m_ArrivalVariance += (deviationMs * deviationMs - m_ArrivalVariance) / 64;
+    }
+    m_LastArrivalTime = now;
+
+    // Buffer enough to ride out late packets 3 standard deviations out
+    double targetMs = (m_SamplesPerFrame * k_MinTargetPackets * 1000.0) / m_SampleRate + 3 * sqrt(m_ArrivalVariance);
+    targetMs = SDL_min(targetMs, (double)k_MaxTargetMs);
+    m_TargetDepth = (targetMs * m_SampleRate) / 1000;
+
+    // Audio still waiting in moonlight-common-c's queue is buffered too
+    double depth = queuedSamples + ((double)LiGetPendingAudioDuration() * m_SampleRate) / 1000;
+
+    // The renderer's queue drains in device-sized chunks, so the
+    // instantaneous depth is too noisy to steer by directly.
+    if (!m_HaveDepth) {
+        m_SmoothedDepth = depth;
+        m_HaveDepth = true;
+    }
+    else {
+        m_SmoothedDepth += (depth - m_SmoothedDepth) / 32;
+    }
+
+    bool keepPacket = true;
+    double dropThreshold = m_TargetDepth + SDL_max(m_TargetDepth, (k_MinDropMarginMs * m_SampleRate) / 1000.0);
+    if (depth > dropThreshold) {
+        // This only happens when the renderer has stalled or the host bursts
+        // a backlog at us, and resampling would take far too long to catch up.
+        m_DroppedPackets++;
+        keepPacket = false;
+    }
+    else {
+        // Steer the depth back to the target with a PI controller. The integral
+        // term converges on the clock drift between the host and our device.
+        double error = m_SmoothedDepth - m_TargetDepth;
+        m_DriftPpm = SDL_max(-(double)k_MaxDriftPpm, SDL_min(m_DriftPpm + error * 0.004, (double)k_MaxDriftPpm));
+
+        double correctionPpm = error * 8 + m_DriftPpm;
+        correctionPpm = SDL_max(-(double)k_MaxCorrectionPpm, SDL_min(correctionPpm, (double)k_MaxCorrectionPpm));
+
+        // Consuming input faster than real time shrinks the queue
+        m_Step = 1.0 + correctionPpm / 1000000.0;
+    }
+
+    SDL_AtomicSet(&m_StatsDepthUs, (int)((m_SmoothedDepth * 1000000) / m_SampleRate));
+    SDL_AtomicSet(&m_StatsTargetUs, (int)((m_TargetDepth * 1000000) / m_SampleRate));
+    SDL_AtomicSet(&m_StatsDriftPpm, (int)lround(m_DriftPpm));
+    SDL_AtomicSet(&m_StatsDroppedPackets, (int)m_DroppedPackets);
+
+    return keepPacket;
+}
+
+int AudioJitterBuffer::resample(int inputSamples, short* output, int maxOutputSamples)
+{
+    const short* input = m_DecodeBuffer;
+    double position = m_Phase;
+    int outputSamples = 0;
+
+    SDL_assert(inputSamples > 0 && inputSamples <= m_SamplesPerFrame);
+
+    // Linear interpolation is plenty for ratios this close to 1. When no
+    // correction is needed, the phase stays put and samples pass through.
+    while (position <= inputSamples - 1 && outputSamples < maxOutputSamples) {
+        int index = (int)floor(position);
+        double fraction = position - index;
+        const short* s0 = index < 0 ? m_PreviousSample : &input[index * m_ChannelCount];
+        short* out = &output[outputSamples * m_ChannelCount];
+
+        if (fraction == 0) {
+            SDL_memcpy(out, s0, sizeof(short) * m_ChannelCount);
+        }
+        else {
+            const short* s1 = &input[(index + 1) * m_ChannelCount];
+
+            for (int ch = 0; ch < m_ChannelCount; ch++) {
+                out[ch] = (short)lround(s0[ch] + (s1[ch] - s0[ch]) * fraction);
+            }
+        }
+
+        outputSamples++;
+        position += m_Step;
+    }
+
+    // Carry the fractional position over to the next packet. If the renderer
+    // couldn't take everything, the rest of this packet is skipped.
+    m_Phase = SDL_max(position - inputSamples, -1.0);
+    SDL_memcpy(m_PreviousSample, &input[(inputSamples - 1) * m_ChannelCount], sizeof(short) * m_ChannelCount);
+
+    return outputSamples;
+}
+
+int AudioJitterBuffer::stringifyStats(char* output, int length)
+{
+    if (!isActive() || length <= 0) {
+        return 0;
+    }
+
+    int ret = SDL_snprintf(output, length,
+                           "Audio buffer: %.1f ms (target %.1f ms), clock drift %+d ppm, %d packets dropped\n",
+                           SDL_AtomicGet(&m_StatsDepthUs) / 1000.0f,
+                           SDL_AtomicGet(&m_StatsTargetUs) / 1000.0f,
+                           SDL_AtomicGet(&m_StatsDriftPpm),
+                           SDL_AtomicGet(&m_StatsDroppedPackets));
+    return SDL_min(ret, length - 1);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <SDL.h>
+
+// Sits between the Opus decoder and the audio renderer and keeps the amount
+// of queued audio near a target picked from the observed packet inter-arrival
+// variance. Clock drift between the host and the local audio device is
+// absorbed by resampling each packet by a few hundred ppm rather than by
+// dropping whole packets, which is audible.
+class AudioJitterBuffer
+{
+public:
+    AudioJitterBuffer();
+
+    ~AudioJitterBuffer();
+
+    bool initialize(int sampleRate, int channelCount, int samplesPerFrame);
+
+    void cleanup();
+
+    // Restarts depth tracking when the renderer's queue has been lost,
+    // such as after the audio renderer is recreated.
+    void reset();
+
+    // Called for each packet before it is decoded with the number of samples
+    // (per channel) the renderer has queued. Returns false if the packet must
+    // be dropped because far too much audio is buffered.
+    bool update(int queuedSamples);
+
+    // Opus should decode up to samplesPerFrame samples into this buffer
+    short* getDecodeBuffer()
+    {
+        return m_DecodeBuffer;
+    }
+
+    // The renderer must accept this many samples per packet. Slowing
+    // playback by the maximum correction stretches a packet by up to
+    // k_MaxCorrectionPpm, plus one sample for the carried-over phase.
+    static int getMaxOutputSamples(int samplesPerFrame)
+    {
+        return samplesPerFrame + (samplesPerFrame * k_MaxCorrectionPpm + 999999) / 1000000 + 1;
+    }
+
+    int getMaxOutputSamples()
+    {
+        return getMaxOutputSamples(m_SamplesPerFrame);
+    }
+
+    // Resamples the decoded samples into the output buffer at the current
+    // correction ratio and returns the number of samples written.
+    int resample(int inputSamples, short* output, int maxOutputSamples);
+
+    bool isActive()
+    {
+        return SDL_AtomicGet(&m_Active) != 0;
+    }
+
+    // Appends the current state for the stats overlay. This may be
+    // called from any thread.
+    int stringifyStats(char* output, int length);
+
+private:
+    // Limits on the target depth
+    static const int k_MinTargetPackets = 1;
+    static const int k_MaxTargetMs = 40;
+
+    // Packets are dropped once the depth exceeds the target by this much
+    static const int k_MinDropMarginMs = 30;
+
+    // Resampling beyond this is audible as a change in pitch
+    static const int k_MaxCorrectionPpm = 2000;
+
+    // Real clocks rarely differ by more than a few hundred ppm
+    static const int k_MaxDriftPpm = 1000;
+
+    int m_SampleRate;
+    int m_ChannelCount;
+    int m_SamplesPerFrame;
+    short* m_DecodeBuffer;
+
+    // Last sample of the previous packet for each channel, used to
+    // interpolate across packet boundaries
+    short* m_PreviousSample;
+
+    // Position of the next output sample relative to the start of the next
+    // packet. This is negative when it falls after the previous packet's last sample.
+    double m_Phase;
+    double m_Step;
+
+    Uint64 m_LastArrivalTime;
+    double m_ArrivalVariance;
+    double m_SmoothedDepth;
+    double m_TargetDepth;
+    double m_DriftPpm;
+    bool m_HaveDepth;
+    uint32_t m_DroppedPackets;
+
+    SDL_atomic_t m_Active;
+    SDL_atomic_t m_StatsDepthUs;
+    SDL_atomic_t m_StatsTargetUs;
+    SDL_atomic_t m_StatsDriftPpm;
+    SDL_atomic_t m_StatsDroppedPackets;
+};
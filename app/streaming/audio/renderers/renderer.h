@@ -16,6 +16,15 @@ public:
 
     virtual int getCapabilities() = 0;
 
+    // Returns the number of samples (per channel) queued for playback,
+    // or -1 if unknown. Renderers that report this get an adaptive jitter
+    // buffer in front of them that keeps the queue near a target depth, so
+    // they must also accept up to AudioJitterBuffer::getMaxOutputSamples()
+    // samples per packet rather than exactly one frame.
+    virtual int getQueuedSamples() {
+        return -1;
+    }
+
     virtual void remapChannels(POPUS_MULTISTREAM_CONFIGURATION) {
         // Use default channel mapping:
         // 0 - Front Left
@@ -18,8 +18,12 @@ public:
 
     virtual int getCapabilities();
 
+    virtual int getQueuedSamples();
+
 private:
     SDL_AudioDeviceID m_AudioDevice;
     void* m_AudioBuffer;
     int m_FrameSize;
+    int m_BufferSize;
+    int m_ChannelCount;
 };
@@ -1,11 +1,15 @@
 #include "sdl.h"
+#include "streaming/audio/jitterbuffer.h"
 
 #include <Limelight.h>
 #include <SDL.h>
 
 SdlAudioRenderer::SdlAudioRenderer()
     : m_AudioDevice(0),
-      m_AudioBuffer(nullptr)
+      m_AudioBuffer(nullptr),
+      m_FrameSize(0),
+      m_BufferSize(0),
+      m_ChannelCount(0)
 {
     SDL_assert(!SDL_WasInit(SDL_INIT_AUDIO));
 
@@ -33,6 +37,10 @@ bool SdlAudioRenderer::prepareForPlayback(const OPUS_MULTISTREAM_CONFIGURATION*
     want.samples = opusConfig->samplesPerFrame;
 
     m_FrameSize = opusConfig->samplesPerFrame * sizeof(short) * opusConfig->channelCount;
+    m_ChannelCount = opusConfig->channelCount;
+
+    // Leave room for the jitter buffer to stretch a frame while it slows playback
+    m_BufferSize = AudioJitterBuffer::getMaxOutputSamples(opusConfig->samplesPerFrame) * sizeof(short) * opusConfig->channelCount;
 
     m_AudioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
     if (m_AudioDevice == 0) {
@@ -42,7 +50,7 @@ bool SdlAudioRenderer::prepareForPlayback(const OPUS_MULTISTREAM_CONFIGURATION*
         return false;
     }
 
-    m_AudioBuffer = SDL_malloc(m_FrameSize);
+    m_AudioBuffer = SDL_malloc(m_BufferSize);
     if (m_AudioBuffer == nullptr) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "Failed to allocate audio buffer");
@@ -81,8 +89,9 @@ SdlAudioRenderer::~SdlAudioRenderer()
     SDL_assert(!SDL_WasInit(SDL_INIT_AUDIO));
 }
 
-void* SdlAudioRenderer::getAudioBuffer(int*)
+void* SdlAudioRenderer::getAudioBuffer(int* size)
 {
+    *size = SDL_min(*size, m_BufferSize);
     return m_AudioBuffer;
 }
 
@@ -99,14 +108,8 @@ bool SdlAudioRenderer::submitAudio(int bytesWritten)
         return true;
     }
 
-    // Don't queue if there's already more than 30 ms of audio data waiting
-    // in Moonlight's audio queue.
-    if (LiGetPendingAudioDuration() > 30) {
-        return true;
-    }
-
-    // Provide backpressure on the queue to ensure too many frames don't build up
-    // in SDL's audio queue.
+    // The jitter buffer keeps the queue depth in check, but provide backpressure
+    // as a last resort to ensure too many frames don't build up in SDL's audio queue.
     while (SDL_GetQueuedAudioSize(m_AudioDevice) / m_FrameSize > 10) {
         SDL_Delay(1);
     }
@@ -122,6 +125,11 @@ bool SdlAudioRenderer::submitAudio(int bytesWritten)
 
 int SdlAudioRenderer::getCapabilities()
 {
-    // Direct submit can't be used because we use LiGetPendingAudioDuration()
+    // Direct submit can't be used because the jitter buffer uses LiGetPendingAudioDuration()
     return CAPABILITY_SUPPORTS_ARBITRARY_AUDIO_DURATION;
 }
+
+int SdlAudioRenderer::getQueuedSamples()
+{
+    return SDL_GetQueuedAudioSize(m_AudioDevice) / (sizeof(short) * m_ChannelCount);
+}
@@ -317,6 +317,12 @@ bool SoundIoAudioRenderer::submitAudio(int bytesWritten)
     return true;
 }
 
+int SoundIoAudioRenderer::getQueuedSamples()
+{
+    return soundio_ring_buffer_fill_count(m_RingBuffer) /
+            (m_OpusChannelCount * m_OutputStream->bytes_per_sample);
+}
+
 int SoundIoAudioRenderer::getCapabilities()
 {
     // TODO: Tweak buffer sizes then re-enable arbitrary audio duration
@@ -35,6 +35,7 @@
 #include <QImage>
 #include <QGuiApplication>
 #include <QCursor>
+#include <QFile>
 
 #define CONN_TEST_SERVER "qt.conntest.moonlight-stream.org"
 
@@ -491,6 +492,8 @@ bool Session::initialize()
         }
     }
 
+    m_FrameTracer.setEnabled(!m_Preferences->frameTracePath.isEmpty());
+
     qInfo() << "Server GPU:" << m_Computer->gpuModel;
     qInfo() << "Server GFE version:" << m_Computer->gfeVersion;
 
@@ -1218,6 +1221,20 @@ bool Session::startConnectionAsync()
         }
     }
 
+    // Record the raw packets of this stream if requested
+    QByteArray packetCapturePath = QFile::encodeName(m_Preferences->packetCapturePath);
+    LiSetPacketCaptureFile(packetCapturePath.isEmpty() ? nullptr : packetCapturePath.constData(),
+                           m_Preferences->packetCaptureIncludeKeys);
+
+    // Simulate a lossy network if requested. The config was validated on the command line.
+    QByteArray networkImpairment = m_Preferences->networkImpairment.toUtf8();
+    LiSetNetworkImpairment(networkImpairment.isEmpty() ? nullptr : networkImpairment.constData());
+
+    // Run FEC recovery and depacketization on their own thread if requested, so
+    // the receive thread can always keep the socket drained. This costs a thread
+    // handoff per packet, so it's off unless the user opts in.
+    LiSetVideoPipelining(m_Preferences->videoPipelining);
+
     int err = LiStartConnection(&hostInfo, &m_StreamConfig, &k_ConnCallbacks,
                                 &m_VideoCallbacks,
                                 m_AudioDisabled ? nullptr : &m_AudioCallbacks,
@@ -1788,6 +1805,11 @@ DispatchDeferredCleanup:
     m_VideoDecoder = nullptr;
     SDL_AtomicUnlock(&m_DecoderLock);
 
+    // Dump the frame trace now that nothing else can record into it
+    if (m_FrameTracer.isEnabled()) {
+        m_FrameTracer.writeChromeTrace(m_Preferences->frameTracePath);
+    }
+
     // This must be called after the decoder is deleted, because
     // the renderer may want to interact with the window
     SDL_DestroyWindow(m_Window);
@@ -8,7 +8,9 @@
 #include "input/input.h"
 #include "video/decoder.h"
 #include "audio/renderers/renderer.h"
+#include "audio/jitterbuffer.h"
 #include "video/overlaymanager.h"
+#include "video/frametracer.h"
 
 class Session : public QObject
 {
@@ -43,6 +45,16 @@ public:
         return m_OverlayManager;
     }
 
+    FrameTracer& getFrameTracer()
+    {
+        return m_FrameTracer;
+    }
+
+    AudioJitterBuffer& getAudioJitterBuffer()
+    {
+        return m_AudioJitterBuffer;
+    }
+
     void flushWindowEvents();
 
     bool getAndClearPendingIdrFrameStatus();
@@ -182,9 +194,12 @@ private:
     OPUS_MULTISTREAM_CONFIGURATION m_AudioConfig;
     int m_AudioSampleCount;
     Uint32 m_DropAudioEndTime;
+    AudioJitterBuffer m_AudioJitterBuffer;
 
     Overlay::OverlayManager m_OverlayManager;
 
+    FrameTracer m_FrameTracer;
+
     static CONNECTION_LISTENER_CALLBACKS k_ConnCallbacks;
     static Session* s_ActiveSession;
     static QSemaphore s_ActiveSessionSemaphore;
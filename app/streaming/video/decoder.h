@@ -3,6 +3,7 @@
 #include <Limelight.h>
 #include <SDL.h>
 #include "settings/streamingpreferences.h"
+#include "latencyhistogram.h"
 
 #define SDL_CODE_FRAME_READY 0
 
@@ -15,10 +16,15 @@ typedef struct _VIDEO_STATS {
     uint32_t totalFrames;
     uint32_t networkDroppedFrames;
     uint32_t pacerDroppedFrames;
-    uint32_t totalReassemblyTime;
-    uint32_t totalDecodeTime;
-    uint32_t totalPacerTime;
-    uint32_t totalRenderTime;
+    LatencyHistogram reassemblyTimeHistogram;
+    LatencyHistogram decodeTimeHistogram;
+    LatencyHistogram pacerTimeHistogram;
+    LatencyHistogram renderTimeHistogram;
+    uint64_t totalDecoderIdleTimeUs;
+    uint64_t totalDecoderWaitTimeUs;
+    uint32_t importedFrames;
+    uint32_t importSurfacesCreated;
+    uint64_t totalImportTimeUs;
     uint32_t lastRtt;
     uint32_t lastRttVariance;
     float totalFps;
@@ -0,0 +1,164 @@
+#include "decoderprobecache.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSysInfo>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+}
+
+#ifdef Q_OS_WIN32
+#include <dxgi.h>
+#endif
+
+#define SER_DECODERPROBECACHE "decoderprobecache"
+#define SER_SYSTEMID "systemid"
+#define SER_ENTRIES "entries"
+
+QString DecoderProbeCache::getSystemId()
+{
+    static QString systemId;
+
+    if (!systemId.isEmpty()) {
+        return systemId;
+    }
+
+    QStringList parts;
+
+    // A new build of Moonlight may try decoders in a different order
+    parts.append(QCoreApplication::applicationVersion());
+    parts.append(av_version_info());
+    parts.append(QString::number(avcodec_version()));
+    parts.append(SDL_GetCurrentVideoDriver() ? SDL_GetCurrentVideoDriver() : "");
+    parts.append(QSysInfo::kernelVersion());
+    parts.append(QSysInfo::productVersion());
+
+#if defined(Q_OS_WIN32)
+    IDXGIFactory1* factory;
+    if (SUCCEEDED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&factory))) {
+        IDXGIAdapter1* adapter;
+        for (UINT i = 0; factory->EnumAdapters1(i, &adapter) != DXGI_ERROR_NOT_FOUND; i++) {
+            DXGI_ADAPTER_DESC1 desc;
+            LARGE_INTEGER driverVersion = {};
+
+            // IDXGIDevice is the only interface that reports the UMD version
+            adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+            if (SUCCEEDED(adapter->GetDesc1(&desc))) {
+                parts.append(QString("%1:%2:%3")
+                             .arg(desc.VendorId, 0, 16)
+                             .arg(desc.DeviceId, 0, 16)
+                             .arg(driverVersion.QuadPart, 0, 16));
+            }
+            adapter->Release();
+        }
+        factory->Release();
+    }
+#elif defined(Q_OS_LINUX)
+    // The GPU driver is part of the kernel, but Mesa isn't. A Mesa update
+    // that breaks the cached choice is caught when it fails to initialize.
+    QDir drmDir("/sys/class/drm");
+    for (const QString& card : drmDir.entryList(QStringList("card?"), QDir::Dirs | QDir::System)) {
+        QString devicePath = drmDir.filePath(card + "/device/");
+        QFile vendor(devicePath + "vendor");
+        QFile device(devicePath + "device");
+
+        vendor.open(QIODevice::ReadOnly);
+        device.open(QIODevice::ReadOnly);
+        parts.append(QString("%1:%2:%3")
+                     .arg(QString(vendor.readAll().trimmed()),
+                          QString(device.readAll().trimmed()),
+                          QFileInfo(devicePath + "driver").symLinkTarget().section('/', -1)));
+    }
+#endif
+
+    systemId = parts.join('|');
+    return systemId;
+}
+
+void DecoderProbeCache::validateEntries()
+{
+    static bool validated = false;
+
+    if (validated) {
+        return;
+    }
+
+    QSettings settings;
+    QString systemId = getSystemId();
+
+    settings.beginGroup(SER_DECODERPROBECACHE);
+    if (settings.value(SER_SYSTEMID).toString() != systemId) {
+        if (settings.contains(SER_SYSTEMID)) {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "GPU, driver, or FFmpeg changed. Decoders will be probed again.");
+        }
+
+        settings.remove(SER_ENTRIES);
+        settings.setValue(SER_SYSTEMID, systemId);
+    }
+    settings.endGroup();
+
+    validated = true;
+}
+
+QString DecoderProbeCache::getKey(PDECODER_PARAMETERS params)
+{
+    int displayIndex = SDL_GetWindowDisplayIndex(params->window);
+    const char* displayName = SDL_GetDisplayName(displayIndex);
+    SDL_DisplayMode mode = {};
+
+    SDL_GetCurrentDisplayMode(displayIndex, &mode);
+
+    QString key = QString("%1|%2x%3x%4|%5|%6x%7x%8|%9")
+            .arg(displayName ? displayName : "")
+            .arg(mode.w).arg(mode.h).arg(mode.refresh_rate)
+            .arg(params->videoFormat)
+            .arg(params->width).arg(params->height).arg(params->frameRate)
+            .arg(params->vds);
+
+    // QSettings treats slashes in keys as groups
+    return QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+bool DecoderProbeCache::lookup(const QString& key, Choice& choice, int& probeTimeMs)
+{
+    validateEntries();
+
+    QSettings settings;
+    QStringList entry = settings.value(QString(SER_DECODERPROBECACHE "/" SER_ENTRIES "/%1").arg(key)).toStringList();
+    if (entry.size() != 5) {
+        return false;
+    }
+
+    choice.method = (Method)entry[0].toInt();
+    choice.decoderName = entry[1];
+    choice.deviceType = entry[2].toInt();
+    choice.pass = entry[3].toInt();
+    probeTimeMs = entry[4].toInt();
+    return true;
+}
+
+void DecoderProbeCache::store(const QString& key, const Choice& choice, int probeTimeMs)
+{
+    validateEntries();
+
+    QSettings settings;
+    settings.setValue(QString(SER_DECODERPROBECACHE "/" SER_ENTRIES "/%1").arg(key),
+                      QStringList() << QString::number(choice.method)
+                                    << choice.decoderName
+                                    << QString::number(choice.deviceType)
+                                    << QString::number(choice.pass)
+                                    << QString::number(probeTimeMs));
+}
+
+void DecoderProbeCache::remove(const QString& key)
+{
+    QSettings settings;
+    settings.remove(QString(SER_DECODERPROBECACHE "/" SER_ENTRIES "/%1").arg(key));
+}
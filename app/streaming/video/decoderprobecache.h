@@ -0,0 +1,50 @@
+#pragma once
+
+#include "decoder.h"
+
+#include <QString>
+
+// Remembers which decoder and renderer combination worked for a given
+// GPU, driver, FFmpeg build, display, and stream configuration. Probing
+// every hwaccel (often with a test frame each) is the slowest part of
+// stream startup, so later launches try the known-good choice first and
+// only fall back to a full probe if it fails or anything in the key changed.
+class DecoderProbeCache
+{
+public:
+    enum Method {
+        // An FFmpeg hwaccel (deviceType) on the decoder
+        Hwaccel,
+
+        // A standalone hardware decoder like h264_rkmpp
+        NamedDecoder,
+
+        // FFmpeg's software decoder
+        Software,
+    };
+
+    struct Choice {
+        Method method;
+        QString decoderName;
+        int deviceType;
+        int pass;
+    };
+
+    // Returns the key for these decoder parameters on the current system
+    static QString getKey(PDECODER_PARAMETERS params);
+
+    // Returns the cached choice and how long the full probe that found it took
+    static bool lookup(const QString& key, Choice& choice, int& probeTimeMs);
+
+    static void store(const QString& key, const Choice& choice, int probeTimeMs);
+
+    static void remove(const QString& key);
+
+private:
+    // Identifies everything outside of the stream configuration that can
+    // change which decoders work: GPUs, drivers, and the FFmpeg build.
+    static QString getSystemId();
+
+    // Drops all entries if the system has changed since they were probed
+    static void validateEntries();
+};
@@ -41,8 +41,14 @@ DrmRenderer::DrmRenderer(IFFmpegRenderer *backendRenderer)
       m_ConnectorId(0),
       m_EncoderId(0),
       m_CrtcId(0),
+      m_CrtcIndex(-1),
       m_PlaneId(0),
       m_CurrentFbId(0),
+      m_FramebufferCacheClock(0),
+      m_FramebufferCacheHwFrames(nullptr),
+      m_ImportedFrames(0),
+      m_FramebuffersCreated(0),
+      m_TotalImportTimeUs(0),
       m_LastColorRange(AVCOL_RANGE_UNSPECIFIED),
       m_LastColorSpace(AVCOL_SPC_UNSPECIFIED),
       m_ColorEncodingProp(nullptr),
@@ -50,6 +56,9 @@ DrmRenderer::DrmRenderer(IFFmpegRenderer *backendRenderer)
       m_HdrOutputMetadataProp(nullptr),
       m_HdrOutputMetadataBlobId(0)
 {
+    SDL_zero(m_FramebufferCache);
+    SDL_zero(m_GemHandles);
+
 #ifdef HAVE_EGL
     m_EGLExtDmaBuf = false;
     m_eglCreateImage = nullptr;
@@ -64,8 +73,16 @@ DrmRenderer::~DrmRenderer()
     // Ensure we're out of HDR mode
     setHdrMode(false);
 
-    if (m_CurrentFbId != 0) {
-        drmModeRmFB(m_DrmFd, m_CurrentFbId);
+#ifdef HAVE_EGL
+    // Cached images hold GEM handles on our FD
+    m_EGLImageCache.flush();
+#endif
+
+    // This includes the current FB
+    for (CachedFramebuffer& entry : m_FramebufferCache) {
+        if (entry.fbId != 0) {
+            releaseFramebuffer(entry);
+        }
     }
 
     if (m_HdrOutputMetadataBlobId != 0) {
@@ -256,11 +273,11 @@ bool DrmRenderer::initialize(PDECODER_PARAMETERS params)
         return DIRECT_RENDERING_INIT_FAILED;
     }
 
-    int crtcIndex = -1;
+    m_CrtcIndex = -1;
     for (int i = 0; i < resources->count_crtcs; i++) {
         if (resources->crtcs[i] == m_CrtcId) {
             drmModeCrtc* crtc = drmModeGetCrtc(m_DrmFd, resources->crtcs[i]);
-            crtcIndex = i;
+            m_CrtcIndex = i;
             m_OutputRect.x = m_OutputRect.y = 0;
             m_OutputRect.w = crtc->width;
             m_OutputRect.h = crtc->height;
@@ -271,7 +288,7 @@ bool DrmRenderer::initialize(PDECODER_PARAMETERS params)
 
     drmModeFreeResources(resources);
 
-    if (crtcIndex == -1) {
+    if (m_CrtcIndex == -1) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "Failed to get CRTC!");
         return DIRECT_RENDERING_INIT_FAILED;
@@ -321,7 +338,7 @@ bool DrmRenderer::initialize(PDECODER_PARAMETERS params)
                 continue;
             }
 
-            if ((plane->possible_crtcs & (1 << crtcIndex)) && plane->crtc_id == 0) {
+            if ((plane->possible_crtcs & (1 << m_CrtcIndex)) && plane->crtc_id == 0) {
                 drmModeObjectPropertiesPtr props = drmModeObjectGetProperties(m_DrmFd, planeRes->planes[i], DRM_MODE_OBJECT_PLANE);
                 if (props != nullptr) {
                     for (uint32_t j = 0; j < props->count_props; j++) {
@@ -470,6 +487,223 @@ void DrmRenderer::setHdrMode(bool enabled)
     }
 }
 
+void DrmRenderer::collectRendererStats(VIDEO_STATS& stats)
+{
+    stats.importedFrames += m_ImportedFrames;
+    stats.importSurfacesCreated += m_FramebuffersCreated;
+    stats.totalImportTimeUs += m_TotalImportTimeUs;
+    m_ImportedFrames = 0;
+    m_FramebuffersCreated = 0;
+    m_TotalImportTimeUs = 0;
+
+#ifdef HAVE_EGL
+    // Images created while we're the backend of the EGL renderer
+    stats.importSurfacesCreated += m_EGLImageCache.takeCreatedCount();
+#endif
+}
+
+void DrmRenderer::refGemHandles(const uint32_t handles[4])
+{
+    for (int i = 0; i < 4; i++) {
+        bool duplicate = false;
+
+        // Planes in the same object share a handle, but it's one reference
+        for (int j = 0; j < i; j++) {
+            duplicate |= handles[j] == handles[i];
+        }
+        if (handles[i] == 0 || duplicate) {
+            continue;
+        }
+
+        GemHandleRef* slot = nullptr;
+        for (GemHandleRef& ref : m_GemHandles) {
+            if (ref.refs != 0 && ref.handle == handles[i]) {
+                slot = &ref;
+                break;
+            }
+            else if (ref.refs == 0 && slot == nullptr) {
+                slot = &ref;
+            }
+        }
+
+        // There's room for every handle in both caches
+        SDL_assert(slot != nullptr);
+        if (slot != nullptr) {
+            slot->handle = handles[i];
+            slot->refs++;
+        }
+    }
+}
+
+// Drops references taken by refGemHandles() and closes the handles that
+// no cached framebuffer or EGLImage is using anymore
+void DrmRenderer::unrefGemHandles(const uint32_t handles[4])
+{
+    for (int i = 0; i < 4; i++) {
+        bool duplicate = false;
+
+        for (int j = 0; j < i; j++) {
+            duplicate |= handles[j] == handles[i];
+        }
+        if (handles[i] == 0 || duplicate) {
+            continue;
+        }
+
+        for (GemHandleRef& ref : m_GemHandles) {
+            if (ref.refs != 0 && ref.handle == handles[i]) {
+                if (--ref.refs == 0) {
+                    struct drm_gem_close gemClose = {};
+
+                    gemClose.handle = ref.handle;
+                    drmIoctl(m_DrmFd, DRM_IOCTL_GEM_CLOSE, &gemClose);
+                }
+                break;
+            }
+        }
+    }
+}
+
+// Gets the GEM handle of each plane's dmabuf. Importing the same buffer
+// again returns the handle it already has, so handles identify buffers
+// even when the FD is different each time the surface is exported.
+bool DrmRenderer::importGemHandles(AVDRMFrameDescriptor* drmFrame, uint32_t handles[4])
+{
+    const auto &layer = drmFrame->layers[0];
+
+    for (int i = 0; i < layer.nb_planes; i++) {
+        const auto &object = drmFrame->objects[layer.planes[i].object_index];
+
+        int err = drmPrimeFDToHandle(m_DrmFd, object.fd, &handles[i]);
+        if (err < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "drmPrimeFDToHandle() failed: %d",
+                         errno);
+
+            // Close any handles we just opened that nothing else is using
+            refGemHandles(handles);
+            unrefGemHandles(handles);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void DrmRenderer::releaseFramebuffer(CachedFramebuffer& entry)
+{
+    drmModeRmFB(m_DrmFd, entry.fbId);
+    unrefGemHandles(entry.key.handles);
+    SDL_zero(entry);
+}
+
+void DrmRenderer::flushFramebufferCache()
+{
+    for (CachedFramebuffer& entry : m_FramebufferCache) {
+        // The current FB is still being scanned out, so it stays in the
+        // cache until it's evicted after being replaced on the plane.
+        if (entry.fbId != 0 && entry.fbId != m_CurrentFbId) {
+            releaseFramebuffer(entry);
+        }
+    }
+}
+
+// Returns a FB for the frame, creating one only if we haven't seen this
+// decoder surface before. Returns 0 on failure.
+uint32_t DrmRenderer::getFramebuffer(AVFrame* frame, AVDRMFrameDescriptor* drmFrame)
+{
+    // A new hwframes context means the old surfaces are gone for good, so
+    // free their FBs now rather than waiting for them to be evicted. The
+    // keys identify the buffers themselves, so a recycled context pointer
+    // only delays this.
+    void* hwFrames = frame->hw_frames_ctx != nullptr ? frame->hw_frames_ctx->data : nullptr;
+    if (hwFrames != m_FramebufferCacheHwFrames) {
+        flushFramebufferCache();
+        m_FramebufferCacheHwFrames = hwFrames;
+    }
+
+    // DRM requires composed layers rather than separate layers per plane
+    SDL_assert(drmFrame->nb_layers == 1);
+
+    const auto &layer = drmFrame->layers[0];
+    FramebufferKey key;
+    uint32_t flags = 0;
+
+    // Zero the padding too, since keys are compared with memcmp()
+    SDL_zero(key);
+    key.width = frame->width;
+    key.height = frame->height;
+    key.format = layer.format;
+
+    if (!importGemHandles(drmFrame, key.handles)) {
+        return 0;
+    }
+
+    for (int i = 0; i < layer.nb_planes; i++) {
+        const auto &object = drmFrame->objects[layer.planes[i].object_index];
+
+        key.pitches[i] = layer.planes[i].pitch;
+        key.offsets[i] = layer.planes[i].offset;
+        key.modifiers[i] = object.format_modifier;
+
+        // Pass along the modifiers to DRM if there are some in the descriptor
+        if (key.modifiers[i] != DRM_FORMAT_MOD_INVALID) {
+            flags |= DRM_MODE_FB_MODIFIERS;
+        }
+    }
+
+    m_ImportedFrames++;
+
+    // Look for an existing FB, remembering the least recently used one
+    // that we can evict if we need to make room for a new FB.
+    CachedFramebuffer* victim = nullptr;
+    for (CachedFramebuffer& entry : m_FramebufferCache) {
+        if (entry.fbId != 0 && memcmp(&entry.key, &key, sizeof(key)) == 0) {
+            entry.lastUsed = ++m_FramebufferCacheClock;
+            return entry.fbId;
+        }
+        else if (entry.fbId == m_CurrentFbId && entry.fbId != 0) {
+            // Never evict the FB that's on screen
+            continue;
+        }
+        else if (victim == nullptr || entry.fbId == 0 ||
+                 (victim->fbId != 0 && entry.lastUsed < victim->lastUsed)) {
+            victim = &entry;
+        }
+    }
+
+    SDL_assert(victim != nullptr);
+
+    // The new entry holds a reference on its handles
+    refGemHandles(key.handles);
+
+    // Create a frame buffer object from the PRIME buffer
+    // NB: It is an error to pass modifiers without DRM_MODE_FB_MODIFIERS set.
+    uint32_t fbId;
+    int err = drmModeAddFB2WithModifiers(m_DrmFd, frame->width, frame->height,
+                                         layer.format,
+                                         key.handles, key.pitches, key.offsets,
+                                         (flags & DRM_MODE_FB_MODIFIERS) ? key.modifiers : NULL,
+                                         &fbId, flags);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "drmModeAddFB2WithModifiers() failed: %d",
+                     errno);
+        unrefGemHandles(key.handles);
+        return 0;
+    }
+
+    if (victim->fbId != 0) {
+        releaseFramebuffer(*victim);
+    }
+
+    victim->key = key;
+    victim->fbId = fbId;
+    victim->lastUsed = ++m_FramebufferCacheClock;
+    m_FramebuffersCreated++;
+
+    return fbId;
+}
+
 void DrmRenderer::renderFrame(AVFrame* frame)
 {
     AVDRMFrameDescriptor mappedFrame;
@@ -491,12 +725,6 @@ void DrmRenderer::renderFrame(AVFrame* frame)
     }
 
     int err;
-    uint32_t handles[4] = {};
-    uint32_t pitches[4] = {};
-    uint32_t offsets[4] = {};
-    uint64_t modifiers[4] = {};
-    uint32_t flags = 0;
-
     SDL_Rect src, dst;
 
     src.x = src.y = 0;
@@ -506,57 +734,16 @@ void DrmRenderer::renderFrame(AVFrame* frame)
 
     StreamUtils::scaleSourceToDestinationSurface(&src, &dst);
 
-    // DRM requires composed layers rather than separate layers per plane
-    SDL_assert(drmFrame->nb_layers == 1);
-
-    const auto &layer = drmFrame->layers[0];
-    for (int i = 0; i < layer.nb_planes; i++) {
-        const auto &object = drmFrame->objects[layer.planes[i].object_index];
-
-        err = drmPrimeFDToHandle(m_DrmFd, object.fd, &handles[i]);
-        if (err < 0) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "drmPrimeFDToHandle() failed: %d",
-                         errno);
-            if (m_BackendRenderer != nullptr) {
-                SDL_assert(drmFrame == &mappedFrame);
-                m_BackendRenderer->unmapDrmPrimeFrame(drmFrame);
-            }
-            return;
-        }
-
-        pitches[i] = layer.planes[i].pitch;
-        offsets[i] = layer.planes[i].offset;
-        modifiers[i] = object.format_modifier;
-
-        // Pass along the modifiers to DRM if there are some in the descriptor
-        if (modifiers[i] != DRM_FORMAT_MOD_INVALID) {
-            flags |= DRM_MODE_FB_MODIFIERS;
-        }
-    }
-
-    // Remember the last FB object we created so we can free it
-    // when we are finished rendering this one (if successful).
-    uint32_t lastFbId = m_CurrentFbId;
-
-    // Create a frame buffer object from the PRIME buffer
-    // NB: It is an error to pass modifiers without DRM_MODE_FB_MODIFIERS set.
-    err = drmModeAddFB2WithModifiers(m_DrmFd, frame->width, frame->height,
-                                     drmFrame->layers[0].format,
-                                     handles, pitches, offsets,
-                                     (flags & DRM_MODE_FB_MODIFIERS) ? modifiers : NULL,
-                                     &m_CurrentFbId, flags);
+    Uint64 importStartTime = SDL_GetPerformanceCounter();
+    uint32_t fbId = getFramebuffer(frame, drmFrame);
+    m_TotalImportTimeUs += ((SDL_GetPerformanceCounter() - importStartTime) * 1000000) / SDL_GetPerformanceFrequency();
 
     if (m_BackendRenderer != nullptr) {
         SDL_assert(drmFrame == &mappedFrame);
         m_BackendRenderer->unmapDrmPrimeFrame(drmFrame);
     }
 
-    if (err < 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "drmModeAddFB2WithModifiers() failed: %d",
-                     errno);
-        m_CurrentFbId = lastFbId;
+    if (fbId == 0) {
         return;
     }
 
@@ -645,7 +832,7 @@ void DrmRenderer::renderFrame(AVFrame* frame)
     }
 
     // Update the overlay
-    err = drmModeSetPlane(m_DrmFd, m_PlaneId, m_CrtcId, m_CurrentFbId, 0,
+    err = drmModeSetPlane(m_DrmFd, m_PlaneId, m_CrtcId, fbId, 0,
                           dst.x, dst.y,
                           dst.w, dst.h,
                           0, 0,
@@ -655,13 +842,11 @@ void DrmRenderer::renderFrame(AVFrame* frame)
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "drmModeSetPlane() failed: %d",
                      errno);
-        drmModeRmFB(m_DrmFd, m_CurrentFbId);
-        m_CurrentFbId = lastFbId;
         return;
     }
 
-    // Free the previous FB object which has now been superseded
-    drmModeRmFB(m_DrmFd, lastFbId);
+    // The previous FB stays cached for when its surface comes around again
+    m_CurrentFbId = fbId;
 }
 
 bool DrmRenderer::needsTestFrame()
@@ -695,6 +880,19 @@ bool DrmRenderer::isDirectRenderingSupported()
     return m_SupportsDirectRendering;
 }
 
+bool DrmRenderer::getScanoutCrtc(int* drmFd, int* crtcIndex)
+{
+    // We only know which CRTC the video ends up on if we're putting
+    // it on a plane ourselves.
+    if (!m_SupportsDirectRendering) {
+        return false;
+    }
+
+    *drmFd = m_DrmFd;
+    *crtcIndex = m_CrtcIndex;
+    return true;
+}
+
 const char* DrmRenderer::getDrmColorEncodingValue(AVFrame* frame)
 {
     switch (frame->colorspace) {
@@ -773,9 +971,23 @@ bool DrmRenderer::initializeEGL(EGLDisplay,
         return false;
     }
 
+    m_EGLImageCache.initialize(m_eglDestroyImage, m_eglDestroyImageKHR,
+                               eglImageDestroyed, this);
     return true;
 }
 
+void DrmRenderer::eglImageDestroyed(const EGLImageCache::Key& key, void* context)
+{
+    auto me = (DrmRenderer*)context;
+    uint32_t handles[4];
+
+    for (int i = 0; i < 4; i++) {
+        handles[i] = (uint32_t)key.surfaceIds[i];
+    }
+
+    me->unrefGemHandles(handles);
+}
+
 ssize_t DrmRenderer::exportEGLImages(AVFrame *frame, EGLDisplay dpy,
                                      EGLImage images[EGL_MAX_PLANES]) {
     AVDRMFrameDescriptor* drmFrame = (AVDRMFrameDescriptor*)frame->data[0];
@@ -785,6 +997,33 @@ ssize_t DrmRenderer::exportEGLImages(AVFrame *frame, EGLDisplay dpy,
     // DRM requires composed layers rather than separate layers per plane
     SDL_assert(drmFrame->nb_layers == 1);
 
+    // Reuse the EGLImage from the last time we saw this surface. The surface
+    // is identified by its GEM handles, like our cached FBs. The colorspace
+    // and range are part of the key since they are baked into the image.
+    uint32_t handles[4] = {};
+    if (!importGemHandles(drmFrame, handles)) {
+        return -1;
+    }
+
+    EGLImageCache::Key key;
+    SDL_zero(key);
+    key.hwFrames = frame->hw_frames_ctx != nullptr ? frame->hw_frames_ctx->data : nullptr;
+    key.width = frame->width;
+    key.height = frame->height;
+    key.colorspace = frame->colorspace;
+    key.colorRange = frame->color_range;
+
+    for (int i = 0; i < 4; i++) {
+        key.surfaceIds[i] = handles[i];
+    }
+
+    if (m_EGLImageCache.lookup(key, images) > 0) {
+        return 1;
+    }
+
+    // The cached image holds a reference on the handles until it's destroyed
+    refGemHandles(handles);
+
     // Max 30 attributes (1 key + 1 value for each)
     const int MAX_ATTRIB_COUNT = 30 * 2;
     EGLAttrib attribs[MAX_ATTRIB_COUNT] = {
@@ -911,7 +1150,8 @@ ssize_t DrmRenderer::exportEGLImages(AVFrame *frame, EGLDisplay dpy,
         if (!images[0]) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "eglCreateImage() Failed: %d", eglGetError());
-            goto fail;
+            unrefGemHandles(handles);
+            return -1;
         }
     }
     else {
@@ -927,24 +1167,17 @@ ssize_t DrmRenderer::exportEGLImages(AVFrame *frame, EGLDisplay dpy,
         if (!images[0]) {
             SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                          "eglCreateImageKHR() Failed: %d", eglGetError());
-            goto fail;
+            unrefGemHandles(handles);
+            return -1;
         }
     }
 
+    m_EGLImageCache.insert(dpy, key, images, 1);
     return 1;
-
-fail:
-    freeEGLImages(dpy, images);
-    return -1;
 }
 
-void DrmRenderer::freeEGLImages(EGLDisplay dpy, EGLImage images[EGL_MAX_PLANES]) {
-    if (m_eglDestroyImage) {
-        m_eglDestroyImage(dpy, images[0]);
-    }
-    else {
-        m_eglDestroyImageKHR(dpy, images[0]);
-    }
+void DrmRenderer::freeEGLImages(EGLDisplay, EGLImage images[EGL_MAX_PLANES]) {
+    // The image stays alive in m_EGLImageCache until its surface goes away
 
     // Our EGLImages are non-planar
     SDL_assert(images[1] == 0);
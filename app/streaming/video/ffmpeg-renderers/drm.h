@@ -2,6 +2,10 @@
 
 #include "renderer.h"
 
+#ifdef HAVE_EGL
+#include "eglimagecache.h"
+#endif
+
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
@@ -55,6 +59,8 @@ public:
     virtual bool testRenderFrame(AVFrame* frame) override;
     virtual bool isDirectRenderingSupported() override;
     virtual void setHdrMode(bool enabled) override;
+    virtual void collectRendererStats(VIDEO_STATS& stats) override;
+    virtual bool getScanoutCrtc(int* drmFd, int* crtcIndex) override;
 #ifdef HAVE_EGL
     virtual bool canExportEGL() override;
     virtual AVPixelFormat getEGLImagePixelFormat() override;
@@ -64,8 +70,48 @@ public:
 #endif
 
 private:
+    // Identifies a decoder surface by the GEM handles of its dmabufs and its
+    // plane layout. We hold the handles open while they're in a cache, so the
+    // kernel can't hand the same handle out for a different buffer.
+    struct FramebufferKey {
+        uint32_t handles[4];
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        uint32_t pitches[4];
+        uint32_t offsets[4];
+        uint64_t modifiers[4];
+    };
+
+    struct CachedFramebuffer {
+        FramebufferKey key;
+        uint32_t fbId;
+        uint64_t lastUsed;
+    };
+
+    // Decoders recycle a small pool of surfaces, so this is enough to hold
+    // a framebuffer for each of them without ever creating a new one.
+    static const int k_MaxCachedFramebuffers = 32;
+
+    // Each cached framebuffer or EGLImage holds up to 4 handles
+    static const int k_MaxGemHandles = 2 * k_MaxCachedFramebuffers * 4;
+
+    struct GemHandleRef {
+        uint32_t handle;
+        uint32_t refs;
+    };
+
     const char* getDrmColorEncodingValue(AVFrame* frame);
     const char* getDrmColorRangeValue(AVFrame* frame);
+    uint32_t getFramebuffer(AVFrame* frame, AVDRMFrameDescriptor* drmFrame);
+    void flushFramebufferCache();
+    void releaseFramebuffer(CachedFramebuffer& entry);
+    bool importGemHandles(AVDRMFrameDescriptor* drmFrame, uint32_t handles[4]);
+    void refGemHandles(const uint32_t handles[4]);
+    void unrefGemHandles(const uint32_t handles[4]);
+#ifdef HAVE_EGL
+    static void eglImageDestroyed(const EGLImageCache::Key& key, void* context);
+#endif
 
     IFFmpegRenderer* m_BackendRenderer;
     AVBufferRef* m_HwContext;
@@ -76,8 +122,16 @@ private:
     uint32_t m_ConnectorId;
     uint32_t m_EncoderId;
     uint32_t m_CrtcId;
+    int m_CrtcIndex;
     uint32_t m_PlaneId;
     uint32_t m_CurrentFbId;
+    CachedFramebuffer m_FramebufferCache[k_MaxCachedFramebuffers];
+    uint64_t m_FramebufferCacheClock;
+    void* m_FramebufferCacheHwFrames;
+    GemHandleRef m_GemHandles[k_MaxGemHandles];
+    uint32_t m_ImportedFrames;
+    uint32_t m_FramebuffersCreated;
+    uint64_t m_TotalImportTimeUs;
     AVColorRange m_LastColorRange;
     AVColorSpace m_LastColorSpace;
     drmModePropertyPtr m_ColorEncodingProp;
@@ -92,6 +146,7 @@ private:
     PFNEGLDESTROYIMAGEPROC m_eglDestroyImage;
     PFNEGLCREATEIMAGEKHRPROC m_eglCreateImageKHR;
     PFNEGLDESTROYIMAGEKHRPROC m_eglDestroyImageKHR;
+    EGLImageCache m_EGLImageCache;
 #endif
 };
 
@@ -0,0 +1,112 @@
+#include "eglimagecache.h"
+
+EGLImageCache::EGLImageCache()
+    : m_Display(EGL_NO_DISPLAY),
+      m_HwFrames(nullptr),
+      m_Clock(0),
+      m_CreatedCount(0),
+      m_eglDestroyImage(nullptr),
+      m_eglDestroyImageKHR(nullptr),
+      m_EntryDestroyedCallback(nullptr),
+      m_CallbackContext(nullptr)
+{
+    SDL_zero(m_Entries);
+}
+
+EGLImageCache::~EGLImageCache()
+{
+    flush();
+}
+
+void EGLImageCache::initialize(PFNEGLDESTROYIMAGEPROC eglDestroyImage,
+                               PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR,
+                               EntryDestroyedCallback entryDestroyedCallback,
+                               void* callbackContext)
+{
+    m_eglDestroyImage = eglDestroyImage;
+    m_eglDestroyImageKHR = eglDestroyImageKHR;
+    m_EntryDestroyedCallback = entryDestroyedCallback;
+    m_CallbackContext = callbackContext;
+}
+
+void EGLImageCache::destroyEntry(Entry& entry)
+{
+    if (entry.count == 0) {
+        return;
+    }
+
+    for (ssize_t i = 0; i < entry.count; i++) {
+        if (m_eglDestroyImage) {
+            m_eglDestroyImage(m_Display, entry.images[i]);
+        }
+        else {
+            m_eglDestroyImageKHR(m_Display, entry.images[i]);
+        }
+    }
+
+    entry.count = 0;
+
+    if (m_EntryDestroyedCallback != nullptr) {
+        m_EntryDestroyedCallback(entry.key, m_CallbackContext);
+    }
+}
+
+ssize_t EGLImageCache::lookup(const Key& key, EGLImage images[EGL_MAX_PLANES])
+{
+    // The old surfaces are gone for good once the hwframes context changes
+    if (key.hwFrames != m_HwFrames) {
+        flush();
+        m_HwFrames = key.hwFrames;
+    }
+
+    for (Entry& entry : m_Entries) {
+        if (entry.count != 0 && memcmp(&entry.key, &key, sizeof(key)) == 0) {
+            entry.lastUsed = ++m_Clock;
+            memcpy(images, entry.images, sizeof(entry.images));
+            return entry.count;
+        }
+    }
+
+    return 0;
+}
+
+void EGLImageCache::insert(EGLDisplay dpy, const Key& key, EGLImage images[EGL_MAX_PLANES], ssize_t count)
+{
+    SDL_assert(count > 0 && count <= EGL_MAX_PLANES);
+    SDL_assert(m_Display == EGL_NO_DISPLAY || m_Display == dpy);
+    m_Display = dpy;
+
+    // Use an empty entry or evict the least recently used one
+    Entry* victim = &m_Entries[0];
+    for (Entry& entry : m_Entries) {
+        if (entry.count == 0) {
+            victim = &entry;
+            break;
+        }
+        else if (entry.lastUsed < victim->lastUsed) {
+            victim = &entry;
+        }
+    }
+
+    destroyEntry(*victim);
+
+    victim->key = key;
+    memcpy(victim->images, images, sizeof(victim->images));
+    victim->count = count;
+    victim->lastUsed = ++m_Clock;
+    m_CreatedCount++;
+}
+
+void EGLImageCache::flush()
+{
+    for (Entry& entry : m_Entries) {
+        destroyEntry(entry);
+    }
+}
+
+uint32_t EGLImageCache::takeCreatedCount()
+{
+    uint32_t count = m_CreatedCount;
+    m_CreatedCount = 0;
+    return count;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "renderer.h"
+
+// Keeps the EGLImages exported for each decoder surface alive across frames.
+// Decoders recycle a small pool of surfaces, so once each of them has been
+// seen, rendering no longer creates any EGL objects.
+class EGLImageCache
+{
+public:
+    // Identifies a decoder surface. Keys are compared with memcmp(),
+    // so unused fields must be zeroed.
+    struct Key {
+        void* hwFrames;
+        uint64_t surfaceIds[EGL_MAX_PLANES];
+        int width;
+        int height;
+        int colorspace;
+        int colorRange;
+    };
+
+    // Called with the key of each entry as it's destroyed
+    typedef void (*EntryDestroyedCallback)(const Key& key, void* context);
+
+    EGLImageCache();
+    ~EGLImageCache();
+
+    void initialize(PFNEGLDESTROYIMAGEPROC eglDestroyImage,
+                    PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR,
+                    EntryDestroyedCallback entryDestroyedCallback = nullptr,
+                    void* callbackContext = nullptr);
+
+    // Returns the number of cached images for this surface, or 0 if it
+    // hasn't been seen before. A change of hwframes context flushes the cache.
+    ssize_t lookup(const Key& key, EGLImage images[EGL_MAX_PLANES]);
+
+    // The cache takes ownership of the images
+    void insert(EGLDisplay dpy, const Key& key, EGLImage images[EGL_MAX_PLANES], ssize_t count);
+
+    void flush();
+
+    // Returns the number of surfaces inserted since the last call
+    uint32_t takeCreatedCount();
+
+private:
+    struct Entry {
+        Key key;
+        EGLImage images[EGL_MAX_PLANES];
+        ssize_t count;
+        uint64_t lastUsed;
+    };
+
+    void destroyEntry(Entry& entry);
+
+    static const int k_MaxEntries = 32;
+
+    Entry m_Entries[k_MaxEntries];
+    EGLDisplay m_Display;
+    void* m_HwFrames;
+    uint64_t m_Clock;
+    uint32_t m_CreatedCount;
+    PFNEGLDESTROYIMAGEPROC m_eglDestroyImage;
+    PFNEGLDESTROYIMAGEKHRPROC m_eglDestroyImageKHR;
+    EntryDestroyedCallback m_EntryDestroyedCallback;
+    void* m_CallbackContext;
+};
@@ -89,6 +89,8 @@ EGLRenderer::EGLRenderer(IFFmpegRenderer *backendRenderer)
         m_GlesMajorVersion(0),
         m_GlesMinorVersion(0),
         m_HasExtUnpackSubimage(false),
+        m_ImportedFrames(0),
+        m_TotalImportTimeUs(0),
         m_DummyRenderer(nullptr)
 {
     SDL_assert(backendRenderer);
@@ -897,6 +899,7 @@ void EGLRenderer::renderFrame(AVFrame* frame)
         }
     }
 
+    Uint64 importStartTime = SDL_GetPerformanceCounter();
     ssize_t plane_count = m_Backend->exportEGLImages(frame, m_EGLDisplay, imgs);
     if (plane_count < 0)
         return;
@@ -905,6 +908,8 @@ void EGLRenderer::renderFrame(AVFrame* frame)
         glBindTexture(GL_TEXTURE_EXTERNAL_OES, m_Textures[i]);
         m_glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, imgs[i]);
     }
+    m_TotalImportTimeUs += ((SDL_GetPerformanceCounter() - importStartTime) * 1000000) / SDL_GetPerformanceFrequency();
+    m_ImportedFrames++;
 
     glClear(GL_COLOR_BUFFER_BIT);
     glUseProgram(m_ShaderProgram);
@@ -968,6 +973,17 @@ void EGLRenderer::renderFrame(AVFrame* frame)
     av_frame_move_ref(m_LastFrame, frame);
 }
 
+void EGLRenderer::collectRendererStats(VIDEO_STATS& stats)
+{
+    stats.importedFrames += m_ImportedFrames;
+    stats.totalImportTimeUs += m_TotalImportTimeUs;
+    m_ImportedFrames = 0;
+    m_TotalImportTimeUs = 0;
+
+    // The backend knows how many new EGLImages it had to create
+    m_Backend->collectRendererStats(stats);
+}
+
 bool EGLRenderer::testRenderFrame(AVFrame* frame)
 {
     EGLImage imgs[EGL_MAX_PLANES];
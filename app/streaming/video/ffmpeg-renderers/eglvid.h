@@ -18,6 +18,7 @@ public:
     virtual void notifyOverlayUpdated(Overlay::OverlayType) override;
     virtual bool isPixelFormatSupported(int videoFormat, enum AVPixelFormat pixelFormat) override;
     virtual AVPixelFormat getPreferredPixelFormat(int videoFormat) override;
+    virtual void collectRendererStats(VIDEO_STATS& stats) override;
 
 private:
 
@@ -59,6 +60,8 @@ private:
     int m_GlesMajorVersion;
     int m_GlesMinorVersion;
     bool m_HasExtUnpackSubimage;
+    uint32_t m_ImportedFrames;
+    uint64_t m_TotalImportTimeUs;
 
 #define NV12_PARAM_YUVMAT 0
 #define NV12_PARAM_OFFSET 1
@@ -0,0 +1,84 @@
+#include "drmvsyncsource.h"
+
+#include <xf86drm.h>
+
+#include <errno.h>
+
+DrmVsyncSource::DrmVsyncSource(Pacer* pacer, int drmFd, int crtcIndex) :
+    m_Pacer(pacer),
+    m_Thread(nullptr),
+    m_DrmFd(drmFd),
+    m_CrtcIndex(crtcIndex)
+{
+    SDL_AtomicSet(&m_Stopping, 0);
+}
+
+DrmVsyncSource::~DrmVsyncSource()
+{
+    if (m_Thread != nullptr) {
+        SDL_AtomicSet(&m_Stopping, 1);
+        SDL_WaitThread(m_Thread, nullptr);
+    }
+}
+
+bool DrmVsyncSource::initialize(SDL_Window*, int displayFps)
+{
+    m_DisplayFps = displayFps;
+
+    // Make sure this CRTC actually has working vblank interrupts by
+    // asking for the current count, which returns right away.
+    if (!waitForVblank(0)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "drmWaitVBlank() failed on CRTC %d: %d",
+                    m_CrtcIndex,
+                    errno);
+        return false;
+    }
+
+    m_Thread = SDL_CreateThread(vsyncThread, "DRMVsync", this);
+    if (m_Thread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to create DRM V-sync thread: %s",
+                     SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+bool DrmVsyncSource::waitForVblank(unsigned int relativeSequence)
+{
+    drmVBlank vbl = {};
+
+    // We wait synchronously rather than asking for DRM_VBLANK_EVENT,
+    // because the FD is shared with SDL and it reads the event queue
+    // for its own page flips.
+    vbl.request.type = (drmVBlankSeqType)(DRM_VBLANK_RELATIVE |
+                                          ((m_CrtcIndex << DRM_VBLANK_HIGH_CRTC_SHIFT) & DRM_VBLANK_HIGH_CRTC_MASK));
+    vbl.request.sequence = relativeSequence;
+
+    return drmWaitVBlank(m_DrmFd, &vbl) == 0;
+}
+
+int DrmVsyncSource::vsyncThread(void* context)
+{
+    DrmVsyncSource* me = reinterpret_cast<DrmVsyncSource*>(context);
+
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+#endif
+
+    while (SDL_AtomicGet(&me->m_Stopping) == 0) {
+        // This fails while the display is off, so don't spin on it
+        if (!me->waitForVblank(1)) {
+            SDL_Delay(10);
+            continue;
+        }
+
+        me->m_Pacer->vsyncCallback(1000 / me->m_DisplayFps);
+    }
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pacer.h"
+
+class DrmVsyncSource : public IVsyncSource
+{
+public:
+    DrmVsyncSource(Pacer* pacer, int drmFd, int crtcIndex);
+
+    virtual ~DrmVsyncSource();
+
+    virtual bool initialize(SDL_Window* window, int displayFps);
+
+private:
+    static int vsyncThread(void* context);
+
+    bool waitForVblank(unsigned int relativeSequence);
+
+    Pacer* m_Pacer;
+    SDL_Thread* m_Thread;
+    SDL_atomic_t m_Stopping;
+    int m_DrmFd;
+    int m_CrtcIndex;
+    int m_DisplayFps;
+};
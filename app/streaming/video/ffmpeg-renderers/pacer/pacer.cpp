@@ -1,5 +1,6 @@
 #include "pacer.h"
 #include "streaming/streamutils.h"
+#include "streaming/session.h"
 
 #include "nullthreadedvsyncsource.h"
 
@@ -10,6 +11,13 @@
 #include "dxvsyncsource.h"
 #endif
 
+#ifdef Q_OS_LINUX
+#include "timervsyncsource.h"
+#ifdef HAVE_DRM
+#include "drmvsyncsource.h"
+#endif
+#endif
+
 // Limit the number of queued frames to prevent excessive memory consumption
 // if the V-Sync source or renderer is blocked for a while.
 #define MAX_QUEUED_FRAMES 8
@@ -35,9 +43,13 @@ Pacer::Pacer(IFFmpegRenderer* renderer, PVIDEO_STATS videoStats) :
 
 Pacer::~Pacer()
 {
-    // Stop V-sync callbacks
-    delete m_VsyncSource;
+    // Stop V-sync callbacks. The render thread may still be reporting
+    // presents to the V-sync source, so detach it under the lock first.
+    m_FrameQueueLock.lock();
+    IVsyncSource* vsyncSource = m_VsyncSource;
     m_VsyncSource = nullptr;
+    m_FrameQueueLock.unlock();
+    delete vsyncSource;
 
     // Stop the render thread
     m_Stopping = true;
@@ -234,6 +246,8 @@ bool Pacer::initialize(SDL_Window* window, int maxVideoFps, bool enablePacing)
     m_DisplayFps = StreamUtils::getDisplayRefreshRate(window);
 
     if (enablePacing) {
+        bool vsyncSourceInitialized = false;
+
         SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                     "Frame pacing active: target %d Hz with %d FPS stream",
                     m_DisplayFps, m_MaxVideoFps);
@@ -244,12 +258,37 @@ bool Pacer::initialize(SDL_Window* window, int maxVideoFps, bool enablePacing)
         if (IsWindows8OrGreater()) {
             m_VsyncSource = new DxVsyncSource(this);
         }
+    #elif defined(Q_OS_LINUX)
+    #ifdef HAVE_DRM
+        // If the renderer scans out to a KMS plane itself, we can wait
+        // for the vblanks on that CRTC.
+        int drmFd, crtcIndex;
+        if (m_VsyncRenderer->getScanoutCrtc(&drmFd, &crtcIndex)) {
+            m_VsyncSource = new DrmVsyncSource(this, drmFd, crtcIndex);
+            if (m_VsyncSource->initialize(window, m_DisplayFps)) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "Using DRM vblanks on CRTC %d for frame pacing",
+                            crtcIndex);
+                vsyncSourceInitialized = true;
+            }
+            else {
+                delete m_VsyncSource;
+                m_VsyncSource = nullptr;
+            }
+        }
+    #endif
+
+        // Otherwise, predict V-sync from when our presents complete
+        if (m_VsyncSource == nullptr) {
+            m_VsyncSource = new TimerVsyncSource(this);
+        }
     #else
         // Platforms without a VsyncSource will just render frames
         // immediately like they used to.
     #endif
 
-        if (m_VsyncSource != nullptr && !m_VsyncSource->initialize(window, m_DisplayFps)) {
+        if (m_VsyncSource != nullptr && !vsyncSourceInitialized &&
+                !m_VsyncSource->initialize(window, m_DisplayFps)) {
             return false;
         }
     }
@@ -269,20 +308,34 @@ bool Pacer::initialize(SDL_Window* window, int maxVideoFps, bool enablePacing)
 void Pacer::renderFrame(AVFrame* frame)
 {
     // Count time spent in Pacer's queues
-    Uint32 beforeRender = SDL_GetTicks();
-    m_VideoStats->totalPacerTime += beforeRender - frame->pkt_dts;
+    uint64_t beforeRenderUs = LiGetMicroseconds();
+    if (frame->opaque_ref != nullptr) {
+        PFRAME_TIMESTAMPS timestamps = (PFRAME_TIMESTAMPS)frame->opaque_ref->data;
+        m_VideoStats->pacerTimeHistogram.addSample(beforeRenderUs - timestamps->decodeCompleteTimeUs);
+    }
+
+    FrameTracer& frameTracer = Session::get()->getFrameTracer();
+    int frameNumber = (int)(intptr_t)frame->opaque;
+    frameTracer.recordStage(frameNumber, FrameTracer::RenderStart);
 
     // Render it
     m_VsyncRenderer->renderFrame(frame);
-    Uint32 afterRender = SDL_GetTicks();
+    uint64_t afterRenderUs = LiGetMicroseconds();
+
+    frameTracer.recordStage(frameNumber, FrameTracer::RenderPresent);
 
-    m_VideoStats->totalRenderTime += afterRender - beforeRender;
+    m_VideoStats->renderTimeHistogram.addSample(afterRenderUs - beforeRenderUs);
     m_VideoStats->renderedFrames++;
+    m_VsyncRenderer->collectRendererStats(*m_VideoStats);
     av_frame_free(&frame);
 
     // Drop frames if we have too many queued up for a while
     m_FrameQueueLock.lock();
 
+    if (m_VsyncSource != nullptr) {
+        m_VsyncSource->framePresented(afterRenderUs);
+    }
+
     int frameDropTarget = 0;
     for (int queueHistoryEntry : m_RenderQueueHistory) {
         if (queueHistoryEntry == 0) {
@@ -328,6 +381,8 @@ void Pacer::submitFrame(AVFrame* frame)
     // Make sure initialize() has been called
     SDL_assert(m_MaxVideoFps != 0);
 
+    Session::get()->getFrameTracer().recordStage((int)(intptr_t)frame->opaque, FrameTracer::PacerEnqueue);
+
     // Queue the frame and possibly wake up the render thread
     m_FrameQueueLock.lock();
     if (m_VsyncSource != nullptr) {
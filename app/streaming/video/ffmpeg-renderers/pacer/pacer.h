@@ -7,10 +7,20 @@
 #include <QMutex>
 #include <QWaitCondition>
 
+// Travels with each decoded AVFrame in its opaque_ref
+typedef struct _FRAME_TIMESTAMPS {
+    // LiGetMicroseconds() when the decoder returned the frame
+    uint64_t decodeCompleteTimeUs;
+} FRAME_TIMESTAMPS, *PFRAME_TIMESTAMPS;
+
 class IVsyncSource {
 public:
     virtual ~IVsyncSource() {}
     virtual bool initialize(SDL_Window* window, int displayFps) = 0;
+
+    // Called on the render thread after each frame is presented with
+    // the LiGetMicroseconds() time that it completed
+    virtual void framePresented(uint64_t) {}
 };
 
 class Pacer
@@ -0,0 +1,167 @@
+#include "timervsyncsource.h"
+
+#include <Limelight.h>
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+// Number of presents to collect before correcting our V-sync phase
+#define PHASE_WINDOW_FRAMES 30
+
+TimerVsyncSource::TimerVsyncSource(Pacer* pacer) :
+    m_Pacer(pacer),
+    m_Thread(nullptr),
+    m_TimerFd(-1),
+    m_Lock(0),
+    m_PeriodUs(0),
+    m_VsyncBaseUs(0),
+    m_LastPresentUs(0),
+    m_MinPhaseErrorUs(INT64_MAX),
+    m_PhaseSamples(0)
+{
+    SDL_AtomicSet(&m_Stopping, 0);
+}
+
+TimerVsyncSource::~TimerVsyncSource()
+{
+    // The timer always expires within one period, so this won't block long
+    if (m_Thread != nullptr) {
+        SDL_AtomicSet(&m_Stopping, 1);
+        SDL_WaitThread(m_Thread, nullptr);
+    }
+
+    if (m_TimerFd >= 0) {
+        close(m_TimerFd);
+    }
+}
+
+bool TimerVsyncSource::initialize(SDL_Window*, int displayFps)
+{
+    m_DisplayFps = displayFps;
+    m_PeriodUs = 1000000 / displayFps;
+    m_VsyncBaseUs = LiGetMicroseconds();
+
+    m_TimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (m_TimerFd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "timerfd_create() failed: %d",
+                     errno);
+        return false;
+    }
+
+    m_Thread = SDL_CreateThread(vsyncThread, "TimerVsync", this);
+    if (m_Thread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to create timer V-sync thread: %s",
+                     SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+void TimerVsyncSource::framePresented(uint64_t presentTimeUs)
+{
+    SDL_AtomicLock(&m_Lock);
+
+    // If this present came a whole number of periods after the last one,
+    // use it to refine the period. The display rarely runs at exactly
+    // the integer rate that SDL reports (59.94 Hz for example).
+    if (m_LastPresentUs != 0) {
+        uint64_t intervalUs = presentTimeUs - m_LastPresentUs;
+        uint64_t periods = (intervalUs + m_PeriodUs / 2) / m_PeriodUs;
+
+        if (periods >= 1 && periods <= 4) {
+            int64_t errorUs = (int64_t)(intervalUs - periods * m_PeriodUs);
+            int64_t toleranceUs = (int64_t)(m_PeriodUs / 16);
+            if (errorUs > -toleranceUs && errorUs < toleranceUs) {
+                m_PeriodUs = (m_PeriodUs * 31 + intervalUs / periods) / 32;
+            }
+        }
+    }
+    m_LastPresentUs = presentTimeUs;
+
+    if (presentTimeUs < m_VsyncBaseUs) {
+        SDL_AtomicUnlock(&m_Lock);
+        return;
+    }
+
+    // Presents finish shortly after the vblank they were latched on, but
+    // never before it. The earliest one relative to our predicted phase
+    // in each window is the closest to the real vblank.
+    int64_t phaseErrorUs = (int64_t)((presentTimeUs - m_VsyncBaseUs) % m_PeriodUs);
+    if (phaseErrorUs >= (int64_t)(m_PeriodUs / 2)) {
+        phaseErrorUs -= m_PeriodUs;
+    }
+    m_MinPhaseErrorUs = SDL_min(m_MinPhaseErrorUs, phaseErrorUs);
+
+    if (++m_PhaseSamples == PHASE_WINDOW_FRAMES) {
+        // Rebase onto this present so the modulus above stays accurate
+        // as small errors in the period accumulate.
+        m_VsyncBaseUs = presentTimeUs - phaseErrorUs + m_MinPhaseErrorUs;
+        m_MinPhaseErrorUs = INT64_MAX;
+        m_PhaseSamples = 0;
+    }
+
+    SDL_AtomicUnlock(&m_Lock);
+}
+
+uint64_t TimerVsyncSource::getNextVsyncTimeUs(uint64_t nowUs)
+{
+    SDL_AtomicLock(&m_Lock);
+
+    uint64_t nextVsyncUs = m_VsyncBaseUs;
+    if (nowUs >= nextVsyncUs) {
+        nextVsyncUs += ((nowUs - nextVsyncUs) / m_PeriodUs + 1) * m_PeriodUs;
+    }
+
+    SDL_AtomicUnlock(&m_Lock);
+
+    return nextVsyncUs;
+}
+
+int TimerVsyncSource::vsyncThread(void* context)
+{
+    TimerVsyncSource* me = reinterpret_cast<TimerVsyncSource*>(context);
+
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+#endif
+
+    while (SDL_AtomicGet(&me->m_Stopping) == 0) {
+        // LiGetMicroseconds() isn't guaranteed to be CLOCK_MONOTONIC,
+        // so arm the timer relative to now rather than at an absolute time
+        uint64_t nowUs = LiGetMicroseconds();
+        uint64_t delayUs = me->getNextVsyncTimeUs(nowUs) - nowUs;
+
+        struct itimerspec timerSpec = {};
+        timerSpec.it_value.tv_sec = delayUs / 1000000;
+        timerSpec.it_value.tv_nsec = (delayUs % 1000000) * 1000;
+
+        if (timerfd_settime(me->m_TimerFd, 0, &timerSpec, nullptr) < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "timerfd_settime() failed: %d",
+                         errno);
+            SDL_Delay(10);
+            continue;
+        }
+
+        uint64_t expirations;
+        if (read(me->m_TimerFd, &expirations, sizeof(expirations)) < 0) {
+            if (errno != EINTR) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                             "read(timerfd) failed: %d",
+                             errno);
+                SDL_Delay(10);
+            }
+            continue;
+        }
+
+        me->m_Pacer->vsyncCallback(1000 / me->m_DisplayFps);
+    }
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pacer.h"
+
+// Predicts V-sync from the times that frames finish presenting, for
+// displays where we have no way to wait for a vblank directly.
+class TimerVsyncSource : public IVsyncSource
+{
+public:
+    TimerVsyncSource(Pacer* pacer);
+
+    virtual ~TimerVsyncSource();
+
+    virtual bool initialize(SDL_Window* window, int displayFps);
+
+    virtual void framePresented(uint64_t presentTimeUs);
+
+private:
+    static int vsyncThread(void* context);
+
+    uint64_t getNextVsyncTimeUs(uint64_t nowUs);
+
+    Pacer* m_Pacer;
+    SDL_Thread* m_Thread;
+    SDL_atomic_t m_Stopping;
+    int m_TimerFd;
+    int m_DisplayFps;
+
+    // Protects the prediction state below
+    SDL_SpinLock m_Lock;
+    uint64_t m_PeriodUs;
+    uint64_t m_VsyncBaseUs;
+    uint64_t m_LastPresentUs;
+    int64_t m_MinPhaseErrorUs;
+    int m_PhaseSamples;
+};
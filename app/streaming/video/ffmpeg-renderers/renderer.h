@@ -192,6 +192,12 @@ public:
         return true;
     }
 
+    // Called on the render thread after each rendered frame to let the
+    // renderer add its own counters to the current stats window
+    virtual void collectRendererStats(VIDEO_STATS&) {
+        // No renderer-specific stats by default
+    }
+
     // IOverlayRenderer
     virtual void notifyOverlayUpdated(Overlay::OverlayType) override {
         // Nothing
@@ -233,5 +239,11 @@ public:
     }
 
     virtual void unmapDrmPrimeFrame(AVDRMFrameDescriptor*) {}
+
+    // Returns the KMS device and the index of the CRTC that this renderer
+    // scans out to, so the Pacer can wait for its vblanks directly
+    virtual bool getScanoutCrtc(int*, int*) {
+        return false;
+    }
 #endif
 };
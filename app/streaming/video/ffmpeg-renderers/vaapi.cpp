@@ -525,6 +525,8 @@ VAAPIRenderer::initializeEGL(EGLDisplay,
         return false;
     }
 
+    m_EGLImageCache.initialize(m_eglDestroyImage, m_eglDestroyImageKHR);
+
     return true;
 }
 
@@ -536,7 +538,30 @@ VAAPIRenderer::exportEGLImages(AVFrame *frame, EGLDisplay dpy,
     AVVAAPIDeviceContext* vaDeviceContext = (AVVAAPIDeviceContext*)hwFrameCtx->device_ctx->hwctx;
 
     VASurfaceID surface_id = (VASurfaceID)(uintptr_t)frame->data[3];
-    VAStatus st = vaExportSurfaceHandle(vaDeviceContext->display,
+    VAStatus st;
+
+    // Surfaces are recycled within the frames context, so we can reuse the
+    // EGLImages we created the last time we saw this one.
+    EGLImageCache::Key key;
+    SDL_zero(key);
+    key.hwFrames = hwFrameCtx;
+    key.surfaceIds[0] = surface_id;
+    key.width = frame->width;
+    key.height = frame->height;
+
+    count = m_EGLImageCache.lookup(key, images);
+    if (count > 0) {
+        st = vaSyncSurface(vaDeviceContext->display, surface_id);
+        if (st != VA_STATUS_SUCCESS) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "vaSyncSurface failed: %d", st);
+            return -1;
+        }
+
+        return count;
+    }
+
+    st = vaExportSurfaceHandle(vaDeviceContext->display,
                                         surface_id,
                                         VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
                                         VA_EXPORT_SURFACE_READ_ONLY | VA_EXPORT_SURFACE_SEPARATE_LAYERS,
@@ -670,17 +695,20 @@ VAAPIRenderer::exportEGLImages(AVFrame *frame, EGLDisplay dpy,
 
         ++count;
     }
+
+    // The EGLImages hold their own references to the DMA-BUFs
+    for (size_t i = 0; i < m_PrimeDescriptor.num_objects; ++i) {
+        close(m_PrimeDescriptor.objects[i].fd);
+    }
+    m_PrimeDescriptor.num_layers = 0;
+    m_PrimeDescriptor.num_objects = 0;
+
+    m_EGLImageCache.insert(dpy, key, images, count);
     return count;
 
 create_image_fail:
     m_PrimeDescriptor.num_layers = count;
 sync_fail:
-    freeEGLImages(dpy, images);
-    return -1;
-}
-
-void
-VAAPIRenderer::freeEGLImages(EGLDisplay dpy, EGLImage images[EGL_MAX_PLANES]) {
     for (size_t i = 0; i < m_PrimeDescriptor.num_layers; ++i) {
         if (m_eglDestroyImage) {
             m_eglDestroyImage(dpy, images[i]);
@@ -694,6 +722,17 @@ VAAPIRenderer::freeEGLImages(EGLDisplay dpy, EGLImage images[EGL_MAX_PLANES]) {
     }
     m_PrimeDescriptor.num_layers = 0;
     m_PrimeDescriptor.num_objects = 0;
+    return -1;
+}
+
+void
+VAAPIRenderer::freeEGLImages(EGLDisplay, EGLImage[EGL_MAX_PLANES]) {
+    // The images stay alive in m_EGLImageCache until their surface goes away
+}
+
+void
+VAAPIRenderer::collectRendererStats(VIDEO_STATS& stats) {
+    stats.importSurfacesCreated += m_EGLImageCache.takeCreatedCount();
 }
 
 #endif
@@ -2,6 +2,10 @@
 
 #include "renderer.h"
 
+#ifdef HAVE_EGL
+#include "eglimagecache.h"
+#endif
+
 // Avoid X11 if SDL was built without it
 #if !defined(SDL_VIDEO_DRIVER_X11) && defined(HAVE_LIBVA_X11)
 #warning Unable to use libva-x11 without SDL support
@@ -48,6 +52,7 @@ public:
     virtual bool initializeEGL(EGLDisplay dpy, const EGLExtensions &ext) override;
     virtual ssize_t exportEGLImages(AVFrame *frame, EGLDisplay dpy, EGLImage images[EGL_MAX_PLANES]) override;
     virtual void freeEGLImages(EGLDisplay dpy, EGLImage[EGL_MAX_PLANES]) override;
+    virtual void collectRendererStats(VIDEO_STATS& stats) override;
 #endif
 
 #ifdef HAVE_DRM
@@ -84,5 +89,6 @@ private:
     PFNEGLDESTROYIMAGEPROC m_eglDestroyImage;
     PFNEGLCREATEIMAGEKHRPROC m_eglCreateImageKHR;
     PFNEGLDESTROYIMAGEKHRPROC m_eglDestroyImageKHR;
+    EGLImageCache m_EGLImageCache;
 #endif
 };
@@ -2,6 +2,7 @@
 #include "ffmpeg.h"
 #include "streaming/streamutils.h"
 #include "streaming/session.h"
+#include "decoderprobecache.h"
 
 #include <h264_stream.h>
 
@@ -47,6 +48,13 @@
 
 #define FAILED_DECODES_RESET_THRESHOLD 20
 
+// How long to wait for new input while waiting for the decoder to produce a
+// frame before we poll it again. New frames from the host wake us early.
+#define DECODER_OUTPUT_WAIT_TIMEOUT_MS 2
+
+static_assert(VIDEO_FRAME_BUFFER_PADDING >= AV_INPUT_BUFFER_PADDING_SIZE,
+              "Contiguous frame buffers must be padded for FFmpeg");
+
 bool FFmpegVideoDecoder::isHardwareAccelerated()
 {
     return m_HwDecodeCfg != nullptr ||
@@ -84,6 +92,10 @@ int FFmpegVideoDecoder::getDecoderCapabilities()
     // We use our own decoder thread with the "pull" model
     capabilities |= CAPABILITY_PULL_RENDERER;
 
+    // Have the depacketizer assemble frames into a padded buffer that we can
+    // pass directly to the decoder without copying it again
+    capabilities |= CAPABILITY_CONTIGUOUS_FRAME_BUFFER;
+
     return capabilities;
 }
 
@@ -142,6 +154,7 @@ FFmpegVideoDecoder::FFmpegVideoDecoder(bool testOnly)
       m_FrontendRenderer(nullptr),
       m_ConsecutiveFailedDecodes(0),
       m_Pacer(nullptr),
+      m_FrameTimestampsPool(av_buffer_pool_init(sizeof(FRAME_TIMESTAMPS), nullptr)),
       m_FramesIn(0),
       m_FramesOut(0),
       m_LastFrameNumber(0),
@@ -172,6 +185,9 @@ FFmpegVideoDecoder::~FFmpegVideoDecoder()
     av_log_set_level(AV_LOG_INFO);
 
     av_packet_free(&m_Pkt);
+
+    // Frames still holding timestamps keep the pool alive until they're freed
+    av_buffer_pool_uninit(&m_FrameTimestampsPool);
 }
 
 IFFmpegRenderer* FFmpegVideoDecoder::getBackendRenderer()
@@ -472,10 +488,15 @@ void FFmpegVideoDecoder::addVideoStats(VIDEO_STATS& src, VIDEO_STATS& dst)
     dst.totalFrames += src.totalFrames;
     dst.networkDroppedFrames += src.networkDroppedFrames;
     dst.pacerDroppedFrames += src.pacerDroppedFrames;
-    dst.totalReassemblyTime += src.totalReassemblyTime;
-    dst.totalDecodeTime += src.totalDecodeTime;
-    dst.totalPacerTime += src.totalPacerTime;
-    dst.totalRenderTime += src.totalRenderTime;
+    dst.reassemblyTimeHistogram.add(src.reassemblyTimeHistogram);
+    dst.decodeTimeHistogram.add(src.decodeTimeHistogram);
+    dst.pacerTimeHistogram.add(src.pacerTimeHistogram);
+    dst.renderTimeHistogram.add(src.renderTimeHistogram);
+    dst.totalDecoderIdleTimeUs += src.totalDecoderIdleTimeUs;
+    dst.totalDecoderWaitTimeUs += src.totalDecoderWaitTimeUs;
+    dst.importedFrames += src.importedFrames;
+    dst.importSurfacesCreated += src.importSurfacesCreated;
+    dst.totalImportTimeUs += src.totalImportTimeUs;
 
     if (!LiGetEstimatedRttInfo(&dst.lastRtt, &dst.lastRttVariance)) {
         dst.lastRtt = 0;
@@ -560,26 +581,55 @@ void FFmpegVideoDecoder::stringifyVideoStats(VIDEO_STATS& stats, char* output)
             sprintf(rttString, "N/A");
         }
 
+        char reassemblyString[48];
+        char decodeString[48];
+        char pacerString[48];
+        char renderString[48];
+
+        stats.reassemblyTimeHistogram.stringifyPercentiles(reassemblyString, sizeof(reassemblyString));
+        stats.decodeTimeHistogram.stringifyPercentiles(decodeString, sizeof(decodeString));
+        stats.pacerTimeHistogram.stringifyPercentiles(pacerString, sizeof(pacerString));
+        stats.renderTimeHistogram.stringifyPercentiles(renderString, sizeof(renderString));
+
         offset += sprintf(&output[offset],
                           "Frames dropped by your network connection: %.2f%%\n"
                           "Frames dropped due to network jitter: %.2f%%\n"
                           "Average network latency: %s\n"
-                          "Average decoding time: %.2f ms\n"
-                          "Average frame queue delay: %.2f ms\n"
-                          "Average rendering time (including monitor V-sync latency): %.2f ms\n",
+                          "Frame latency (p50/p95/p99/max):\n"
+                          "  Network reassembly: %s\n"
+                          "  Decoding: %s\n"
+                          "  Frame queue: %s\n"
+                          "  Rendering (including V-sync wait): %s\n",
                           (float)stats.networkDroppedFrames / stats.totalFrames * 100,
                           (float)stats.pacerDroppedFrames / stats.decodedFrames * 100,
                           rttString,
-                          (float)stats.totalDecodeTime / stats.decodedFrames,
-                          (float)stats.totalPacerTime / stats.renderedFrames,
-                          (float)stats.totalRenderTime / stats.renderedFrames);
+                          reassemblyString,
+                          decodeString,
+                          pacerString,
+                          renderString);
+
+        Uint32 elapsedMs = SDL_GetTicks() - stats.measurementStartTimestamp;
+        if (elapsedMs != 0) {
+            offset += sprintf(&output[offset],
+                              "Decoder thread idle: %.1f%% (waiting on decoder: %.1f%%)\n",
+                              stats.totalDecoderIdleTimeUs / (elapsedMs * 10.0f),
+                              stats.totalDecoderWaitTimeUs / (elapsedMs * 10.0f));
+
+            // A renderer that caches its imported surfaces should create none in steady state
+            if (stats.importedFrames != 0) {
+                offset += sprintf(&output[offset],
+                                  "Average frame import time: %.2f ms (%.2f new surfaces per second)\n",
+                                  stats.totalImportTimeUs / 1000.0f / stats.importedFrames,
+                                  stats.importSurfacesCreated * 1000.0f / elapsedMs);
+            }
+        }
     }
 }
 
 void FFmpegVideoDecoder::logVideoStats(VIDEO_STATS& stats, const char* title)
 {
     if (stats.renderedFps > 0 || stats.renderedFrames != 0) {
-        char videoStatsStr[512];
+        char videoStatsStr[1024];
         stringifyVideoStats(stats, videoStatsStr);
 
         SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
@@ -587,6 +637,11 @@ void FFmpegVideoDecoder::logVideoStats(VIDEO_STATS& stats, const char* title)
         SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                     "----------------------------------------------------------\n%s",
                     videoStatsStr);
+
+        stats.reassemblyTimeHistogram.log("Network reassembly time");
+        stats.decodeTimeHistogram.log("Decoding time");
+        stats.pacerTimeHistogram.log("Frame queue time");
+        stats.renderTimeHistogram.log("Rendering time");
     }
 }
 
@@ -863,6 +918,84 @@ bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
         return false;
     }
 
+    DecoderProbeCache::Choice choice;
+    QString probeCacheKey = DecoderProbeCache::getKey(params);
+    Uint64 probeStartTime = SDL_GetPerformanceCounter();
+    int fullProbeTimeMs;
+
+    // Try the decoder that worked last time before probing all of them
+    if (DecoderProbeCache::lookup(probeCacheKey, choice, fullProbeTimeMs)) {
+        if (tryInitializeCachedChoice(params, choice)) {
+            int cachedTimeMs = (int)(getElapsedUs(probeStartTime) / 1000);
+
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Initialized cached decoder choice (%s) in %d ms instead of %d ms (saved %d ms)",
+                        choice.decoderName.toUtf8().constData(),
+                        cachedTimeMs,
+                        fullProbeTimeMs,
+                        fullProbeTimeMs - cachedTimeMs);
+            return true;
+        }
+
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Cached decoder choice (%s) failed to initialize. Probing all decoders.",
+                    choice.decoderName.toUtf8().constData());
+        DecoderProbeCache::remove(probeCacheKey);
+        probeStartTime = SDL_GetPerformanceCounter();
+    }
+
+    if (!probeDecoders(decoder, params, choice)) {
+        // No decoder worked
+        return false;
+    }
+
+    // Landing on the software decoder means every hardware decoder failed. Don't
+    // remember that, since it may have been something transient like a GPU reset.
+    if (choice.method != DecoderProbeCache::Software) {
+        DecoderProbeCache::store(probeCacheKey, choice, (int)(getElapsedUs(probeStartTime) / 1000));
+    }
+    return true;
+}
+
+bool FFmpegVideoDecoder::tryInitializeCachedChoice(PDECODER_PARAMETERS params,
+                                                   const DecoderProbeCache::Choice& choice)
+{
+    switch (choice.method) {
+    case DecoderProbeCache::Hwaccel:
+    {
+        const AVCodec* hwDecoder = avcodec_find_decoder_by_name(choice.decoderName.toUtf8().constData());
+        if (hwDecoder == nullptr) {
+            return false;
+        }
+
+        for (int i = 0;; i++) {
+            const AVCodecHWConfig *config = avcodec_get_hw_config(hwDecoder, i);
+            if (!config) {
+                return false;
+            }
+
+            if (config->device_type == choice.deviceType) {
+                int pass = choice.pass;
+                return tryInitializeRenderer(hwDecoder, params, config,
+                                             [config, pass]() -> IFFmpegRenderer* { return createHwAccelRenderer(config, pass); });
+            }
+        }
+    }
+
+    case DecoderProbeCache::NamedDecoder:
+        return tryInitializeRendererForDecoderByName(choice.decoderName.toUtf8().constData(), params);
+
+    default:
+        return false;
+    }
+}
+
+bool FFmpegVideoDecoder::probeDecoders(const AVCodec* decoder, PDECODER_PARAMETERS params, DecoderProbeCache::Choice& choice)
+{
+    choice.decoderName = decoder->name;
+    choice.deviceType = AV_HWDEVICE_TYPE_NONE;
+    choice.pass = 0;
+
     // Look for a hardware decoder first unless software-only
     if (params->vds != StreamingPreferences::VDS_FORCE_SOFTWARE) {
         // Look for the first matching hwaccel hardware decoder (pass 0)
@@ -876,6 +1009,8 @@ bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
             // Initialize the hardware codec and submit a test frame if the renderer needs it
             if (tryInitializeRenderer(decoder, params, config,
                                       [config]() -> IFFmpegRenderer* { return createHwAccelRenderer(config, 0); })) {
+                choice.method = DecoderProbeCache::Hwaccel;
+                choice.deviceType = config->device_type;
                 return true;
             }
         }
@@ -900,6 +1035,8 @@ bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
             };
             for (const char* codec : knownAvcCodecs) {
                 if (tryInitializeRendererForDecoderByName(codec, params)) {
+                    choice.method = DecoderProbeCache::NamedDecoder;
+                    choice.decoderName = codec;
                     return true;
                 }
             }
@@ -908,6 +1045,8 @@ bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
             QList<const char *> knownHevcCodecs = { "hevc_rkmpp", "hevc_nvv4l2", "hevc_nvmpi", "hevc_v4l2m2m" };
             for (const char* codec : knownHevcCodecs) {
                 if (tryInitializeRendererForDecoderByName(codec, params)) {
+                    choice.method = DecoderProbeCache::NamedDecoder;
+                    choice.decoderName = codec;
                     return true;
                 }
             }
@@ -925,6 +1064,9 @@ bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
             // Initialize the hardware codec and submit a test frame if the renderer needs it
             if (tryInitializeRenderer(decoder, params, config,
                                       [config]() -> IFFmpegRenderer* { return createHwAccelRenderer(config, 1); })) {
+                choice.method = DecoderProbeCache::Hwaccel;
+                choice.deviceType = config->device_type;
+                choice.pass = 1;
                 return true;
             }
         }
@@ -935,6 +1077,7 @@ bool FFmpegVideoDecoder::initialize(PDECODER_PARAMETERS params)
     if (params->vds != StreamingPreferences::VDS_FORCE_HARDWARE) {
         if (tryInitializeRenderer(decoder, params, nullptr,
                                   []() -> IFFmpegRenderer* { return new SdlRenderer(); })) {
+            choice.method = DecoderProbeCache::Software;
             return true;
         }
     }
@@ -986,6 +1129,16 @@ void FFmpegVideoDecoder::writeBuffer(PLENTRY entry, int& offset)
     }
 }
 
+void FFmpegVideoDecoder::freeFrameBuffer(void*, uint8_t* data)
+{
+    LiFreeVideoFrameBuffer(data);
+}
+
+uint64_t FFmpegVideoDecoder::getElapsedUs(Uint64 startTime)
+{
+    return ((SDL_GetPerformanceCounter() - startTime) * 1000000) / SDL_GetPerformanceFrequency();
+}
+
 int FFmpegVideoDecoder::decoderThreadProcThunk(void *context)
 {
     ((FFmpegVideoDecoder*)context)->decoderThreadProc();
@@ -1001,7 +1154,10 @@ void FFmpegVideoDecoder::decoderThreadProc()
 
             // Waiting for input. All output frames have been received.
             // Block until we receive a new frame from the host.
-            if (!LiWaitForNextVideoFrame(&handle, &du)) {
+            Uint64 idleStartTime = SDL_GetPerformanceCounter();
+            bool gotFrame = LiWaitForNextVideoFrame(&handle, &du);
+            m_ActiveWndVideoStats.totalDecoderIdleTimeUs += getElapsedUs(idleStartTime);
+            if (!gotFrame) {
                 // This might be a signal from the main thread to exit
                 continue;
             }
@@ -1036,8 +1192,14 @@ void FFmpegVideoDecoder::decoderThreadProc()
                     // Restore default log level after a successful decode
                     av_log_set_level(AV_LOG_INFO);
 
-                    // Capture a frame timestamp to measuring pacing delay
-                    frame->pkt_dts = SDL_GetTicks();
+                    // Timestamp the frame to measure the delay in the Pacer. FFmpeg
+                    // doesn't touch opaque_ref unless AV_CODEC_FLAG_COPY_OPAQUE is set.
+                    uint64_t decodeCompleteTimeUs = LiGetMicroseconds();
+                    av_buffer_unref(&frame->opaque_ref);
+                    frame->opaque_ref = av_buffer_pool_get(m_FrameTimestampsPool);
+                    if (frame->opaque_ref != nullptr) {
+                        ((PFRAME_TIMESTAMPS)frame->opaque_ref->data)->decodeCompleteTimeUs = decodeCompleteTimeUs;
+                    }
 
                     if (!m_FrameInfoQueue.isEmpty()) {
                         FrameInfoTuple infoTuple = m_FrameInfoQueue.dequeue();
@@ -1045,10 +1207,14 @@ void FFmpegVideoDecoder::decoderThreadProc()
                         // Count time in avcodec_send_packet() and avcodec_receive_frame()
                         // as time spent decoding. Also count time spent in the decode unit
                         // queue because that's directly caused by decoder latency.
-                        m_ActiveWndVideoStats.totalDecodeTime += LiGetMillis() - infoTuple.enqueueTimeMs;
+                        m_ActiveWndVideoStats.decodeTimeHistogram.addSample(decodeCompleteTimeUs - infoTuple.enqueueTimeUs);
 
                         // Store the presentation time
                         frame->pts = infoTuple.presentationTimeMs;
+
+                        // Carry the frame number along for the frame tracer
+                        frame->opaque = (void*)(intptr_t)infoTuple.frameNumber;
+                        Session::get()->getFrameTracer().recordStage(infoTuple.frameNumber, FrameTracer::DecoderOutput);
                     }
 
                     m_ActiveWndVideoStats.decodedFrames++;
@@ -1062,14 +1228,15 @@ void FFmpegVideoDecoder::decoderThreadProc()
 
                     // No output data, so let's try to submit more input data,
                     // while we're waiting for this to frame to come back.
-                    if (LiPollNextVideoFrame(&handle, &du)) {
+                    // If there's no input data either, this waits a little
+                    // bit but returns as soon as the next frame is queued.
+                    Uint64 waitStartTime = SDL_GetPerformanceCounter();
+                    bool gotFrame = LiWaitForNextVideoFrameTimeout(&handle, &du, DECODER_OUTPUT_WAIT_TIMEOUT_MS);
+                    m_ActiveWndVideoStats.totalDecoderWaitTimeUs += getElapsedUs(waitStartTime);
+                    if (gotFrame) {
                         // FIXME: Handle EAGAIN on avcodec_send_packet() properly?
                         LiCompleteVideoFrame(handle, submitDecodeUnit(du));
                     }
-                    else {
-                        // No output data or input data. Let's wait a little bit.
-                        SDL_Delay(2);
-                    }
                 }
                 else {
                     char errorstring[512];
@@ -1135,7 +1302,32 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
             addVideoStats(m_LastWndVideoStats, lastTwoWndStats);
             addVideoStats(m_ActiveWndVideoStats, lastTwoWndStats);
 
-            stringifyVideoStats(lastTwoWndStats, Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug));
+            char* overlayText = Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug);
+            stringifyVideoStats(lastTwoWndStats, overlayText);
+
+            // Show where frames are waiting between the receive thread and the decoder
+            VIDEO_QUEUE_DEPTHS queueDepths;
+            LiGetVideoQueueDepths(&queueDepths);
+            int overlayLength = (int)strlen(overlayText);
+            SDL_snprintf(&overlayText[overlayLength], Overlay::k_MaxOverlayText - overlayLength,
+                         "Queued (peak): %d (%d) received packets, %d (%d) FEC packets, %d (%d) frames\n",
+                         queueDepths.receivedPackets, queueDepths.receivedPacketsPeak,
+                         queueDepths.fecPackets, queueDepths.fecPacketsPeak,
+                         queueDepths.decodeUnits, queueDepths.decodeUnitsPeak);
+
+            FRAME_INVALIDATION_STATS rfiStats;
+            LiGetFrameInvalidationStats(&rfiStats);
+            if (rfiStats.rfiSent != 0 || rfiStats.idrEscalations != 0) {
+                overlayLength = (int)strlen(overlayText);
+                SDL_snprintf(&overlayText[overlayLength], Overlay::k_MaxOverlayText - overlayLength,
+                             "Reference frame invalidations: %u sent, %u ranges merged, %u escalated to IDR\n",
+                             rfiStats.rfiSent, rfiStats.rangesMerged, rfiStats.idrEscalations);
+            }
+
+            // Audio doesn't have an overlay of its own
+            overlayLength = (int)strlen(overlayText);
+            Session::get()->getAudioJitterBuffer().stringifyStats(&overlayText[overlayLength],
+                                                                  Overlay::k_MaxOverlayText - overlayLength);
             Session::get()->getOverlayManager().setOverlayTextUpdated(Overlay::OverlayDebug);
         }
 
@@ -1151,23 +1343,43 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
     m_ActiveWndVideoStats.receivedFrames++;
     m_ActiveWndVideoStats.totalFrames++;
 
-    int requiredBufferSize = du->fullLength;
-    if (du->frameType == FRAME_TYPE_IDR) {
-        // Add some extra space in case we need to do an SPS fixup
-        requiredBufferSize += MAX_SPS_EXTRA_SIZE;
+    // The depacketizer assembled this frame into a single padded buffer, so we can
+    // give it to FFmpeg as-is unless we have to rewrite the SPS. Passing a refcounted
+    // buffer also keeps avcodec_send_packet() from making its own copy of the data.
+    if (!m_NeedsSpsFixup || du->frameType != FRAME_TYPE_IDR) {
+        m_Pkt->buf = av_buffer_create(reinterpret_cast<uint8_t*>(entry->data),
+                                      du->fullLength + VIDEO_FRAME_BUFFER_PADDING,
+                                      freeFrameBuffer, nullptr, 0);
     }
 
-    // Ensure the decoder buffer is large enough
-    m_DecodeBuffer.reserve(requiredBufferSize + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (m_Pkt->buf != nullptr) {
+        // FFmpeg owns the frame buffer now and will free it when it's done with it
+        void* frameBuffer = LiDetachVideoFrameBuffer(du);
+        SDL_assert(frameBuffer == entry->data);
+        (void)frameBuffer;
 
-    int offset = 0;
-    while (entry != nullptr) {
-        writeBuffer(entry, offset);
-        entry = entry->next;
+        m_Pkt->data = m_Pkt->buf->data;
+        m_Pkt->size = du->fullLength;
     }
+    else {
+        int requiredBufferSize = du->fullLength;
+        if (du->frameType == FRAME_TYPE_IDR) {
+            // Add some extra space in case we need to do an SPS fixup
+            requiredBufferSize += MAX_SPS_EXTRA_SIZE;
+        }
+
+        // Ensure the decoder buffer is large enough
+        m_DecodeBuffer.reserve(requiredBufferSize + AV_INPUT_BUFFER_PADDING_SIZE);
+
+        int offset = 0;
+        while (entry != nullptr) {
+            writeBuffer(entry, offset);
+            entry = entry->next;
+        }
 
-    m_Pkt->data = reinterpret_cast<uint8_t*>(m_DecodeBuffer.data());
-    m_Pkt->size = offset;
+        m_Pkt->data = reinterpret_cast<uint8_t*>(m_DecodeBuffer.data());
+        m_Pkt->size = offset;
+    }
 
     if (du->frameType == FRAME_TYPE_IDR) {
         m_Pkt->flags = AV_PKT_FLAG_KEY;
@@ -1176,9 +1388,15 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
         m_Pkt->flags = 0;
     }
 
-    m_ActiveWndVideoStats.totalReassemblyTime += du->enqueueTimeMs - du->receiveTimeMs;
+    m_ActiveWndVideoStats.reassemblyTimeHistogram.addSample(du->enqueueTimeUs - du->receiveTimeUs);
+
+    Session::get()->getFrameTracer().beginFrame(du);
 
     err = avcodec_send_packet(m_VideoDecoderCtx, m_Pkt);
+
+    // The decoder holds its own reference to the frame buffer if it needs one
+    av_buffer_unref(&m_Pkt->buf);
+
     if (err < 0) {
         char errorstring[512];
         av_strerror(err, errorstring, sizeof(errorstring));
@@ -1203,7 +1421,7 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
         return DR_NEED_IDR;
     }
 
-    m_FrameInfoQueue.enqueue({ du->enqueueTimeMs, du->presentationTimeMs});
+    m_FrameInfoQueue.enqueue({ du->enqueueTimeUs, du->presentationTimeMs, du->frameNumber });
 
     m_FramesIn++;
     return DR_OK;
@@ -4,6 +4,7 @@
 #include <QQueue>
 
 #include "decoder.h"
+#include "decoderprobecache.h"
 #include "ffmpeg-renderers/renderer.h"
 #include "ffmpeg-renderers/pacer/pacer.h"
 
@@ -47,12 +48,21 @@ private:
                                const AVCodecHWConfig* hwConfig,
                                std::function<IFFmpegRenderer*()> createRendererFunc);
 
+    bool tryInitializeCachedChoice(PDECODER_PARAMETERS params,
+                                   const DecoderProbeCache::Choice& choice);
+
+    bool probeDecoders(const AVCodec* decoder,
+                       PDECODER_PARAMETERS params,
+                       DecoderProbeCache::Choice& choice);
+
     static IFFmpegRenderer* createHwAccelRenderer(const AVCodecHWConfig* hwDecodeCfg, int pass);
 
     void reset();
 
     void writeBuffer(PLENTRY entry, int& offset);
 
+    static void freeFrameBuffer(void* opaque, uint8_t* data);
+
     static
     enum AVPixelFormat ffGetFormat(AVCodecContext* context,
                                    const enum AVPixelFormat* pixFmts);
@@ -61,6 +71,8 @@ private:
 
     static int decoderThreadProcThunk(void* context);
 
+    static uint64_t getElapsedUs(Uint64 startTime);
+
     AVPacket* m_Pkt;
     AVCodecContext* m_VideoDecoderCtx;
     QByteArray m_DecodeBuffer;
@@ -69,6 +81,7 @@ private:
     IFFmpegRenderer* m_FrontendRenderer;
     int m_ConsecutiveFailedDecodes;
     Pacer* m_Pacer;
+    AVBufferPool* m_FrameTimestampsPool;
     VIDEO_STATS m_ActiveWndVideoStats;
     VIDEO_STATS m_LastWndVideoStats;
     VIDEO_STATS m_GlobalVideoStats;
@@ -85,8 +98,9 @@ private:
     SDL_atomic_t m_DecoderThreadShouldQuit;
 
     typedef struct {
-        uint64_t enqueueTimeMs;
+        uint64_t enqueueTimeUs;
         uint32_t presentationTimeMs;
+        int frameNumber;
     } FrameInfoTuple;
     QQueue<FrameInfoTuple> m_FrameInfoQueue;
 
@@ -0,0 +1,158 @@
+#include "frametracer.h"
+
+#include <QFile>
+
+#include <SDL.h>
+
+// Each span is drawn on its own track between two recorded stages
+static const struct {
+    const char* name;
+    FrameTracer::Stage start;
+    FrameTracer::Stage end;
+} k_TraceSpans[] = {
+    { "Network receive", FrameTracer::FirstPacketReceived, FrameTracer::FrameComplete },
+    { "Depacketize", FrameTracer::FrameComplete, FrameTracer::DepacketizerEnqueue },
+    { "Decode unit queue", FrameTracer::DepacketizerEnqueue, FrameTracer::DecoderSubmit },
+    { "Decode", FrameTracer::DecoderSubmit, FrameTracer::DecoderOutput },
+    { "Pacer queue", FrameTracer::PacerEnqueue, FrameTracer::RenderStart },
+    { "Render", FrameTracer::RenderStart, FrameTracer::RenderPresent },
+};
+
+FrameTracer::FrameTracer()
+    : m_Enabled(false)
+{
+    for (FrameRecord& record : m_Records) {
+        record.frameNumber.store(0, std::memory_order_relaxed);
+        for (auto& timestamp : record.timestampsUs) {
+            timestamp.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void FrameTracer::setEnabled(bool enabled)
+{
+    m_Enabled = enabled;
+}
+
+void FrameTracer::beginFrame(PDECODE_UNIT du)
+{
+    if (!m_Enabled) {
+        return;
+    }
+
+    FrameRecord& record = getRecord(du->frameNumber);
+
+    // Invalidate the old frame's record before we overwrite it
+    record.frameNumber.store(0, std::memory_order_relaxed);
+
+    for (auto& timestamp : record.timestampsUs) {
+        timestamp.store(0, std::memory_order_relaxed);
+    }
+
+    record.timestampsUs[FirstPacketReceived].store(du->receiveTimeUs, std::memory_order_relaxed);
+    record.timestampsUs[FrameComplete].store(du->frameCompleteTimeUs, std::memory_order_relaxed);
+    record.timestampsUs[DepacketizerEnqueue].store(du->enqueueTimeUs, std::memory_order_relaxed);
+    record.timestampsUs[DecoderSubmit].store(LiGetMicroseconds(), std::memory_order_relaxed);
+
+    record.frameNumber.store(du->frameNumber, std::memory_order_release);
+}
+
+void FrameTracer::recordStage(int frameNumber, Stage stage)
+{
+    if (!m_Enabled) {
+        return;
+    }
+
+    FrameRecord& record = getRecord(frameNumber);
+
+    // Ignore frames whose record has already been recycled
+    if (record.frameNumber.load(std::memory_order_acquire) == frameNumber) {
+        record.timestampsUs[stage].store(LiGetMicroseconds(), std::memory_order_relaxed);
+    }
+}
+
+bool FrameTracer::writeChromeTrace(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to open frame trace file %s: %s",
+                     qPrintable(path),
+                     qPrintable(file.errorString()));
+        return false;
+    }
+
+    // Find the earliest timestamp so the trace starts at 0
+    uint64_t baseTimeUs = UINT64_MAX;
+    for (FrameRecord& record : m_Records) {
+        if (record.frameNumber.load(std::memory_order_acquire) != 0) {
+            uint64_t firstTimeUs = record.timestampsUs[FirstPacketReceived].load(std::memory_order_relaxed);
+            if (firstTimeUs != 0 && firstTimeUs < baseTimeUs) {
+                baseTimeUs = firstTimeUs;
+            }
+        }
+    }
+
+    QByteArray trace;
+    trace.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    // Name each track after the span drawn on it
+    for (int i = 0; i < (int)SDL_arraysize(k_TraceSpans); i++) {
+        trace.append(QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}},\n")
+                     .arg(i).arg(k_TraceSpans[i].name).toUtf8());
+        trace.append(QString("{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"sort_index\":%1}},\n")
+                     .arg(i).toUtf8());
+    }
+
+    int frames = 0;
+    for (FrameRecord& record : m_Records) {
+        int frameNumber = record.frameNumber.load(std::memory_order_acquire);
+        if (frameNumber == 0) {
+            continue;
+        }
+
+        uint64_t timestampsUs[StageMax];
+        for (int i = 0; i < StageMax; i++) {
+            timestampsUs[i] = record.timestampsUs[i].load(std::memory_order_relaxed);
+        }
+
+        for (int i = 0; i < (int)SDL_arraysize(k_TraceSpans); i++) {
+            uint64_t startUs = timestampsUs[k_TraceSpans[i].start];
+            uint64_t endUs = timestampsUs[k_TraceSpans[i].end];
+
+            // Skip stages this frame never reached (dropped by the pacer, etc.)
+            if (startUs == 0 || endUs == 0 || endUs < startUs || startUs < baseTimeUs) {
+                continue;
+            }
+
+            trace.append(QString("{\"name\":\"%1\",\"cat\":\"video\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,"
+                                 "\"ts\":%3,\"dur\":%4,\"args\":{\"frame\":%5}},\n")
+                         .arg(k_TraceSpans[i].name)
+                         .arg(i)
+                         .arg(startUs - baseTimeUs)
+                         .arg(endUs - startUs)
+                         .arg(frameNumber)
+                         .toUtf8());
+        }
+
+        frames++;
+    }
+
+    // Terminate the event list with a dummy metadata event, since
+    // JSON doesn't allow the trailing comma
+    trace.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Video pipeline\"}}\n]}\n");
+
+    if (file.write(trace) != trace.size()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to write frame trace file %s: %s",
+                     qPrintable(path),
+                     qPrintable(file.errorString()));
+        return false;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Wrote trace of %d frames to %s",
+                frames,
+                qPrintable(path));
+    return true;
+}
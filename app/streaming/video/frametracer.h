@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Limelight.h>
+
+#include <QString>
+
+#include <atomic>
+
+// Records a timestamp for each stage of the video pipeline for the most
+// recent frames. The trace can be written out in the Chrome trace event
+// format (viewable in chrome://tracing or Perfetto) to find which stage
+// blew the frame budget when the stream stutters.
+class FrameTracer
+{
+public:
+    enum Stage {
+        FirstPacketReceived,
+        FrameComplete,
+        DepacketizerEnqueue,
+        DecoderSubmit,
+        DecoderOutput,
+        PacerEnqueue,
+        RenderStart,
+        RenderPresent,
+        StageMax
+    };
+
+    FrameTracer();
+
+    void setEnabled(bool enabled);
+
+    bool isEnabled()
+    {
+        return m_Enabled;
+    }
+
+    // Starts the record for a new frame using the timestamps that
+    // moonlight-common-c captured for the decode unit
+    void beginFrame(PDECODE_UNIT du);
+
+    // Timestamps a stage of a frame passed to beginFrame() earlier. This
+    // may be called from any thread.
+    void recordStage(int frameNumber, Stage stage);
+
+    bool writeChromeTrace(const QString& path);
+
+private:
+    // Must be a power of 2
+    static const int k_MaxFrames = 4096;
+
+    struct FrameRecord {
+        std::atomic<int> frameNumber;
+        std::atomic<uint64_t> timestampsUs[StageMax];
+    };
+
+    FrameRecord& getRecord(int frameNumber)
+    {
+        return m_Records[frameNumber & (k_MaxFrames - 1)];
+    }
+
+    bool m_Enabled;
+    FrameRecord m_Records[k_MaxFrames];
+};
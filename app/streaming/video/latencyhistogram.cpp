@@ -0,0 +1,103 @@
+#include "latencyhistogram.h"
+
+int LatencyHistogram::getBucket(uint64_t latencyUs)
+{
+    if (latencyUs < k_FineBuckets * k_FineBucketUs) {
+        return (int)(latencyUs / k_FineBucketUs);
+    }
+
+    latencyUs -= k_FineBuckets * k_FineBucketUs;
+    if (latencyUs < k_CoarseBuckets * k_CoarseBucketUs) {
+        return k_FineBuckets + (int)(latencyUs / k_CoarseBucketUs);
+    }
+
+    return k_Buckets - 1;
+}
+
+uint32_t LatencyHistogram::getBucketLowerBoundUs(int bucket)
+{
+    if (bucket < k_FineBuckets) {
+        return bucket * k_FineBucketUs;
+    }
+
+    return k_FineBuckets * k_FineBucketUs + (bucket - k_FineBuckets) * k_CoarseBucketUs;
+}
+
+void LatencyHistogram::addSample(uint64_t latencyUs)
+{
+    m_Buckets[getBucket(latencyUs)]++;
+    m_SampleCount++;
+    m_MaxUs = SDL_max(m_MaxUs, (uint32_t)SDL_min(latencyUs, (uint64_t)UINT32_MAX));
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+    for (int i = 0; i < k_Buckets; i++) {
+        m_Buckets[i] += other.m_Buckets[i];
+    }
+
+    m_SampleCount += other.m_SampleCount;
+    m_MaxUs = SDL_max(m_MaxUs, other.m_MaxUs);
+}
+
+uint32_t LatencyHistogram::getPercentileUs(int percentile) const
+{
+    // The number of samples at or below the percentile, rounded up
+    uint64_t target = ((uint64_t)m_SampleCount * percentile + 99) / 100;
+    uint64_t seen = 0;
+
+    for (int i = 0; i < k_Buckets - 1; i++) {
+        seen += m_Buckets[i];
+        if (seen >= target && seen != 0) {
+            return SDL_min(getBucketLowerBoundUs(i + 1), m_MaxUs);
+        }
+    }
+
+    // The percentile is in the overflow bucket
+    return m_MaxUs;
+}
+
+int LatencyHistogram::stringifyPercentiles(char* output, int length) const
+{
+    return SDL_snprintf(output, length, "%.2f/%.2f/%.2f/%.2f ms",
+                        getPercentileUs(50) / 1000.0f,
+                        getPercentileUs(95) / 1000.0f,
+                        getPercentileUs(99) / 1000.0f,
+                        m_MaxUs / 1000.0f);
+}
+
+void LatencyHistogram::log(const char* title) const
+{
+    if (m_SampleCount == 0) {
+        return;
+    }
+
+    char percentiles[64];
+    stringifyPercentiles(percentiles, sizeof(percentiles));
+
+    // One line for the buckets keeps the log readable. Each bucket is
+    // written as its lower bound in ms and its sample count.
+    char buckets[4096];
+    int offset = 0;
+
+    for (int i = 0; i < k_Buckets && offset < (int)sizeof(buckets); i++) {
+        if (m_Buckets[i] == 0) {
+            continue;
+        }
+
+        offset += SDL_snprintf(&buckets[offset], sizeof(buckets) - offset,
+                               i == k_Buckets - 1 ? " %.1f+:%u" : " %.1f:%u",
+                               getBucketLowerBoundUs(i) / 1000.0f,
+                               m_Buckets[i]);
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "%s histogram: %u samples (p50/p95/p99/max: %s)",
+                title,
+                m_SampleCount,
+                percentiles);
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "%s buckets (ms:count):%s",
+                title,
+                buckets);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <SDL.h>
+
+// Counts latency samples in fixed buckets: 100 us wide up to 10 ms, 1 ms
+// wide up to 100 ms, and one bucket for anything slower. Adding a sample
+// never allocates, so this can be updated for every frame. It has no
+// constructor so it can live in VIDEO_STATS, which is zeroed with memset.
+class LatencyHistogram
+{
+public:
+    void addSample(uint64_t latencyUs);
+
+    void add(const LatencyHistogram& other);
+
+    uint32_t getSampleCount() const
+    {
+        return m_SampleCount;
+    }
+
+    uint32_t getMaxUs() const
+    {
+        return m_MaxUs;
+    }
+
+    // Returns the upper bound of the bucket that holds the given
+    // percentile, which is never larger than the slowest sample
+    uint32_t getPercentileUs(int percentile) const;
+
+    // Writes "p50/p95/p99/max" in milliseconds
+    int stringifyPercentiles(char* output, int length) const;
+
+    // Logs the percentiles and, on one more line, the sample count of
+    // each non-empty bucket
+    void log(const char* title) const;
+
+private:
+    static const int k_FineBuckets = 100;
+    static const uint32_t k_FineBucketUs = 100;
+    static const int k_CoarseBuckets = 90;
+    static const uint32_t k_CoarseBucketUs = 1000;
+    static const int k_Buckets = k_FineBuckets + k_CoarseBuckets + 1;
+
+    static int getBucket(uint64_t latencyUs);
+
+    static uint32_t getBucketLowerBoundUs(int bucket);
+
+    uint32_t m_Buckets[k_Buckets];
+    uint32_t m_SampleCount;
+    uint32_t m_MaxUs;
+};
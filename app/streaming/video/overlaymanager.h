@@ -13,6 +13,9 @@ enum OverlayType {
     OverlayMax
 };
 
+// Size of the buffer returned by getOverlayText(), including the null terminator
+static const int k_MaxOverlayText = 1024;
+
 class IOverlayRenderer
 {
 public:
@@ -44,7 +47,7 @@ private:
         bool enabled;
         int fontSize;
         SDL_Color color;
-        char text[512];
+        char text[k_MaxOverlayText];
 
         TTF_Font* font;
         SDL_Surface* surface;
@@ -27,6 +27,8 @@ VigemClient::VigemClient(QObject *parent):
     inputGamepad.sThumbRX = 0;
     inputGamepad.sThumbRY = 0;
 
+    report_sender = new VigemReportSender(this);
+
     keyMapper = VigemKeyMapper::createDefault();
 }
 
@@ -56,9 +58,16 @@ VigemClient::VigemClient(const QString & path, QObject * parent):
     inputGamepad.sThumbRX = 0;
     inputGamepad.sThumbRY = 0;
 
+    report_sender = new VigemReportSender(this);
+
     keyMapper = VigemKeyMapper::createDefault();
 }
 
+VigemClient::~VigemClient()
+{
+    report_sender->stop();
+}
+
 const QString &VigemClient::libraryPath() const
 {
     return library_path;
@@ -252,6 +261,10 @@ bool VigemClient::startup(const QString & target)
         return false;
     }
 
+    /* Send whatever state the buttons were left in */
+    report_sender->start(QThread::HighPriority);
+    report_sender->publish(inputGamepad);
+
     emit activated();
 
     return true;
@@ -265,6 +278,8 @@ bool VigemClient::shutdown()
         return false;
     }
 
+    report_sender->stop();
+
     target_remove_function(vigem_client, vigem_target);
     target_free_function(vigem_target);
     disconnect_function(vigem_client);
@@ -283,17 +298,9 @@ bool VigemClient::shutdown()
  */
 VigemClient::VigemError VigemClient::pressA()
 {
-    qDebug() << "VigemClient: trying to press A button";
-
     inputGamepad.wButtons |= GamepadA;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -301,17 +308,9 @@ VigemClient::VigemError VigemClient::pressA()
  */
 VigemClient::VigemError VigemClient::releaseA()
 {
-    qDebug() << "VigemClient: trying to release A button";
-
     inputGamepad.wButtons &=~ GamepadA;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -319,17 +318,9 @@ VigemClient::VigemError VigemClient::releaseA()
  */
 VigemClient::VigemError VigemClient::pressB()
 {
-    qDebug() << "VigemClient: trying to press B button";
-
     inputGamepad.wButtons |= GamepadB;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -337,17 +328,9 @@ VigemClient::VigemError VigemClient::pressB()
  */
 VigemClient::VigemError VigemClient::releaseB()
 {
-    qDebug() << "VigemClient: trying to release B button";
-
     inputGamepad.wButtons &=~ GamepadB;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -355,17 +338,9 @@ VigemClient::VigemError VigemClient::releaseB()
  */
 VigemClient::VigemError VigemClient::pressX()
 {
-    qDebug() << "VigemClient: trying to press X button";
-
     inputGamepad.wButtons |= GamepadX;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -373,17 +348,9 @@ VigemClient::VigemError VigemClient::pressX()
  */
 VigemClient::VigemError VigemClient::releaseX()
 {
-    qDebug() << "VigemClient: trying to release X button";
-
     inputGamepad.wButtons &=~ GamepadX;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -391,17 +358,9 @@ VigemClient::VigemError VigemClient::releaseX()
  */
 VigemClient::VigemError VigemClient::pressY()
 {
-    qDebug() << "VigemClient: trying to press Y button";
-
     inputGamepad.wButtons |= GamepadY;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -409,17 +368,9 @@ VigemClient::VigemError VigemClient::pressY()
  */
 VigemClient::VigemError VigemClient::releaseY()
 {
-    qDebug() << "VigemClient: trying to release Y button";
-
     inputGamepad.wButtons &=~ GamepadY;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -427,17 +378,9 @@ VigemClient::VigemError VigemClient::releaseY()
  */
 VigemClient::VigemError VigemClient::pressUp()
 {
-    qDebug() << "VigemClient: trying to press Up button";
-
     inputGamepad.wButtons |= GamepadUp;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -445,17 +388,9 @@ VigemClient::VigemError VigemClient::pressUp()
  */
 VigemClient::VigemError VigemClient::releaseUp()
 {
-    qDebug() << "VigemClient: trying to release Up button";
-
     inputGamepad.wButtons &=~ GamepadUp;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -463,17 +398,9 @@ VigemClient::VigemError VigemClient::releaseUp()
  */
 VigemClient::VigemError VigemClient::pressDown()
 {
-    qDebug() << "VigemClient: trying to press Down button";
-
     inputGamepad.wButtons |= GamepadDown;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -481,17 +408,9 @@ VigemClient::VigemError VigemClient::pressDown()
  */
 VigemClient::VigemError VigemClient::releaseDown()
 {
-    qDebug() << "VigemClient: trying to release Down button";
-
     inputGamepad.wButtons &=~ GamepadDown;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -499,17 +418,9 @@ VigemClient::VigemError VigemClient::releaseDown()
  */
 VigemClient::VigemError VigemClient::pressLeft()
 {
-    qDebug() << "VigemClient: trying to press Left button";
-
     inputGamepad.wButtons |= GamepadLeft;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -517,17 +428,9 @@ VigemClient::VigemError VigemClient::pressLeft()
  */
 VigemClient::VigemError VigemClient::releaseLeft()
 {
-    qDebug() << "VigemClient: trying to release Left button";
-
     inputGamepad.wButtons &=~ GamepadLeft;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -535,17 +438,9 @@ VigemClient::VigemError VigemClient::releaseLeft()
  */
 VigemClient::VigemError VigemClient::pressRight()
 {
-    qDebug() << "VigemClient: trying to press Right button";
-
     inputGamepad.wButtons |= GamepadRight;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -553,17 +448,9 @@ VigemClient::VigemError VigemClient::pressRight()
  */
 VigemClient::VigemError VigemClient::releaseRight()
 {
-    qDebug() << "VigemClient: trying to release Right button";
-
     inputGamepad.wButtons &=~ GamepadRight;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -571,17 +458,9 @@ VigemClient::VigemError VigemClient::releaseRight()
  */
 VigemClient::VigemError VigemClient::pressStart()
 {
-    qDebug() << "VigemClient: trying to press Start button";
-
     inputGamepad.wButtons |= GamepadStart;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -589,17 +468,9 @@ VigemClient::VigemError VigemClient::pressStart()
  */
 VigemClient::VigemError VigemClient::releaseStart()
 {
-    qDebug() << "VigemClient: trying to release Start button";
-
     inputGamepad.wButtons &=~ GamepadStart;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -607,17 +478,9 @@ VigemClient::VigemError VigemClient::releaseStart()
  */
 VigemClient::VigemError VigemClient::pressBack()
 {
-    qDebug() << "VigemClient: trying to press Back button";
-
     inputGamepad.wButtons |= GamepadBack;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -625,17 +488,9 @@ VigemClient::VigemError VigemClient::pressBack()
  */
 VigemClient::VigemError VigemClient::releaseBack()
 {
-    qDebug() << "VigemClient: trying to release Back button";
-
     inputGamepad.wButtons &=~ GamepadBack;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -643,17 +498,9 @@ VigemClient::VigemError VigemClient::releaseBack()
  */
 VigemClient::VigemError VigemClient::pressLeftThumb()
 {
-    qDebug() << "VigemClient: trying to press Left Thumb button";
-
     inputGamepad.wButtons |= GamepadLeftThumb;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -661,17 +508,9 @@ VigemClient::VigemError VigemClient::pressLeftThumb()
  */
 VigemClient::VigemError VigemClient::releaseLeftThumb()
 {
-    qDebug() << "VigemClient: trying to release Left Thumb button";
-
     inputGamepad.wButtons &=~ GamepadLeftThumb;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -679,17 +518,9 @@ VigemClient::VigemError VigemClient::releaseLeftThumb()
  */
 VigemClient::VigemError VigemClient::pressRightThumb()
 {
-    qDebug() << "VigemClient: trying to press Right Thumb button";
-
     inputGamepad.wButtons |= GamepadRightThumb;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -697,17 +528,9 @@ VigemClient::VigemError VigemClient::pressRightThumb()
  */
 VigemClient::VigemError VigemClient::releaseRightThumb()
 {
-    qDebug() << "VigemClient: trying to release Right Thumb button";
-
     inputGamepad.wButtons &=~ GamepadRightThumb;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -715,17 +538,9 @@ VigemClient::VigemError VigemClient::releaseRightThumb()
  */
 VigemClient::VigemError VigemClient::pressLeftShoulder()
 {
-    qDebug() << "VigemClient: trying to press Left Shoulder button";
-
     inputGamepad.wButtons |= GamepadLeftShoulder;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -733,17 +548,9 @@ VigemClient::VigemError VigemClient::pressLeftShoulder()
  */
 VigemClient::VigemError VigemClient::releaseLeftShoulder()
 {
-    qDebug() << "VigemClient: trying to release Left Shoulder button";
-
     inputGamepad.wButtons &=~ GamepadLeftShoulder;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -751,17 +558,9 @@ VigemClient::VigemError VigemClient::releaseLeftShoulder()
  */
 VigemClient::VigemError VigemClient::pressRightShoulder()
 {
-    qDebug() << "VigemClient: trying to press Right Shoulder button";
-
     inputGamepad.wButtons |= GamepadRightShoulder;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -769,17 +568,9 @@ VigemClient::VigemError VigemClient::pressRightShoulder()
  */
 VigemClient::VigemError VigemClient::releaseRightShoulder()
 {
-    qDebug() << "VigemClient: trying to release Right Shoulder button";
-
     inputGamepad.wButtons &=~ GamepadRightShoulder;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -787,17 +578,9 @@ VigemClient::VigemError VigemClient::releaseRightShoulder()
  */
 VigemClient::VigemError VigemClient::pressLeftTrigger()
 {
-    qDebug() << "VigemClient: trying to press Left Trigger button";
-
     inputGamepad.bLeftTrigger = 0xff;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -805,17 +588,9 @@ VigemClient::VigemError VigemClient::pressLeftTrigger()
  */
 VigemClient::VigemError VigemClient::releaseLeftTrigger()
 {
-    qDebug() << "VigemClient: trying to release Left Trigger button";
-
     inputGamepad.bLeftTrigger = 0;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -823,17 +598,9 @@ VigemClient::VigemError VigemClient::releaseLeftTrigger()
  */
 VigemClient::VigemError VigemClient::pressRightTrigger()
 {
-    qDebug() << "VigemClient: trying to press Right Trigger button";
-
     inputGamepad.bRightTrigger = 0xff;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 /**
@@ -841,289 +608,175 @@ VigemClient::VigemError VigemClient::pressRightTrigger()
  */
 VigemClient::VigemError VigemClient::releaseRightTrigger()
 {
-    qDebug() << "VigemClient: trying to release Right Trigger button";
-
     inputGamepad.bRightTrigger = 0;
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressLeftThumbLeft()
 {
-    qDebug() << "VigemClient: trying to move left thumb to the left";
-
     if (inputGamepad.sThumbLX == 0) {
         inputGamepad.sThumbLX -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseLeftThumbLeft()
 {
-    qDebug() << "VigemClient: trying to release left thumb moved to the left";
-
     if (inputGamepad.sThumbLX < 0) {
         inputGamepad.sThumbLX += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressLeftThumbRight()
 {
-    qDebug() << "VigemClient: trying to move left thumb to the right";
-
     if (inputGamepad.sThumbLX == 0) {
         inputGamepad.sThumbLX += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseLeftThumbRight()
 {
-    qDebug() << "VigemClient: trying to release left thumb moved to the right";
-
     if (inputGamepad.sThumbLX > 0) {
         inputGamepad.sThumbLX -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressLeftThumbUp()
 {
-    qDebug() << "VigemClient: trying to move left thumb up";
-
     if (inputGamepad.sThumbLY == 0) {
         inputGamepad.sThumbLY += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseLeftThumbUp()
 {
-    qDebug() << "VigemClient: trying to release left thumb moved up";
-
     if (inputGamepad.sThumbLY > 0) {
         inputGamepad.sThumbLY -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressLeftThumbDown()
 {
-    qDebug() << "VigemClient: trying to move left thumb down";
-
     if (inputGamepad.sThumbLY == 0) {
         inputGamepad.sThumbLY -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseLeftThumbDown()
 {
-    qDebug() << "VigemClient: trying to release left thumb moved down";
-
     if (inputGamepad.sThumbLY < 0) {
         inputGamepad.sThumbLY += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressRightThumbLeft()
 {
-    qDebug() << "VigemClient: trying to move right thumb to the left";
-
     if (inputGamepad.sThumbRX == 0) {
         inputGamepad.sThumbRX -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseRightThumbLeft()
 {
-    qDebug() << "VigemClient: trying to release right thumb moved to the left";
-
     if (inputGamepad.sThumbRX < 0) {
         inputGamepad.sThumbRX += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressRightThumbRight()
 {
-    qDebug() << "VigemClient: trying to move right thumb to the right";
-
     if (inputGamepad.sThumbRX == 0) {
         inputGamepad.sThumbRX += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseRightThumbRight()
 {
-    qDebug() << "VigemClient: trying to release right thumb moved to the right";
-
     if (inputGamepad.sThumbRX > 0) {
         inputGamepad.sThumbRX -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressRightThumbUp()
 {
-    qDebug() << "VigemClient: trying to move right thumb up";
-
     if (inputGamepad.sThumbRY == 0) {
         inputGamepad.sThumbRY += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseRightThumbUp()
 {
-    qDebug() << "VigemClient: trying to release right thumb moved up";
-
     if (inputGamepad.sThumbRY > 0) {
         inputGamepad.sThumbRY -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::pressRightThumbDown()
 {
-    qDebug() << "VigemClient: trying to move right thumb down";
-
     if (inputGamepad.sThumbRY == 0) {
         inputGamepad.sThumbRY -= 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
-
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
-    }
-
-    return err;
+    return submitReport();
 }
 
 VigemClient::VigemError VigemClient::releaseRightThumbDown()
 {
-    qDebug() << "VigemClient: trying to release right thumb moved down";
-
     if (inputGamepad.sThumbRY < 0) {
         inputGamepad.sThumbRY += 32767;
     }
 
-    VigemError err = target_x360_update_function(vigem_client, vigem_target, inputGamepad);
+    return submitReport();
+}
 
-    if (err != ErrorNone) {
-        qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
+/**
+ * @brief Publish the changed report for the sender thread
+ *
+ * Returns the result of the last report the driver has seen, since this one
+ * is sent asynchronously.
+ */
+VigemClient::VigemError VigemClient::submitReport()
+{
+    report_sender->publish(inputGamepad);
+
+    if (!isActive()) {
+        return ErrorBusInvalidHandle;
     }
 
-    return err;
+    return (VigemError) report_sender->lastError();
+}
+
+VigemClient::VigemError VigemClient::sendReport(const XInputGamepad & report)
+{
+    return target_x360_update_function(vigem_client, vigem_target, report);
 }
 
 VigemClient::VigemError VigemClient::pressButton(Vigem::VigemOperation op)
@@ -9,6 +9,7 @@
 
 #include "vigem_defs.h"
 #include "vigemkeymapper.h"
+#include "vigemreportsender.h"
 
 namespace Vigem {
 
@@ -22,6 +23,8 @@ class VigemClient: public QObject
 {
     Q_OBJECT
 
+    friend class VigemReportSender;
+
 public:
     /* Possible errors returned by ViGEm client library */
     enum VigemError {
@@ -86,6 +89,8 @@ public:
     explicit VigemClient(QObject *parent = nullptr);
     explicit VigemClient(const QString & path, QObject *parent = nullptr);
 
+    virtual ~VigemClient();
+
     const QString & libraryPath() const;
     bool isLoaded() const;
     bool isActive() const;
@@ -220,6 +225,12 @@ public slots:
     VigemError releaseKey(Qt::Key key);
 
 private:
+    /* Hand the changed report to the sender thread */
+    VigemError submitReport();
+
+    /* Called on the sender thread */
+    VigemError sendReport(const XInputGamepad & report);
+
     QString library_path;
 
     VigemKeyMapper keyMapper;
@@ -228,6 +239,8 @@ private:
 
     XInputGamepad inputGamepad;
 
+    VigemReportSender * report_sender;
+
     VigemClientPointer vigem_client;
     VigemTargetPointer vigem_target;
 
@@ -3,19 +3,32 @@
 namespace Vigem {
 
 VigemKeyMapper::VigemKeyMapper():
-    keyMap()
+    keyMap(),
+    operationTable()
 {
 
 }
 
 bool VigemKeyMapper::resolvableKey(Qt::Key key) const
 {
-    return keyMap.values().contains(key);
+    return operationTable.contains(key);
 }
 
 VigemOperation VigemKeyMapper::resolveKey(Qt::Key key) const
 {
-    return keyMap.key(key, ButtonInvalid);
+    return operationTable.value(key, ButtonInvalid);
+}
+
+void VigemKeyMapper::updateOperationTable()
+{
+    operationTable.clear();
+
+    /* Like QMap::key(), the first operation bound to a key wins */
+    for (auto it = keyMap.constBegin(); it != keyMap.constEnd(); ++it) {
+        if (!operationTable.contains(it.value())) {
+            operationTable.insert(it.value(), it.key());
+        }
+    }
 }
 
 QJsonObject VigemKeyMapper::toJson() const
@@ -82,6 +95,8 @@ VigemKeyMapper VigemKeyMapper::createDefault()
  // mapper.keyMap[ButtonStartup] = Qt::Key_Y;
     mapper.keyMap[ButtonShutdown] = Qt::Key_X;
 
+    mapper.updateOperationTable();
+
     return mapper;
 }
 
@@ -102,6 +117,8 @@ VigemKeyMapper VigemKeyMapper::createFromJson(QJsonObject obj)
         }
     }
 
+    mapper.updateOperationTable();
+
     return mapper;
 }
 
@@ -1,6 +1,7 @@
 #ifndef VIGEMKEYMAPPER_H
 #define VIGEMKEYMAPPER_H
 
+#include <QHash>
 #include <QMap>
 #include <QDebug>
 #include <QKeySequence>
@@ -36,7 +37,12 @@ private:
 
     VigemOperation operationFromString(const QString & s);
 
+    void updateOperationTable();
+
     QMap<VigemOperation, Qt::Key> keyMap;
+
+    /* Reverse of keyMap, since every key event is looked up */
+    QHash<int, VigemOperation> operationTable;
 };
 
 }
@@ -0,0 +1,268 @@
+#include "vigemreportsender.h"
+#include "vigemclient.h"
+
+#include <QElapsedTimer>
+
+#ifdef Q_OS_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#ifndef __MINGW32__
+#include <timeapi.h>
+#else
+#include <mmsystem.h>
+#endif
+
+/* Windows 10 1803 and later */
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+/* The XUSB interrupt endpoint of a wired X360 pad is polled every 4 ms */
+#define VIGEM_REPORT_INTERVAL_NS 4000000
+
+namespace Vigem {
+
+/* Every button, trigger, and stick direction as one bit */
+static quint32 activeInputs(const XInputGamepad & report)
+{
+    quint32 inputs = report.wButtons;
+
+    if (report.bLeftTrigger) inputs |= 1 << 16;
+    if (report.bRightTrigger) inputs |= 1 << 17;
+    if (report.sThumbLX < 0) inputs |= 1 << 18;
+    if (report.sThumbLX > 0) inputs |= 1 << 19;
+    if (report.sThumbLY < 0) inputs |= 1 << 20;
+    if (report.sThumbLY > 0) inputs |= 1 << 21;
+    if (report.sThumbRX < 0) inputs |= 1 << 22;
+    if (report.sThumbRX > 0) inputs |= 1 << 23;
+    if (report.sThumbRY < 0) inputs |= 1 << 24;
+    if (report.sThumbRY > 0) inputs |= 1 << 25;
+
+    return inputs;
+}
+
+static void applyInputs(XInputGamepad & report, quint32 inputs)
+{
+    report.wButtons |= (unsigned short) inputs;
+
+    if (inputs & (1 << 16)) report.bLeftTrigger = 0xff;
+    if (inputs & (1 << 17)) report.bRightTrigger = 0xff;
+    if (inputs & (1 << 18)) report.sThumbLX = -32767;
+    if (inputs & (1 << 19)) report.sThumbLX = 32767;
+    if (inputs & (1 << 20)) report.sThumbLY = -32767;
+    if (inputs & (1 << 21)) report.sThumbLY = 32767;
+    if (inputs & (1 << 22)) report.sThumbRX = -32767;
+    if (inputs & (1 << 23)) report.sThumbRX = 32767;
+    if (inputs & (1 << 24)) report.sThumbRY = -32767;
+    if (inputs & (1 << 25)) report.sThumbRY = 32767;
+}
+
+/* Sleeps until the clock reaches the deadline. Sleep() and QThread::usleep()
+ * round up to the 15.6 ms system tick on Windows, so a high resolution
+ * waitable timer is used there when one is available. */
+static void sleepUntil(const QElapsedTimer & clock, qint64 deadlineNs, void * timer)
+{
+    qint64 remainingNs = deadlineNs - clock.nsecsElapsed();
+
+    if (remainingNs <= 0) {
+        return;
+    }
+
+#ifdef Q_OS_WIN32
+    if (timer) {
+        LARGE_INTEGER dueTime;
+
+        /* A negative due time is relative, in 100 ns units */
+        dueTime.QuadPart = -((remainingNs + 99) / 100);
+        if (SetWaitableTimer((HANDLE) timer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+            WaitForSingleObject((HANDLE) timer, INFINITE);
+            return;
+        }
+    }
+#else
+    Q_UNUSED(timer);
+#endif
+
+    QThread::usleep((unsigned long) ((remainingNs + 999) / 1000));
+}
+
+static bool sameReport(const XInputGamepad & a, const XInputGamepad & b)
+{
+    return a.wButtons == b.wButtons &&
+            a.bLeftTrigger == b.bLeftTrigger &&
+            a.bRightTrigger == b.bRightTrigger &&
+            a.sThumbLX == b.sThumbLX &&
+            a.sThumbLY == b.sThumbLY &&
+            a.sThumbRX == b.sThumbRX &&
+            a.sThumbRY == b.sThumbRY;
+}
+
+VigemReportSender::VigemReportSender(VigemClient * client):
+    QThread(client),
+    client(client),
+    sequence(0),
+    buttons_and_left_thumb(0),
+    right_thumb(0),
+    activated_inputs(0),
+    published_inputs(0),
+    pending(0),
+    wakeup(0),
+    last_error(VigemClient::ErrorNone)
+{
+
+}
+
+void VigemReportSender::publish(const XInputGamepad & report)
+{
+    quint64 buttonsAndLeftThumb = (quint64) report.wButtons |
+            ((quint64) report.bLeftTrigger << 16) |
+            ((quint64) report.bRightTrigger << 24) |
+            ((quint64) (quint16) report.sThumbLX << 32) |
+            ((quint64) (quint16) report.sThumbLY << 48);
+    quint32 rightThumb = (quint32) (quint16) report.sThumbRX |
+            ((quint32) (quint16) report.sThumbRY << 16);
+
+    /* Readers retry if the sequence is odd or changed while they read */
+    sequence.fetchAndAddOrdered(1);
+    buttons_and_left_thumb.storeRelease(buttonsAndLeftThumb);
+    right_thumb.storeRelease(rightThumb);
+    sequence.fetchAndAddOrdered(1);
+
+    /* Remember presses, so a tap that is released before the
+     * sender wakes up still reaches the driver */
+    quint32 inputs = activeInputs(report);
+    activated_inputs.fetchAndOrOrdered(inputs & ~published_inputs);
+    published_inputs = inputs;
+
+    /* Only wake the sender if it hasn't been woken for an earlier change yet */
+    if (pending.testAndSetOrdered(0, 1)) {
+        wakeup.release();
+    }
+}
+
+int VigemReportSender::lastError() const
+{
+    return last_error.loadAcquire();
+}
+
+void VigemReportSender::stop()
+{
+    if (isRunning()) {
+        requestInterruption();
+        wakeup.release();
+        wait();
+    }
+}
+
+XInputGamepad VigemReportSender::readReport() const
+{
+    quint32 start;
+    quint64 buttonsAndLeftThumb;
+    quint32 rightThumb;
+
+    do {
+        start = sequence.loadAcquire();
+        buttonsAndLeftThumb = buttons_and_left_thumb.loadAcquire();
+        rightThumb = right_thumb.loadAcquire();
+    } while ((start & 1) || sequence.loadAcquire() != start);
+
+    XInputGamepad report;
+
+    report.wButtons = (unsigned short) buttonsAndLeftThumb;
+    report.bLeftTrigger = (unsigned char) (buttonsAndLeftThumb >> 16);
+    report.bRightTrigger = (unsigned char) (buttonsAndLeftThumb >> 24);
+    report.sThumbLX = (short) (buttonsAndLeftThumb >> 32);
+    report.sThumbLY = (short) (buttonsAndLeftThumb >> 48);
+    report.sThumbRX = (short) rightThumb;
+    report.sThumbRY = (short) (rightThumb >> 16);
+
+    return report;
+}
+
+void VigemReportSender::run()
+{
+    XInputGamepad sent;
+    bool sentReport = false;
+    bool resend = false;
+    void * timer = nullptr;
+    QElapsedTimer clock;
+    qint64 nextSendNs = 0;
+
+#ifdef Q_OS_WIN32
+    bool raisedTimerResolution = false;
+
+    timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!timer) {
+        /* Older versions of Windows only have timers that fire on the system
+         * tick, so shorten the tick while we're running instead */
+        timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        raisedTimerResolution = timeBeginPeriod(1) == TIMERR_NOERROR;
+    }
+#endif
+
+    clock.start();
+
+    while (!isInterruptionRequested()) {
+        if (!resend) {
+            wakeup.acquire();
+
+            if (isInterruptionRequested()) {
+                break;
+            }
+        }
+        resend = false;
+
+        /* Anything published while we wait goes out in this report */
+        sleepUntil(clock, nextSendNs, timer);
+
+        /* Clear this before reading, so a later change wakes us up again */
+        pending.storeRelease(0);
+
+        XInputGamepad report = readReport();
+
+        /* If an input was pressed and released again since the last report,
+         * send it pressed now and the current state one interval later */
+        quint32 missed = activated_inputs.fetchAndStoreOrdered(0) & ~activeInputs(report);
+        if (missed) {
+            applyInputs(report, missed);
+            resend = true;
+        }
+
+        if (sentReport && sameReport(report, sent)) {
+            continue;
+        }
+
+        /* Keep a steady cadence while reports are flowing, but don't
+         * send a burst to catch up after an idle period */
+        qint64 nowNs = clock.nsecsElapsed();
+        if (nowNs - nextSendNs < VIGEM_REPORT_INTERVAL_NS) {
+            nextSendNs += VIGEM_REPORT_INTERVAL_NS;
+        }
+        else {
+            nextSendNs = nowNs + VIGEM_REPORT_INTERVAL_NS;
+        }
+
+        VigemClient::VigemError err = client->sendReport(report);
+
+        /* Only log when the result changes, not for every report */
+        if (err != last_error.loadAcquire() && err != VigemClient::ErrorNone) {
+            qWarning() << "VigemClient: vigem_target_x360_update returned" << err;
+        }
+        last_error.storeRelease(err);
+
+        sent = report;
+        sentReport = true;
+    }
+
+#ifdef Q_OS_WIN32
+    if (raisedTimerResolution) {
+        timeEndPeriod(1);
+    }
+    if (timer) {
+        CloseHandle((HANDLE) timer);
+    }
+#endif
+}
+
+}
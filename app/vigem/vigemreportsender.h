@@ -0,0 +1,64 @@
+#ifndef VIGEMREPORTSENDER_H
+#define VIGEMREPORTSENDER_H
+
+#include <QAtomicInteger>
+#include <QSemaphore>
+#include <QThread>
+
+#include "vigem_defs.h"
+
+namespace Vigem {
+
+class VigemClient;
+
+/**
+ * @brief Sends XUSB reports to the ViGEm bus from a dedicated thread
+ *
+ * The input thread publishes the whole report without taking a lock, and
+ * the sender passes it to the driver at most once per poll interval of a
+ * real X360 pad. Button and axis changes made in the meantime are merged
+ * into the next report instead of costing an IOCTL each.
+ */
+class VigemReportSender : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit VigemReportSender(VigemClient * client);
+
+    /* Publish the current report. Must always be called from the same thread. */
+    void publish(const XInputGamepad & report);
+
+    /* The result of the last report sent to the driver */
+    int lastError() const;
+
+    void stop();
+
+protected:
+    virtual void run();
+
+private:
+    XInputGamepad readReport() const;
+
+    VigemClient * client;
+
+    /* Odd while publish() is writing the report */
+    QAtomicInteger<quint32> sequence;
+
+    /* wButtons, triggers and the left thumb, then the right thumb */
+    QAtomicInteger<quint64> buttons_and_left_thumb;
+    QAtomicInteger<quint32> right_thumb;
+
+    /* Inputs that became active since the sender last read the report */
+    QAtomicInteger<quint32> activated_inputs;
+    quint32 published_inputs;
+
+    QAtomicInt pending;
+    QSemaphore wakeup;
+
+    QAtomicInt last_error;
+};
+
+}
+
+#endif // VIGEMREPORTSENDER_H
@@ -63,15 +63,20 @@ SOURCES += \
     $$COMMON_C_DIR/src/InputStream.c \
     $$COMMON_C_DIR/src/LinkedBlockingQueue.c \
     $$COMMON_C_DIR/src/Misc.c \
+    $$COMMON_C_DIR/src/NetworkImpairment.c \
+    $$COMMON_C_DIR/src/PacketCapture.c \
+    $$COMMON_C_DIR/src/PacketPool.c \
     $$COMMON_C_DIR/src/Platform.c \
     $$COMMON_C_DIR/src/PlatformCrypto.c \
     $$COMMON_C_DIR/src/PlatformSockets.c \
+    $$COMMON_C_DIR/src/RingQueue.c \
     $$COMMON_C_DIR/src/RtpAudioQueue.c \
     $$COMMON_C_DIR/src/RtpVideoQueue.c \
     $$COMMON_C_DIR/src/RtspConnection.c \
     $$COMMON_C_DIR/src/RtspParser.c \
     $$COMMON_C_DIR/src/SdpGenerator.c \
     $$COMMON_C_DIR/src/SimpleStun.c \
+    $$COMMON_C_DIR/src/StartCodeScanner.c \
     $$COMMON_C_DIR/src/VideoDepacketizer.c \
     $$COMMON_C_DIR/src/VideoStream.c
 HEADERS += \
@@ -46,6 +46,25 @@
 #define alloca(x) _alloca(x)
 #endif
 
+/*
+ * Vectorized multiply-accumulate kernels. The x86 kernels are selected at
+ * runtime based on CPUID, so they are compiled with per-function target
+ * attributes rather than requiring -mssse3/-mavx2 for the whole file.
+ */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RS_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RS_TARGET(x)
+#else
+#define RS_TARGET(x) __attribute__((target(x)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define RS_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 typedef unsigned char gf;
 
 #define GF_BITS  8
@@ -81,6 +100,34 @@ static gf __declspec(align (256)) gf_mul_table[(GF_SIZE + 1)*(GF_SIZE + 1)];
 static gf gf_mul_table[(GF_SIZE + 1)*(GF_SIZE + 1)] __attribute__((aligned (256)));
 #endif
 
+/*
+ * Split-nibble product tables for the SIMD kernels:
+ * c*x == gf_mul_lo[c][x & 0xF] ^ gf_mul_hi[c][x >> 4]
+ */
+#ifdef _MSC_VER
+static gf __declspec(align (16)) gf_mul_lo[GF_SIZE + 1][16];
+static gf __declspec(align (16)) gf_mul_hi[GF_SIZE + 1][16];
+#else
+static gf gf_mul_lo[GF_SIZE + 1][16] __attribute__((aligned (16)));
+static gf gf_mul_hi[GF_SIZE + 1][16] __attribute__((aligned (16)));
+#endif
+
+typedef void (*gf_kernel)(gf *dst, gf *src, gf c, int sz);
+
+/*
+ * Inverted decode matrix for one erasure pattern. The key is a bitmap of
+ * the shard rows (data and parity) that were used as decoder inputs, which
+ * also determines which data shards were erased.
+ */
+#define ROW_BITMAP_SIZE ((DATA_SHARDS_MAX + 7) / 8)
+
+typedef struct _rs_decode_matrix {
+    struct _rs_decode_matrix* next;
+    unsigned char rows[ROW_BITMAP_SIZE];
+    int nr_fec_blocks;
+    gf matrix[1];
+} rs_decode_matrix;
+
 /*
  * modnn(x) computes x % GF_SIZE, where GF_SIZE is 2**GF_BITS - 1,
  * without a slow divide.
@@ -93,28 +140,193 @@ static inline gf modnn(int x) {
     return x;
 }
 
-static void addmul(gf *dst1, gf *src1, gf c, int sz) {
+static void addmul_scalar(gf *dst1, gf *src1, gf c, int sz) {
     USE_GF_MULC;
-    if (c != 0) {
-        register gf *dst = dst1, *src = src1;
-        gf *lim = &dst[sz];
+    register gf *dst = dst1, *src = src1;
+    gf *lim = &dst[sz];
+
+    GF_MULC0(c);
+    for (; dst < lim; dst++, src++)
+        GF_ADDMULC(*dst, *src);
+}
+
+static void mul_scalar(gf *dst1, gf *src1, gf c, int sz) {
+    USE_GF_MULC;
+    register gf *dst = dst1, *src = src1;
+    gf *lim = &dst[sz];
+
+    GF_MULC0(c);
+    for (; dst < lim; dst++, src++)
+        GF_MULC(*dst , *src);
+}
+
+#ifdef RS_SIMD_X86
+RS_TARGET("ssse3")
+static void addmul_ssse3(gf *dst, gf *src, gf c, int sz) {
+    __m128i lo = _mm_load_si128((const __m128i*)gf_mul_lo[c]);
+    __m128i hi = _mm_load_si128((const __m128i*)gf_mul_hi[c]);
+    __m128i mask = _mm_set1_epi8(0x0F);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)&src[i]);
+        __m128i out = _mm_loadu_si128((const __m128i*)&dst[i]);
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(in, mask));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(in, 4), mask));
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_xor_si128(out, _mm_xor_si128(l, h)));
+    }
+
+    addmul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+RS_TARGET("ssse3")
+static void mul_ssse3(gf *dst, gf *src, gf c, int sz) {
+    __m128i lo = _mm_load_si128((const __m128i*)gf_mul_lo[c]);
+    __m128i hi = _mm_load_si128((const __m128i*)gf_mul_hi[c]);
+    __m128i mask = _mm_set1_epi8(0x0F);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)&src[i]);
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(in, mask));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(in, 4), mask));
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_xor_si128(l, h));
+    }
+
+    mul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+RS_TARGET("avx2")
+static void addmul_avx2(gf *dst, gf *src, gf c, int sz) {
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)gf_mul_lo[c]));
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)gf_mul_hi[c]));
+    __m256i mask = _mm256_set1_epi8(0x0F);
+    int i;
+
+    for (i = 0; i + 32 <= sz; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)&src[i]);
+        __m256i out = _mm256_loadu_si256((const __m256i*)&dst[i]);
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(in, mask));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(in, 4), mask));
+        _mm256_storeu_si256((__m256i*)&dst[i], _mm256_xor_si256(out, _mm256_xor_si256(l, h)));
+    }
 
-        GF_MULC0(c);
-        for (; dst < lim; dst++, src++)
-            GF_ADDMULC(*dst, *src);
+    addmul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+RS_TARGET("avx2")
+static void mul_avx2(gf *dst, gf *src, gf c, int sz) {
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)gf_mul_lo[c]));
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)gf_mul_hi[c]));
+    __m256i mask = _mm256_set1_epi8(0x0F);
+    int i;
+
+    for (i = 0; i + 32 <= sz; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)&src[i]);
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(in, mask));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(in, 4), mask));
+        _mm256_storeu_si256((__m256i*)&dst[i], _mm256_xor_si256(l, h));
     }
+
+    mul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+#ifdef _MSC_VER
+static int cpu_has_ssse3(void) {
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+}
+
+static int cpu_has_avx2(void) {
+    int info[4];
+
+    /* AVX2 also requires the OS to save the YMM state (OSXSAVE + XCR0) */
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+        return 0;
+
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return 0;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+#else
+static int cpu_has_ssse3(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+static int cpu_has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif
+
+#ifdef RS_SIMD_NEON
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define RS_VTBL16(tbl, idx) vqtbl1q_u8(tbl, idx)
+#else
+static inline uint8x16_t rs_vtbl16(uint8x16_t tbl, uint8x16_t idx) {
+    uint8x8x2_t t;
+    t.val[0] = vget_low_u8(tbl);
+    t.val[1] = vget_high_u8(tbl);
+    return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+}
+#define RS_VTBL16(tbl, idx) rs_vtbl16(tbl, idx)
+#endif
+
+static void addmul_neon(gf *dst, gf *src, gf c, int sz) {
+    uint8x16_t lo = vld1q_u8(gf_mul_lo[c]);
+    uint8x16_t hi = vld1q_u8(gf_mul_hi[c]);
+    uint8x16_t mask = vdupq_n_u8(0x0F);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+        uint8x16_t in = vld1q_u8(&src[i]);
+        uint8x16_t out = vld1q_u8(&dst[i]);
+        uint8x16_t l = RS_VTBL16(lo, vandq_u8(in, mask));
+        uint8x16_t h = RS_VTBL16(hi, vshrq_n_u8(in, 4));
+        vst1q_u8(&dst[i], veorq_u8(out, veorq_u8(l, h)));
+    }
+
+    addmul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+static void mul_neon(gf *dst, gf *src, gf c, int sz) {
+    uint8x16_t lo = vld1q_u8(gf_mul_lo[c]);
+    uint8x16_t hi = vld1q_u8(gf_mul_hi[c]);
+    uint8x16_t mask = vdupq_n_u8(0x0F);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+        uint8x16_t in = vld1q_u8(&src[i]);
+        uint8x16_t l = RS_VTBL16(lo, vandq_u8(in, mask));
+        uint8x16_t h = RS_VTBL16(hi, vshrq_n_u8(in, 4));
+        vst1q_u8(&dst[i], veorq_u8(l, h));
+    }
+
+    mul_scalar(&dst[i], &src[i], c, sz - i);
+}
+#endif
+
+/* selected by select_kernels() */
+static gf_kernel addmul_kernel = addmul_scalar;
+static gf_kernel mul_kernel = mul_scalar;
+
+static void addmul(gf *dst1, gf *src1, gf c, int sz) {
+    if (c != 0)
+        addmul_kernel(dst1, src1, c, sz);
 }
 
 static void mul(gf *dst1, gf *src1, gf c, int sz) {
-    USE_GF_MULC;
-    if (c != 0) {
-        register gf *dst = dst1, *src = src1;
-        gf *lim = &dst[sz];
-        GF_MULC0(c);
-        for (; dst < lim; dst++, src++)
-            GF_MULC(*dst , *src);
-    } else
-        memset(dst1, 0, c);
+    if (c != 0)
+        mul_kernel(dst1, src1, c, sz);
+    else
+        memset(dst1, 0, sz);
 }
 
 /* y = a.dot(b) */
@@ -149,6 +361,81 @@ static void init_mul_table(void) {
 
     for (j=0; j< GF_SIZE+1; j++)
         gf_mul_table[j] = gf_mul_table[j<<8] = 0;
+
+    for (i=0; i< GF_SIZE+1; i++) {
+        for (j=0; j<16; j++) {
+            gf_mul_lo[i][j] = gf_mul(i, j);
+            gf_mul_hi[i][j] = gf_mul(i, (j << 4));
+        }
+    }
+}
+
+#ifdef LC_DEBUG
+/*
+ * Check that the selected kernels are bit-exact with the scalar
+ * reference for every constant, including the unaligned tail.
+ */
+static void validate_kernels(void) {
+    gf src[1027], expected[1027], actual[1027];
+    int c, i;
+
+    for (i = 0; i < (int)sizeof(src); i++)
+        src[i] = (gf)(i * 7 + 3);
+
+    for (c = 1; c <= GF_SIZE; c++) {
+        mul_scalar(expected, src, (gf)c, sizeof(src));
+        mul_kernel(actual, src, (gf)c, sizeof(src));
+        assert(memcmp(expected, actual, sizeof(src)) == 0);
+
+        addmul_scalar(expected, src + 1, (gf)c, sizeof(src) - 1);
+        addmul_kernel(actual, src + 1, (gf)c, sizeof(src) - 1);
+        assert(memcmp(expected, actual, sizeof(src)) == 0);
+    }
+}
+#endif
+
+static void select_kernels(void) {
+#if defined(RS_SIMD_X86)
+    if (reed_solomon_set_kernel(RS_KERNEL_AVX2) != 0)
+        reed_solomon_set_kernel(RS_KERNEL_SSSE3);
+#elif defined(RS_SIMD_NEON)
+    reed_solomon_set_kernel(RS_KERNEL_NEON);
+#endif
+}
+
+int reed_solomon_set_kernel(int kernel) {
+    switch (kernel) {
+    case RS_KERNEL_SCALAR:
+        addmul_kernel = addmul_scalar;
+        mul_kernel = mul_scalar;
+        break;
+#if defined(RS_SIMD_X86)
+    case RS_KERNEL_SSSE3:
+        if (!cpu_has_ssse3())
+            return -1;
+        addmul_kernel = addmul_ssse3;
+        mul_kernel = mul_ssse3;
+        break;
+    case RS_KERNEL_AVX2:
+        if (!cpu_has_avx2())
+            return -1;
+        addmul_kernel = addmul_avx2;
+        mul_kernel = mul_avx2;
+        break;
+#elif defined(RS_SIMD_NEON)
+    case RS_KERNEL_NEON:
+        addmul_kernel = addmul_neon;
+        mul_kernel = mul_neon;
+        break;
+#endif
+    default:
+        return -1;
+    }
+
+#ifdef LC_DEBUG
+    validate_kernels();
+#endif
+    return 0;
 }
 
 /*
@@ -380,6 +667,7 @@ static inline int code_some_shards(gf* matrixRows, gf** inputs, gf** outputs, in
 void reed_solomon_init(void) {
     generate_gf();
     init_mul_table();
+    select_kernels();
 }
 
 reed_solomon* reed_solomon_new(int data_shards, int parity_shards) {
@@ -398,6 +686,10 @@ reed_solomon* reed_solomon_new(int data_shards, int parity_shards) {
         rs->shards = (data_shards + parity_shards);
         rs->m = NULL;
         rs->parity = NULL;
+        rs->decode_cache = NULL;
+        rs->decode_cache_size = 0;
+        rs->decode_cache_hits = 0;
+        rs->decode_cache_misses = 0;
 
         if (rs->shards > DATA_SHARDS_MAX || data_shards <= 0 || parity_shards <= 0) {
             err = 1;
@@ -473,6 +765,12 @@ reed_solomon* reed_solomon_new(int data_shards, int parity_shards) {
 
 void reed_solomon_release(reed_solomon* rs) {
     if (NULL != rs) {
+        while (NULL != rs->decode_cache) {
+            rs_decode_matrix* entry = rs->decode_cache;
+            rs->decode_cache = entry->next;
+            free(entry);
+        }
+
         if (NULL != rs->m)
             free(rs->m);
 
@@ -483,6 +781,103 @@ void reed_solomon_release(reed_solomon* rs) {
     }
 }
 
+void reed_solomon_cache_init(reed_solomon_cache* cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+static void fold_decode_stats(reed_solomon_cache* cache, reed_solomon* rs) {
+    cache->decode_cache_hits += rs->decode_cache_hits;
+    cache->decode_cache_misses += rs->decode_cache_misses;
+}
+
+reed_solomon* reed_solomon_cache_get(reed_solomon_cache* cache, int data_shards, int parity_shards) {
+    reed_solomon* rs;
+    int i;
+
+    for (i = 0; i < cache->count; i++) {
+        rs = cache->encoders[i];
+        if (rs->data_shards == data_shards && rs->parity_shards == parity_shards) {
+            /* move to the front */
+            memmove(&cache->encoders[1], &cache->encoders[0], i * sizeof(rs));
+            cache->encoders[0] = rs;
+            cache->hits++;
+            return rs;
+        }
+    }
+
+    cache->misses++;
+
+    rs = reed_solomon_new(data_shards, parity_shards);
+    if (NULL == rs)
+        return NULL;
+
+    if (cache->count == ENCODER_CACHE_MAX) {
+        /* evict the least recently used */
+        cache->count--;
+        fold_decode_stats(cache, cache->encoders[cache->count]);
+        reed_solomon_release(cache->encoders[cache->count]);
+    }
+
+    memmove(&cache->encoders[1], &cache->encoders[0], cache->count * sizeof(rs));
+    cache->encoders[0] = rs;
+    cache->count++;
+
+    return rs;
+}
+
+void reed_solomon_cache_release(reed_solomon_cache* cache) {
+    while (cache->count > 0) {
+        cache->count--;
+        fold_decode_stats(cache, cache->encoders[cache->count]);
+        reed_solomon_release(cache->encoders[cache->count]);
+    }
+}
+
+static rs_decode_matrix* find_decode_matrix(reed_solomon* rs, unsigned char* rows, int nr_fec_blocks) {
+    rs_decode_matrix *entry, *prev = NULL;
+
+    for (entry = rs->decode_cache; NULL != entry; prev = entry, entry = entry->next) {
+        if (entry->nr_fec_blocks == nr_fec_blocks && 0 == memcmp(entry->rows, rows, ROW_BITMAP_SIZE)) {
+            if (NULL != prev) {
+                /* move to the front */
+                prev->next = entry->next;
+                entry->next = rs->decode_cache;
+                rs->decode_cache = entry;
+            }
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static void insert_decode_matrix(reed_solomon* rs, unsigned char* rows, int nr_fec_blocks, gf* matrix) {
+    rs_decode_matrix* entry;
+
+    if (rs->decode_cache_size == DECODE_CACHE_MAX) {
+        /* evict the least recently used */
+        rs_decode_matrix** tail = &rs->decode_cache;
+        while (NULL != (*tail)->next)
+            tail = &(*tail)->next;
+
+        free(*tail);
+        *tail = NULL;
+        rs->decode_cache_size--;
+    }
+
+    entry = (rs_decode_matrix*)malloc(sizeof(*entry) + nr_fec_blocks * rs->data_shards);
+    if (NULL == entry)
+        return;
+
+    memcpy(entry->rows, rows, ROW_BITMAP_SIZE);
+    entry->nr_fec_blocks = nr_fec_blocks;
+    memcpy(entry->matrix, matrix, nr_fec_blocks * rs->data_shards);
+
+    entry->next = rs->decode_cache;
+    rs->decode_cache = entry;
+    rs->decode_cache_size++;
+}
+
 /**
  * decode one shard
  * input:
@@ -498,6 +893,8 @@ static int reed_solomon_decode(reed_solomon* rs, unsigned char **data_blocks, in
     gf dataDecodeMatrix[DATA_SHARDS_MAX*DATA_SHARDS_MAX];
     unsigned char* subShards[DATA_SHARDS_MAX];
     unsigned char* outputs[DATA_SHARDS_MAX];
+    unsigned char rows[ROW_BITMAP_SIZE];
+    rs_decode_matrix* cached;
     gf* m = rs->m;
     int i, j, c, swap, subMatrixRow, dataShards;
 
@@ -524,39 +921,60 @@ static int reed_solomon_decode(reed_solomon* rs, unsigned char **data_blocks, in
     j = 0;
     subMatrixRow = 0;
     dataShards = rs->data_shards;
+    memset(rows, 0, sizeof(rows));
     for (i = 0; i < dataShards; i++) {
         if (j < nr_fec_blocks && i == (int)erased_blocks[j])
             j++;
         else {
             /* this row is ok */
-            for (c = 0; c < dataShards; c++)
-                dataDecodeMatrix[subMatrixRow*dataShards + c] = m[i*dataShards + c];
-
+            rows[i / 8] |= 1 << (i % 8);
             subShards[subMatrixRow] = data_blocks[i];
             subMatrixRow++;
         }
     }
 
     for (i = 0; i < nr_fec_blocks && subMatrixRow < dataShards; i++) {
-        subShards[subMatrixRow] = dec_fec_blocks[i];
         j = dataShards + fec_block_nos[i];
-        for (c = 0; c < dataShards; c++)
-            dataDecodeMatrix[subMatrixRow*dataShards + c] = m[j*dataShards + c];
-
+        rows[j / 8] |= 1 << (j % 8);
+        subShards[subMatrixRow] = dec_fec_blocks[i];
         subMatrixRow++;
     }
 
     if (subMatrixRow < dataShards)
         return -1;
 
-    invert_mat(dataDecodeMatrix, dataShards);
+    for (i = 0; i < nr_fec_blocks; i++)
+        outputs[i] = data_blocks[erased_blocks[i]];
+
+    /* the same erasure pattern tends to repeat, so reuse the inverted matrix if we can */
+    cached = find_decode_matrix(rs, rows, nr_fec_blocks);
+    if (NULL != cached) {
+        rs->decode_cache_hits++;
+        return code_some_shards(cached->matrix, subShards, outputs, dataShards, nr_fec_blocks, block_size);
+    }
+
+    rs->decode_cache_misses++;
+
+    subMatrixRow = 0;
+    for (i = 0; i < rs->shards; i++) {
+        if (rows[i / 8] & (1 << (i % 8))) {
+            for (c = 0; c < dataShards; c++)
+                dataDecodeMatrix[subMatrixRow*dataShards + c] = m[i*dataShards + c];
+
+            subMatrixRow++;
+        }
+    }
+
+    if (0 != invert_mat(dataDecodeMatrix, dataShards))
+        return -1;
 
     for (i = 0; i < nr_fec_blocks; i++) {
         j = erased_blocks[i];
-        outputs[i] = data_blocks[j];
         memmove(dataDecodeMatrix+i*dataShards, dataDecodeMatrix+j*dataShards, dataShards);
     }
 
+    insert_decode_matrix(rs, rows, nr_fec_blocks, dataDecodeMatrix);
+
     return code_some_shards(dataDecodeMatrix, subShards, outputs, dataShards, nr_fec_blocks, block_size);
 }
 
@@ -624,10 +1042,13 @@ int reed_solomon_reconstruct(reed_solomon* rs, unsigned char** shards, unsigned
                 }
             }
 
-            if (dn == pn) {
-                reed_solomon_decode(rs, data_blocks, block_size, dec_fec_blocks, fec_block_nos, erased_blocks, dn);
-            } else
-                err = -1;
+            if (dn != pn)
+                return -1;
+
+            /* a singular decode matrix leaves the erased blocks unrecovered */
+            err = reed_solomon_decode(rs, data_blocks, block_size, dec_fec_blocks, fec_block_nos, erased_blocks, dn);
+            if (0 != err)
+                return err;
         }
         data_blocks += ds;
         marks += ds;
@@ -4,22 +4,70 @@
 /* use small value to save memory */
 #define DATA_SHARDS_MAX 255
 
+/* number of inverted decode matrices kept per reed_solomon */
+#define DECODE_CACHE_MAX 16
+
+/* number of reed_solomon objects kept by a reed_solomon_cache */
+#define ENCODER_CACHE_MAX 8
+
+struct _rs_decode_matrix;
+
 typedef struct _reed_solomon {
     int data_shards;
     int parity_shards;
     int shards;
     unsigned char* m;
     unsigned char* parity;
+
+    /* LRU of inverted decode matrices keyed by erasure pattern, MRU first */
+    struct _rs_decode_matrix* decode_cache;
+    int decode_cache_size;
+    unsigned int decode_cache_hits;
+    unsigned int decode_cache_misses;
 } reed_solomon;
 
+/* LRU of reed_solomon objects keyed by shape, MRU first */
+typedef struct _reed_solomon_cache {
+    reed_solomon* encoders[ENCODER_CACHE_MAX];
+    int count;
+    unsigned int hits;
+    unsigned int misses;
+
+    /* decode matrix statistics folded in from released encoders */
+    unsigned int decode_cache_hits;
+    unsigned int decode_cache_misses;
+} reed_solomon_cache;
+
 /**
  * MUST initial one time
  * */
 void reed_solomon_init(void);
 
+/* GF(2^8) kernels. reed_solomon_init() picks the fastest one the CPU supports */
+#define RS_KERNEL_SCALAR 0
+#define RS_KERNEL_SSSE3  1
+#define RS_KERNEL_AVX2   2
+#define RS_KERNEL_NEON   3
+
+/**
+ * force a kernel after reed_solomon_init(), for testing.
+ * returns -1 and keeps the current kernel if it isn't
+ * available on this CPU or build.
+ * */
+int reed_solomon_set_kernel(int kernel);
+
 reed_solomon* reed_solomon_new(int data_shards, int parity_shards);
 void reed_solomon_release(reed_solomon* rs);
 
+/**
+ * get a reed_solomon for the given shape from the cache, creating
+ * one (and evicting the least recently used) if it isn't present.
+ * the returned object is owned by the cache.
+ * */
+void reed_solomon_cache_init(reed_solomon_cache* cache);
+reed_solomon* reed_solomon_cache_get(reed_solomon_cache* cache, int data_shards, int parity_shards);
+void reed_solomon_cache_release(reed_solomon_cache* cache);
+
 /**
  * encode a big size of buffer
  * input:
@@ -4,6 +4,7 @@ static SOCKET rtpSocket = INVALID_SOCKET;
 
 static LINKED_BLOCKING_QUEUE packetQueue;
 static RTP_AUDIO_QUEUE rtpAudioQueue;
+static PACKET_IMPAIRMENT impairment;
 
 static PLT_THREAD udpPingThread;
 static PLT_THREAD receiveThread;
@@ -69,10 +70,14 @@ static void AudioPingThreadProc(void* context) {
     }
 }
 
-// Initialize the audio stream and start
-int initializeAudioStream(void) {
+static void* allocateAudioPacket(void) {
+    return malloc(sizeof(QUEUED_AUDIO_PACKET));
+}
+
+static void initializeAudioState(void) {
     LbqInitializeLinkedBlockingQueue(&packetQueue, 30);
     RtpaInitializeQueue(&rtpAudioQueue);
+    ImpInitializeImpairment(&impairment, "Audio", allocateAudioPacket, free);
     lastSeq = 0;
     receivedDataFromPeer = false;
     pingThreadStarted = false;
@@ -85,6 +90,11 @@ int initializeAudioStream(void) {
     // Copy and byte-swap the AV RI key ID used for the audio encryption IV
     memcpy(&avRiKeyId, StreamConfig.remoteInputAesIv, sizeof(avRiKeyId));
     avRiKeyId = BE32(avRiKeyId);
+}
+
+// Initialize the audio stream and start
+int initializeAudioStream(void) {
+    initializeAudioState();
 
     // For GFE 3.22 compatibility, we must start the audio ping thread before the RTSP handshake.
     // It will not reply to our RTSP PLAY request until the audio ping has been received.
@@ -143,6 +153,7 @@ void destroyAudioStream(void) {
     PltDestroyCryptoContext(audioDecryptionCtx);
     freePacketList(LbqDestroyLinkedBlockingQueue(&packetQueue));
     RtpaCleanupQueue(&rtpAudioQueue);
+    ImpCleanupImpairment(&impairment);
 }
 
 static bool queuePacketToLbq(PQUEUED_AUDIO_PACKET* packet) {
@@ -240,18 +251,121 @@ static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
     }
 }
 
+// Hands a received packet to the RTP queue and passes any packets that are ready on
+// to the decoder. *packet is set to NULL if ownership was taken. Returns false if
+// the stream is stopping.
+static bool handleReceivedPacket(PQUEUED_AUDIO_PACKET* packet) {
+    PRTP_PACKET rtp;
+    int queueStatus;
+
+    // Convert fields to host byte-order
+    rtp = (PRTP_PACKET)&(*packet)->data[0];
+    rtp->sequenceNumber = BE16(rtp->sequenceNumber);
+    rtp->timestamp = BE32(rtp->timestamp);
+    rtp->ssrc = BE32(rtp->ssrc);
+
+    queueStatus = RtpaAddPacket(&rtpAudioQueue, rtp, (uint16_t)(*packet)->header.size);
+    if (RTPQ_HANDLE_NOW(queueStatus)) {
+        if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+            if (!queuePacketToLbq(packet)) {
+                // An exit signal was received
+                return false;
+            }
+            else {
+                // Ownership should have been taken by the LBQ
+                LC_ASSERT(*packet == NULL);
+            }
+        }
+        else {
+            decodeInputData(*packet);
+        }
+    }
+    else {
+        if (RTPQ_PACKET_CONSUMED(queueStatus)) {
+            // The queue consumed our packet, so we must allocate a new one
+            *packet = NULL;
+        }
+
+        if (RTPQ_PACKET_READY(queueStatus)) {
+            // If packets are ready, pull them and send them to the decoder
+            uint16_t length;
+            PQUEUED_AUDIO_PACKET queuedPacket;
+            while ((queuedPacket = (PQUEUED_AUDIO_PACKET)RtpaGetQueuedPacket(&rtpAudioQueue, sizeof(QUEUED_AUDIO_PACKET_HEADER), &length)) != NULL) {
+                // Populate header data (not preserved in queued packets)
+                queuedPacket->header.size = length;
+
+                if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+                    if (!queuePacketToLbq(&queuedPacket)) {
+                        // An exit signal was received
+                        free(queuedPacket);
+                        return false;
+                    }
+                    else {
+                        // Ownership should have been taken by the LBQ
+                        LC_ASSERT(queuedPacket == NULL);
+                    }
+                }
+                else {
+                    decodeInputData(queuedPacket);
+                    free(queuedPacket);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// Hands a received packet to the impairment stage if it's enabled, otherwise
+// directly to the RTP queue. Same ownership rules as handleReceivedPacket().
+static bool submitReceivedPacket(PQUEUED_AUDIO_PACKET* packet) {
+    if (impairment.enabled) {
+        // The whole allocation is passed so duplicates keep the header
+        ImpSubmitPacket(&impairment, (char*)*packet, sizeof(**packet));
+        *packet = NULL;
+        return true;
+    }
+
+    return handleReceivedPacket(packet);
+}
+
+// Passes any packets released by the impairment stage on to the RTP queue.
+// Returns false if the stream is stopping.
+static bool deliverImpairedPackets(void) {
+    char* buffer;
+    int length;
+
+    while (ImpGetPacket(&impairment, &buffer, &length)) {
+        PQUEUED_AUDIO_PACKET packet = (PQUEUED_AUDIO_PACKET)buffer;
+        bool ret = handleReceivedPacket(&packet);
+
+        if (packet != NULL) {
+            free(packet);
+        }
+
+        if (!ret) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static void AudioReceiveThreadProc(void* context) {
     PRTP_PACKET rtp;
     PQUEUED_AUDIO_PACKET packet;
-    int queueStatus;
     bool useSelect;
     uint32_t packetsToDrop;
+    int recvTimeoutMs;
     int waitingForAudioMs;
 
     packet = NULL;
     packetsToDrop = 500 / AudioPacketDuration;
 
-    if (setNonFatalRecvTimeoutMs(rtpSocket, UDP_RECV_POLL_TIMEOUT_MS) < 0) {
+    // Wake up often enough to release packets delayed by the impairment stage on time
+    recvTimeoutMs = (impairment.enabled && impairment.config.jitterMs > 0) ? 1 : UDP_RECV_POLL_TIMEOUT_MS;
+
+    if (setNonFatalRecvTimeoutMs(rtpSocket, recvTimeoutMs) < 0) {
         // SO_RCVTIMEO failed, so use select() to wait
         useSelect = true;
     }
@@ -279,9 +393,13 @@ static void AudioReceiveThreadProc(void* context) {
         }
         else if (packet->header.size == 0) {
             // Receive timed out; try again
-            
+            if (!deliverImpairedPackets()) {
+                // An exit signal was received
+                break;
+            }
+
             if (!receivedDataFromPeer) {
-                waitingForAudioMs += UDP_RECV_POLL_TIMEOUT_MS;
+                waitingForAudioMs += recvTimeoutMs;
             }
             else {
                 // If we hit this path, there are no queued audio packets on the host PC,
@@ -319,63 +437,12 @@ static void AudioReceiveThreadProc(void* context) {
             continue;
         }
 
-        // Convert fields to host byte-order
-        rtp->sequenceNumber = BE16(rtp->sequenceNumber);
-        rtp->timestamp = BE32(rtp->timestamp);
-        rtp->ssrc = BE32(rtp->ssrc);
-
-        queueStatus = RtpaAddPacket(&rtpAudioQueue, (PRTP_PACKET)&packet->data[0], (uint16_t)packet->header.size);
-        if (RTPQ_HANDLE_NOW(queueStatus)) {
-            if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                if (!queuePacketToLbq(&packet)) {
-                    // An exit signal was received
-                    break;
-                }
-                else {
-                    // Ownership should have been taken by the LBQ
-                    LC_ASSERT(packet == NULL);
-                }
-            }
-            else {
-                decodeInputData(packet);
-            }
-        }
-        else {
-            if (RTPQ_PACKET_CONSUMED(queueStatus)) {
-                // The queue consumed our packet, so we must allocate a new one
-                packet = NULL;
-            }
+        // Capture the packet exactly as it arrived from the network
+        capturePacket(CAPTURE_STREAM_AUDIO, packet->data, packet->header.size);
 
-            if (RTPQ_PACKET_READY(queueStatus)) {
-                // If packets are ready, pull them and send them to the decoder
-                uint16_t length;
-                PQUEUED_AUDIO_PACKET queuedPacket;
-                while ((queuedPacket = (PQUEUED_AUDIO_PACKET)RtpaGetQueuedPacket(&rtpAudioQueue, sizeof(QUEUED_AUDIO_PACKET_HEADER), &length)) != NULL) {
-                    // Populate header data (not preserved in queued packets)
-                    queuedPacket->header.size = length;
-
-                    if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                        if (!queuePacketToLbq(&queuedPacket)) {
-                            // An exit signal was received
-                            free(queuedPacket);
-                            break;
-                        }
-                        else {
-                            // Ownership should have been taken by the LBQ
-                            LC_ASSERT(queuedPacket == NULL);
-                        }
-                    }
-                    else {
-                        decodeInputData(queuedPacket);
-                        free(queuedPacket);
-                    }
-                }
-                
-                // Break on exit
-                if (queuedPacket != NULL) {
-                    break;
-                }
-            }
+        if (!submitReceivedPacket(&packet) || !deliverImpairedPackets()) {
+            // An exit signal was received
+            break;
         }
     }
     
@@ -428,8 +495,7 @@ void stopAudioStream(void) {
     AudioCallbacks.cleanup();
 }
 
-int startAudioStream(void* audioContext, int arFlags) {
-    int err;
+static int initializeAudioRenderer(void* audioContext, int arFlags) {
     OPUS_MULTISTREAM_CONFIGURATION chosenConfig;
 
     if (HighQualitySurroundEnabled) {
@@ -446,7 +512,13 @@ int startAudioStream(void* audioContext, int arFlags) {
 
     chosenConfig.samplesPerFrame = 48 * AudioPacketDuration;
 
-    err = AudioCallbacks.init(StreamConfig.audioConfiguration, &chosenConfig, audioContext, arFlags);
+    return AudioCallbacks.init(StreamConfig.audioConfiguration, &chosenConfig, audioContext, arFlags);
+}
+
+int startAudioStream(void* audioContext, int arFlags) {
+    int err;
+
+    err = initializeAudioRenderer(audioContext, arFlags);
     if (err != 0) {
         return err;
     }
@@ -477,6 +549,76 @@ int startAudioStream(void* audioContext, int arFlags) {
     return 0;
 }
 
+// Feeds a packet from a capture file into the RTP queue as if it was just received
+bool replayAudioPacket(const char* data, int length) {
+    PQUEUED_AUDIO_PACKET packet;
+    bool ret;
+
+    if (length < (int)sizeof(RTP_PACKET) || length > MAX_PACKET_SIZE) {
+        // Not a packet we would have received
+        return true;
+    }
+
+    packet = (PQUEUED_AUDIO_PACKET)malloc(sizeof(*packet));
+    if (packet == NULL) {
+        return false;
+    }
+
+    memcpy(packet->data, data, length);
+    packet->header.size = length;
+
+    ret = submitReceivedPacket(&packet);
+
+    if (packet != NULL) {
+        free(packet);
+    }
+
+    return ret && deliverImpairedPackets();
+}
+
+// Starts the decoder without any network threads for packet capture replay
+int startAudioReplay(void* audioContext, int arFlags) {
+    int err;
+
+    initializeAudioState();
+
+    err = initializeAudioRenderer(audioContext, arFlags);
+    if (err != 0) {
+        destroyAudioStream();
+        return err;
+    }
+
+    AudioCallbacks.start();
+
+    if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+        err = PltCreateThread("AudioDec", AudioDecoderThreadProc, NULL, &decoderThread);
+        if (err != 0) {
+            AudioCallbacks.stop();
+            AudioCallbacks.cleanup();
+            destroyAudioStream();
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+void stopAudioReplay(void) {
+    AudioCallbacks.stop();
+
+    if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+        LbqSignalQueueShutdown(&packetQueue);
+        PltInterruptThread(&decoderThread);
+        PltJoinThread(&decoderThread);
+        PltCloseThread(&decoderThread);
+    }
+
+    AudioCallbacks.cleanup();
+
+    // There's no socket to close, so this just frees the queues
+    destroyAudioStream();
+}
+
 int LiGetPendingAudioFrames(void) {
     return LbqGetItemCount(&packetQueue);
 }
@@ -83,6 +83,10 @@ void LiStopConnection(void) {
         stage--;
         Limelog("done\n");
     }
+
+    // The receive threads are stopped now, so we can close the capture file
+    stopPacketCapture();
+
     if (stage == STAGE_CONTROL_STREAM_START) {
         Limelog("Stopping control stream...");
         stopControlStream();
@@ -424,7 +428,12 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
 
     Limelog("Initializing video stream...");
     ListenerCallbacks.stageStarting(STAGE_VIDEO_STREAM_INIT);
-    initializeVideoStream();
+    err = initializeVideoStream();
+    if (err != 0) {
+        Limelog("failed: %d\n", err);
+        ListenerCallbacks.stageFailed(STAGE_VIDEO_STREAM_INIT, err);
+        goto Cleanup;
+    }
     stage++;
     LC_ASSERT(stage == STAGE_VIDEO_STREAM_INIT);
     ListenerCallbacks.stageComplete(STAGE_VIDEO_STREAM_INIT);
@@ -451,6 +460,9 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     ListenerCallbacks.stageComplete(STAGE_CONTROL_STREAM_START);
     Limelog("done\n");
 
+    // Start capturing before the first packets arrive
+    startPacketCapture();
+
     Limelog("Starting video stream...");
     ListenerCallbacks.stageStarting(STAGE_VIDEO_STREAM_START);
     err = startVideoStream(renderContext, drFlags);
@@ -27,22 +27,30 @@ typedef struct _NVCTL_ENCRYPTED_PACKET_HEADER {
     // encrypted NVCTL_ENET_PACKET_HEADER_V2 and payload data follow
 } NVCTL_ENCRYPTED_PACKET_HEADER, *PNVCTL_ENCRYPTED_PACKET_HEADER;
 
-typedef struct _QUEUED_FRAME_INVALIDATION_TUPLE {
+typedef struct _FRAME_INVALIDATION_RANGE {
     int startFrame;
     int endFrame;
+} FRAME_INVALIDATION_RANGE, *PFRAME_INVALIDATION_RANGE;
+
+typedef struct _QUEUED_CONTROL_MESSAGE {
+    short type;
+    short payloadLength;
     LINKED_BLOCKING_QUEUE_ENTRY entry;
-} QUEUED_FRAME_INVALIDATION_TUPLE, *PQUEUED_FRAME_INVALIDATION_TUPLE;
 
+    // Payload data follows
+} QUEUED_CONTROL_MESSAGE, *PQUEUED_CONTROL_MESSAGE;
+
+// The ENet host and peer are owned by the control thread. Other threads
+// queue their messages and signal controlWakeup to have them sent.
 static SOCKET ctlSock = INVALID_SOCKET;
 static ENetHost* client;
 static ENetPeer* peer;
-static PLT_MUTEX enetMutex;
 static bool usePeriodicPing;
 
-static PLT_THREAD lossStatsThread;
-static PLT_THREAD invalidateRefFramesThread;
-static PLT_THREAD requestIdrFrameThread;
-static PLT_THREAD controlReceiveThread;
+static PLT_THREAD controlThread;
+static SOCKET_WAKEUP controlWakeup;
+static LINKED_BLOCKING_QUEUE outgoingMessages;
+static PLT_ATOMIC_INT idrFrameRequired;
 static int lossCountSinceLastReport;
 static int lastGoodFrame;
 static int lastSeenFrame;
@@ -57,9 +65,26 @@ static uint64_t intervalStartTimeMs;
 static int lastIntervalLossPercentage;
 static int lastConnectionStatusUpdate;
 static int currentEnetSequenceNumber;
-
-static LINKED_BLOCKING_QUEUE invalidReferenceFrameTuples;
-static PLT_EVENT idrFrameRequiredEvent;
+static uint64_t lastIdrRequestTimeMs;
+
+// Lost frame ranges waiting for the control thread. Ranges that overlap or
+// touch are merged as they are queued, so the ring never needs to grow.
+#define RFI_RANGE_RING_SIZE 16
+static PLT_MUTEX rfiRangeLock;
+static FRAME_INVALIDATION_RANGE rfiRanges[RFI_RANGE_RING_SIZE];
+static int rfiRangeHead;
+static int rfiRangeCount;
+
+// Statistics updated with atomic adds, so they may be read from any thread
+static PLT_ATOMIC_INT rfiSentCount;
+static PLT_ATOMIC_INT rfiMergedCount;
+static PLT_ATOMIC_INT rfiEscalatedCount;
+
+// Published by the control thread for other threads to read
+static PLT_ATOMIC_INT peerConnected;
+static PLT_ATOMIC_INT peerDataInTransit;
+static PLT_ATOMIC_INT peerRoundTripTime;
+static PLT_ATOMIC_INT peerRoundTripTimeVariance;
 
 static PPLT_CRYPTO_CONTEXT encryptionCtx;
 static PPLT_CRYPTO_CONTEXT decryptionCtx;
@@ -82,6 +107,18 @@ static PPLT_CRYPTO_CONTEXT decryptionCtx;
 #define CONTROL_STREAM_TIMEOUT_SEC 10
 #define CONTROL_STREAM_LINGER_TIMEOUT_SEC 2
 
+// H.264 and HEVC encoders keep at most 16 reference frames, so the host
+// can't recover from a longer span of lost frames without an IDR frame.
+#define RFI_MAX_INVALIDATION_FRAMES 16
+
+// An IDR frame takes at least a round trip to arrive. Oversized spans within
+// this long of the last IDR request are sent as RFI requests instead, and the
+// host falls back to an IDR frame itself if it can't honor them.
+#define IDR_ESCALATION_MIN_INTERVAL_MS 500
+
+// This only fills up if the control thread stops sending
+#define OUTGOING_MESSAGE_QUEUE_BOUND 1000
+
 static const short packetTypesGen3[] = {
     0x1407, // Request IDR frame
     0x1410, // Start B
@@ -221,10 +258,25 @@ static bool supportsIdrFrameRequest;
 
 // Initializes the control stream
 int initializeControlStream(void) {
+    int err;
+
+    // Requests for the host can arrive before the control stream is started
+    // (and even if it never is), so the wakeup must exist from now on.
+    err = createSocketWakeup(&controlWakeup);
+    if (err != 0) {
+        return err;
+    }
+
     stopping = false;
-    PltCreateEvent(&idrFrameRequiredEvent);
-    LbqInitializeLinkedBlockingQueue(&invalidReferenceFrameTuples, 20);
-    PltCreateMutex(&enetMutex);
+    PltAtomicStore(&idrFrameRequired, 0);
+    PltCreateMutex(&rfiRangeLock);
+    rfiRangeHead = 0;
+    rfiRangeCount = 0;
+    lastIdrRequestTimeMs = 0;
+    PltAtomicStore(&rfiSentCount, 0);
+    PltAtomicStore(&rfiMergedCount, 0);
+    PltAtomicStore(&rfiEscalatedCount, 0);
+    LbqInitializeLinkedBlockingQueue(&outgoingMessages, OUTGOING_MESSAGE_QUEUE_BOUND);
 
     encryptedControlStream = APP_VERSION_AT_LEAST(7, 1, 431);
 
@@ -275,11 +327,13 @@ int initializeControlStream(void) {
     encryptionCtx = PltCreateCryptoContext();
     decryptionCtx = PltCreateCryptoContext();
     hdrEnabled = false;
+    PltAtomicStore(&peerConnected, 0);
+    PltAtomicStore(&peerDataInTransit, 0);
 
     return 0;
 }
 
-void freeFrameInvalidationList(PLINKED_BLOCKING_QUEUE_ENTRY entry) {
+static void freeQueueEntryList(PLINKED_BLOCKING_QUEUE_ENTRY entry) {
     PLINKED_BLOCKING_QUEUE_ENTRY nextEntry;
 
     while (entry != NULL) {
@@ -294,44 +348,91 @@ void destroyControlStream(void) {
     LC_ASSERT(stopping);
     PltDestroyCryptoContext(encryptionCtx);
     PltDestroyCryptoContext(decryptionCtx);
-    PltCloseEvent(&idrFrameRequiredEvent);
-    freeFrameInvalidationList(LbqDestroyLinkedBlockingQueue(&invalidReferenceFrameTuples));
-    PltDeleteMutex(&enetMutex);
+    PltDeleteMutex(&rfiRangeLock);
+    freeQueueEntryList(LbqDestroyLinkedBlockingQueue(&outgoingMessages));
+    closeSocketWakeup(&controlWakeup);
+}
+
+// Cleans up a control stream that was initialized but never started. This happens
+// when replaying a packet capture, since there's no host to connect to.
+void destroyUnstartedControlStream(void) {
+    stopping = true;
+    destroyControlStream();
 }
 
 void queueFrameInvalidationTuple(int startFrame, int endFrame) {
+    PFRAME_INVALIDATION_RANGE range;
+
     LC_ASSERT(startFrame <= endFrame);
-    
-    if (isReferenceFrameInvalidationEnabled()) {
-        PQUEUED_FRAME_INVALIDATION_TUPLE qfit;
-        qfit = malloc(sizeof(*qfit));
-        if (qfit != NULL) {
-            qfit->startFrame = startFrame;
-            qfit->endFrame = endFrame;
-            if (LbqOfferQueueItem(&invalidReferenceFrameTuples, qfit, &qfit->entry) == LBQ_BOUND_EXCEEDED) {
-                // Too many invalidation tuples, so we need an IDR frame now
-                Limelog("RFI range list reached maximum size limit\n");
-                free(qfit);
-                requestIdrOnDemand();
+
+    if (!isReferenceFrameInvalidationEnabled()) {
+        requestIdrOnDemand();
+        return;
+    }
+
+    PltLockMutex(&rfiRangeLock);
+
+    if (rfiRangeCount != 0) {
+        range = &rfiRanges[(rfiRangeHead + rfiRangeCount - 1) % RFI_RANGE_RING_SIZE];
+
+        // Everything pending is sent as a single span, so when the ring is full
+        // we can extend the newest range over the gap instead of needing an IDR frame.
+        if ((startFrame <= range->endFrame + 1 && endFrame + 1 >= range->startFrame) ||
+                rfiRangeCount == RFI_RANGE_RING_SIZE) {
+            if (startFrame < range->startFrame) {
+                range->startFrame = startFrame;
             }
+            if (endFrame > range->endFrame) {
+                range->endFrame = endFrame;
+            }
+            PltAtomicAdd(&rfiMergedCount, 1);
+
+            // The wider range may now reach back into older ones
+            while (rfiRangeCount > 1) {
+                PFRAME_INVALIDATION_RANGE prevRange = &rfiRanges[(rfiRangeHead + rfiRangeCount - 2) % RFI_RANGE_RING_SIZE];
+
+                if (range->startFrame > prevRange->endFrame + 1) {
+                    break;
+                }
+
+                if (range->startFrame > prevRange->startFrame) {
+                    range->startFrame = prevRange->startFrame;
+                }
+                if (range->endFrame < prevRange->endFrame) {
+                    range->endFrame = prevRange->endFrame;
+                }
+                *prevRange = *range;
+                range = prevRange;
+                rfiRangeCount--;
+                PltAtomicAdd(&rfiMergedCount, 1);
+            }
+
+            PltUnlockMutex(&rfiRangeLock);
+            signalSocketWakeup(&controlWakeup);
+            return;
         }
-        else {
-            requestIdrOnDemand();
-        }
-    }
-    else {
-        requestIdrOnDemand();
     }
+
+    range = &rfiRanges[(rfiRangeHead + rfiRangeCount) % RFI_RANGE_RING_SIZE];
+    range->startFrame = startFrame;
+    range->endFrame = endFrame;
+    rfiRangeCount++;
+
+    PltUnlockMutex(&rfiRangeLock);
+    signalSocketWakeup(&controlWakeup);
 }
 
 // Request an IDR frame on demand by the decoder
 void requestIdrOnDemand(void) {
     // Any reference frame invalidation requests should be dropped now.
     // We require a full IDR frame to recover.
-    freeFrameInvalidationList(LbqFlushQueueItems(&invalidReferenceFrameTuples));
+    PltLockMutex(&rfiRangeLock);
+    rfiRangeCount = 0;
+    PltUnlockMutex(&rfiRangeLock);
 
     // Request the IDR frame
-    PltSetEvent(&idrFrameRequiredEvent);
+    PltAtomicStore(&idrFrameRequired, 1);
+    signalSocketWakeup(&controlWakeup);
 }
 
 // Invalidate reference frames lost by the network
@@ -487,6 +588,8 @@ static bool decryptControlMessageToV1(PNVCTL_ENCRYPTED_PACKET_HEADER encPacket,
     return true;
 }
 
+// This must only be called on the control thread (or before it starts). The
+// packet is only queued on the peer, so the caller must flush the host.
 static bool sendMessageEnet(short ptype, short paylen, const void* payload) {
     ENetPacket* enetPacket;
     int err;
@@ -505,10 +608,6 @@ static bool sendMessageEnet(short ptype, short paylen, const void* payload) {
             return false;
         }
 
-        // We (ab)use the enetMutex to protect currentEnetSequenceNumber and the cipherContext
-        // used inside encryptControlMessage().
-        PltLockMutex(&enetMutex);
-
         encPacket = (PNVCTL_ENCRYPTED_PACKET_HEADER)enetPacket->data;
         encPacket->encryptedHeaderType = 0x0001;
         encPacket->length = sizeof(encPacket->seq) + AES_GCM_TAG_LENGTH + sizeof(*packet) + paylen;
@@ -525,11 +624,8 @@ static bool sendMessageEnet(short ptype, short paylen, const void* payload) {
         if (!encryptControlMessage(encPacket, packet)) {
             Limelog("Failed to encrypt control stream message\n");
             enet_packet_destroy(enetPacket);
-            PltUnlockMutex(&enetMutex);
             return false;
         }
-
-        // enetMutex still locked here
     }
     else {
         PNVCTL_ENET_PACKET_HEADER_V1 packet;
@@ -541,18 +637,10 @@ static bool sendMessageEnet(short ptype, short paylen, const void* payload) {
         packet = (PNVCTL_ENET_PACKET_HEADER_V1)enetPacket->data;
         packet->type = LE16(ptype);
         memcpy(&packet[1], payload, paylen);
-
-        PltLockMutex(&enetMutex);
     }
 
     // Queue the packet to be sent
     err = enet_peer_send(peer, 0, enetPacket);
-
-    // Actually send it
-    enet_host_service(client, NULL, 0);
-
-    PltUnlockMutex(&enetMutex);
-
     if (err < 0) {
         Limelog("Failed to send ENet control packet\n");
         enet_packet_destroy(enetPacket);
@@ -590,8 +678,6 @@ static bool sendMessageTcp(short ptype, short paylen, const void* payload) {
 static bool sendMessageAndForget(short ptype, short paylen, const void* payload) {
     bool ret;
 
-    // Unlike regular sockets, ENet sockets aren't safe to invoke from multiple
-    // threads at once. We have to synchronize them with a lock.
     if (AppVersionQuad[0] >= 5) {
         ret = sendMessageEnet(ptype, paylen, payload);
     }
@@ -648,47 +734,275 @@ static int ignoreDisconnectIntercept(ENetHost* host, ENetEvent* event) {
     return 0;
 }
 
-static void controlReceiveThreadFunc(void* context) {
-    int err;
+static bool sendPeriodicControlMessage(void) {
+    BYTE_BUFFER byteBuffer;
 
-    // This is only used for ENet
-    if (AppVersionQuad[0] < 5) {
-        return;
+    if (usePeriodicPing) {
+        char periodicPingPayload[8];
+
+        BbInitializeWrappedBuffer(&byteBuffer, periodicPingPayload, 0, sizeof(periodicPingPayload), BYTE_ORDER_LITTLE);
+        BbPut16(&byteBuffer, 4); // Length of payload
+        BbPut32(&byteBuffer, 0); // Timestamp?
+
+        // Send the message (and don't expect a response)
+        if (!sendMessageAndForget(0x0200, sizeof(periodicPingPayload), periodicPingPayload)) {
+            Limelog("Loss Stats: Transaction failed: %d\n", (int)LastSocketError());
+            ListenerCallbacks.connectionTerminated(LastSocketFail());
+            return false;
+        }
     }
+    else {
+        char lossStatsPayload[32];
+
+        LC_ASSERT(payloadLengths[IDX_LOSS_STATS] == sizeof(lossStatsPayload));
+
+        // Construct the payload
+        BbInitializeWrappedBuffer(&byteBuffer, lossStatsPayload, 0, sizeof(lossStatsPayload), BYTE_ORDER_LITTLE);
+        BbPut32(&byteBuffer, lossCountSinceLastReport);
+        BbPut32(&byteBuffer, LOSS_REPORT_INTERVAL_MS);
+        BbPut32(&byteBuffer, 1000);
+        BbPut64(&byteBuffer, lastGoodFrame);
+        BbPut32(&byteBuffer, 0);
+        BbPut32(&byteBuffer, 0);
+        BbPut32(&byteBuffer, 0x14);
+
+        // Send the message (and don't expect a response)
+        if (!sendMessageAndForget(packetTypes[IDX_LOSS_STATS], sizeof(lossStatsPayload), lossStatsPayload)) {
+            Limelog("Loss Stats: Transaction failed: %d\n", (int)LastSocketError());
+            ListenerCallbacks.connectionTerminated(LastSocketFail());
+            return false;
+        }
 
-    while (!PltIsThreadInterrupted(&controlReceiveThread)) {
-        ENetEvent event;
-        enet_uint32 waitTimeMs;
+        // Clear the transient state
+        lossCountSinceLastReport = 0;
+    }
 
-        PltLockMutex(&enetMutex);
+    return true;
+}
 
-        // Poll for new packets and process retransmissions
-        err = serviceEnetHost(client, &event, 0);
+static bool requestIdrFrame(void) {
+    // If this server does not have a known IDR frame request
+    // message, we'll accomplish the same thing by creating a
+    // reference frame invalidation request.
+    if (!supportsIdrFrameRequest) {
+        int64_t payload[3];
 
-        // Compute the next time we need to wake up to handle
-        // the RTO timer or a ping.
-        if (err == 0) {
-            if (ENET_TIME_LESS(peer->nextTimeout, client->serviceTime)) {
-                // This can happen when we have no unacked reliable messages
-                waitTimeMs = 10;
-            }
-            else {
-                // We add 1 ms just to ensure we're unlikely to undershoot the sleep() and have to
-                // do a tiny sleep for another iteration before the timeout is ready to be serviced.
-                waitTimeMs = ENET_TIME_DIFFERENCE(peer->nextTimeout, client->serviceTime) + 1;
-                if (waitTimeMs > peer->pingInterval) {
-                    waitTimeMs = peer->pingInterval;
-                }
+        // Form the payload
+        if (lastSeenFrame < 0x20) {
+            payload[0] = 0;
+            payload[1] = LE64(lastSeenFrame);
+        }
+        else {
+            payload[0] = LE64(lastSeenFrame - 0x20);
+            payload[1] = LE64(lastSeenFrame);
+        }
+
+        payload[2] = 0;
+
+        // Send the reference frame invalidation request and read the response
+        if (!sendMessageAndDiscardReply(packetTypes[IDX_INVALIDATE_REF_FRAMES],
+            payloadLengths[IDX_INVALIDATE_REF_FRAMES], payload)) {
+            Limelog("Request IDR Frame: Transaction failed: %d\n", (int)LastSocketError());
+            ListenerCallbacks.connectionTerminated(LastSocketFail());
+            return false;
+        }
+    }
+    else {
+        // Send IDR frame request and read the response
+        if (!sendMessageAndDiscardReply(packetTypes[IDX_REQUEST_IDR_FRAME],
+            payloadLengths[IDX_REQUEST_IDR_FRAME], preconstructedPayloads[IDX_REQUEST_IDR_FRAME])) {
+            Limelog("Request IDR Frame: Transaction failed: %d\n", (int)LastSocketError());
+            ListenerCallbacks.connectionTerminated(LastSocketFail());
+            return false;
+        }
+    }
+
+    Limelog("IDR frame request sent\n");
+    return true;
+}
+
+static bool requestInvalidateReferenceFrames(int startFrame, int endFrame) {
+    int64_t payload[3];
+
+    LC_ASSERT(startFrame <= endFrame);
+    LC_ASSERT(isReferenceFrameInvalidationEnabled());
+
+    payload[0] = LE64(startFrame);
+    payload[1] = LE64(endFrame);
+    payload[2] = 0;
+
+    // Send the reference frame invalidation request and read the response
+    if (!sendMessageAndDiscardReply(packetTypes[IDX_INVALIDATE_REF_FRAMES],
+        payloadLengths[IDX_INVALIDATE_REF_FRAMES], payload)) {
+        Limelog("Request Invaldiate Reference Frames: Transaction failed: %d\n", (int)LastSocketError());
+        ListenerCallbacks.connectionTerminated(LastSocketFail());
+        return false;
+    }
+
+    Limelog("Invalidate reference frame request sent (%d to %d)\n", startFrame, endFrame);
+    return true;
+}
+
+static bool sendPendingFrameRequests(void) {
+    int startFrame;
+    int endFrame;
+    uint64_t now;
+    int i;
+
+    if (PltAtomicExchange(&idrFrameRequired, 0)) {
+        // Any pending reference frame invalidation requests are now redundant
+        PltLockMutex(&rfiRangeLock);
+        rfiRangeCount = 0;
+        PltUnlockMutex(&rfiRangeLock);
+
+        // Request the IDR frame
+        lastIdrRequestTimeMs = PltGetMillis();
+        return requestIdrFrame();
+    }
+
+    PltLockMutex(&rfiRangeLock);
+
+    if (rfiRangeCount == 0) {
+        PltUnlockMutex(&rfiRangeLock);
+        return true;
+    }
+
+    LC_ASSERT(isReferenceFrameInvalidationEnabled());
+
+    // Aggregate all lost frames into one range. The frames between disjoint
+    // ranges were decoded from missing references, so they're lost too.
+    startFrame = rfiRanges[rfiRangeHead].startFrame;
+    endFrame = rfiRanges[rfiRangeHead].endFrame;
+    for (i = 1; i < rfiRangeCount; i++) {
+        PFRAME_INVALIDATION_RANGE range = &rfiRanges[(rfiRangeHead + i) % RFI_RANGE_RING_SIZE];
+
+        if (range->startFrame < startFrame) {
+            startFrame = range->startFrame;
+        }
+        if (range->endFrame > endFrame) {
+            endFrame = range->endFrame;
+        }
+    }
+    PltAtomicAdd(&rfiMergedCount, rfiRangeCount - 1);
+    rfiRangeHead = (rfiRangeHead + rfiRangeCount) % RFI_RANGE_RING_SIZE;
+    rfiRangeCount = 0;
+
+    now = PltGetMillis();
+    if (endFrame - startFrame + 1 > RFI_MAX_INVALIDATION_FRAMES &&
+            now - lastIdrRequestTimeMs >= IDR_ESCALATION_MIN_INTERVAL_MS) {
+        PltAtomicAdd(&rfiEscalatedCount, 1);
+        PltUnlockMutex(&rfiRangeLock);
+
+        Limelog("Lost frames %d to %d exceed what the host can invalidate\n", startFrame, endFrame);
+        lastIdrRequestTimeMs = now;
+        return requestIdrFrame();
+    }
+
+    PltAtomicAdd(&rfiSentCount, 1);
+    PltUnlockMutex(&rfiRangeLock);
+
+    // Send the reference frame invalidation request
+    return requestInvalidateReferenceFrames(startFrame, endFrame);
+}
+
+static bool sendQueuedControlMessages(void) {
+    PQUEUED_CONTROL_MESSAGE message;
+
+    while (LbqPollQueueElement(&outgoingMessages, (void**)&message) == LBQ_SUCCESS) {
+        bool ret = sendMessageAndForget(message->type, message->payloadLength, message + 1);
+        free(message);
+        if (!ret) {
+            Limelog("Control stream: Failed to send queued message: %d\n", (int)LastSocketError());
+            ListenerCallbacks.connectionTerminated(LastSocketFail());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void publishPeerState(void) {
+    if (peer->state == ENET_PEER_STATE_CONNECTED) {
+        PltAtomicStore(&peerDataInTransit, peer->reliableDataInTransit != 0);
+        PltAtomicStore(&peerRoundTripTime, (int)peer->roundTripTime);
+        PltAtomicStore(&peerRoundTripTimeVariance, (int)peer->roundTripTimeVariance);
+        PltAtomicStore(&peerConnected, 1);
+    }
+    else {
+        PltAtomicStore(&peerConnected, 0);
+        PltAtomicStore(&peerDataInTransit, 0);
+    }
+}
+
+// Blocks until the ENet socket is readable, another thread has queued work
+// for the control thread, or the timeout expires
+static void waitForControlStreamWork(int timeoutMs) {
+    struct pollfd pfds[2];
+    int pfdCount = 0;
+
+    if (client != NULL) {
+        pfds[pfdCount].fd = client->socket;
+        pfds[pfdCount].events = POLLIN;
+        pfdCount++;
+    }
+
+    pfds[pfdCount].fd = controlWakeup.fd;
+    pfds[pfdCount].events = POLLIN;
+    pfdCount++;
+
+    if (pollSockets(pfds, pfdCount, timeoutMs) > 0) {
+        // The queues are checked again after this, so a signal that races
+        // with the drain can't be lost.
+        drainSocketWakeup(&controlWakeup);
+    }
+}
+
+// The control thread sends everything bound for the host and, for ENet,
+// handles everything we receive from it. It sleeps in a single poll() on
+// the ENet socket and controlWakeup, so queued messages and received
+// packets are handled as soon as they are ready.
+static void controlThreadFunc(void* context) {
+    uint64_t nextPeriodicMessageTimeMs = PltGetMillis();
+    int err;
+
+    while (!PltIsThreadInterrupted(&controlThread)) {
+        ENetEvent event;
+        uint64_t now;
+        int waitTimeMs;
+
+        // Send everything that was queued by other threads
+        if (!sendQueuedControlMessages() || !sendPendingFrameRequests()) {
+            return;
+        }
+
+        now = PltGetMillis();
+        if (now >= nextPeriodicMessageTimeMs) {
+            if (!sendPeriodicControlMessage()) {
+                return;
             }
+
+            nextPeriodicMessageTimeMs = now + (usePeriodicPing ? PERIODIC_PING_INTERVAL_MS : LOSS_REPORT_INTERVAL_MS);
+        }
+
+        waitTimeMs = (int)(nextPeriodicMessageTimeMs - now);
+
+        // TCP hosts never send us anything unsolicited
+        if (AppVersionQuad[0] < 5) {
+            waitForControlStreamWork(waitTimeMs);
+            continue;
         }
 
-        PltUnlockMutex(&enetMutex);
+        // Transmit anything we just queued on the peer
+        enet_host_flush(client);
+
+        // Poll for new packets and process retransmissions
+        err = serviceEnetHost(client, &event, 0);
+        publishPeerState();
 
         if (err == 0) {
             // Handle a pending disconnect after unsuccessfully polling
             // for new events to handle.
             if (disconnectPending) {
-                PltLockMutex(&enetMutex);
                 // Wait 100 ms for pending receives after a disconnect and
                 // 1 second for the pending disconnect to be processed after
                 // removing the intercept callback.
@@ -701,27 +1015,32 @@ static void controlReceiveThreadFunc(void* context) {
                         // 1 second for this disconnect to be processed before
                         // we tear down the connection anyway.
                         client->intercept = NULL;
-                        PltUnlockMutex(&enetMutex);
                         continue;
                     }
                     else {
                         // The 1 second timeout has expired with no disconnect event
                         // retransmission after the first notification. We can only
                         // assume the server died tragically, so go ahead and tear down.
-                        PltUnlockMutex(&enetMutex);
                         Limelog("Disconnect event timeout expired\n");
                         ListenerCallbacks.connectionTerminated(-1);
                         return;
                     }
                 }
-                else {
-                    PltUnlockMutex(&enetMutex);
-                }
             }
             else {
-                // No events ready - wait for readability or a local RTO timer to expire
-                enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
-                enet_socket_wait(client->socket, &condition, waitTimeMs);
+                // Wake up in time to handle the RTO timer or a ping. We add 1 ms just to
+                // ensure we're unlikely to undershoot and have to do a tiny wait for
+                // another iteration before the timeout is ready to be serviced.
+                if (!ENET_TIME_LESS(peer->nextTimeout, client->serviceTime) &&
+                        ENET_TIME_DIFFERENCE(peer->nextTimeout, client->serviceTime) + 1 < (enet_uint32)waitTimeMs) {
+                    waitTimeMs = ENET_TIME_DIFFERENCE(peer->nextTimeout, client->serviceTime) + 1;
+                }
+                if (peer->pingInterval < (enet_uint32)waitTimeMs) {
+                    waitTimeMs = peer->pingInterval;
+                }
+
+                // No events ready - wait for readability, queued work, or a timer to expire
+                waitForControlStreamWork(waitTimeMs);
                 continue;
             }
         }
@@ -885,9 +1204,7 @@ static void controlReceiveThreadFunc(void* context) {
                 // message once it sends this message, so we mark the peer as fully
                 // disconnected now to avoid delays waiting for an ack that will
                 // never arrive.
-                PltLockMutex(&enetMutex);
                 enet_peer_disconnect_now(peer, 0);
-                PltUnlockMutex(&enetMutex);
                 ListenerCallbacks.connectionTerminated((int)terminationErrorCode);
                 free(ctlHdr);
                 return;
@@ -903,182 +1220,25 @@ static void controlReceiveThreadFunc(void* context) {
     }
 }
 
-static void lossStatsThreadFunc(void* context) {
-    BYTE_BUFFER byteBuffer;
-
-    if (usePeriodicPing) {
-        char periodicPingPayload[8];
-
-        BbInitializeWrappedBuffer(&byteBuffer, periodicPingPayload, 0, sizeof(periodicPingPayload), BYTE_ORDER_LITTLE);
-        BbPut16(&byteBuffer, 4); // Length of payload
-        BbPut32(&byteBuffer, 0); // Timestamp?
-
-        while (!PltIsThreadInterrupted(&lossStatsThread)) {
-            // Send the message (and don't expect a response)
-            if (!sendMessageAndForget(0x0200, sizeof(periodicPingPayload), periodicPingPayload)) {
-                Limelog("Loss Stats: Transaction failed: %d\n", (int)LastSocketError());
-                ListenerCallbacks.connectionTerminated(LastSocketFail());
-                return;
-            }
-
-            // Wait a bit
-            PltSleepMsInterruptible(&lossStatsThread, PERIODIC_PING_INTERVAL_MS);
-        }
-    }
-    else {
-        char* lossStatsPayload;
-
-        lossStatsPayload = malloc(payloadLengths[IDX_LOSS_STATS]);
-        if (lossStatsPayload == NULL) {
-            Limelog("Loss Stats: malloc() failed\n");
-            ListenerCallbacks.connectionTerminated(-1);
-            return;
-        }
-
-        while (!PltIsThreadInterrupted(&lossStatsThread)) {
-            // Construct the payload
-            BbInitializeWrappedBuffer(&byteBuffer, lossStatsPayload, 0, payloadLengths[IDX_LOSS_STATS], BYTE_ORDER_LITTLE);
-            BbPut32(&byteBuffer, lossCountSinceLastReport);
-            BbPut32(&byteBuffer, LOSS_REPORT_INTERVAL_MS);
-            BbPut32(&byteBuffer, 1000);
-            BbPut64(&byteBuffer, lastGoodFrame);
-            BbPut32(&byteBuffer, 0);
-            BbPut32(&byteBuffer, 0);
-            BbPut32(&byteBuffer, 0x14);
-
-            // Send the message (and don't expect a response)
-            if (!sendMessageAndForget(packetTypes[IDX_LOSS_STATS],
-                payloadLengths[IDX_LOSS_STATS], lossStatsPayload)) {
-                free(lossStatsPayload);
-                Limelog("Loss Stats: Transaction failed: %d\n", (int)LastSocketError());
-                ListenerCallbacks.connectionTerminated(LastSocketFail());
-                return;
-            }
-
-            // Clear the transient state
-            lossCountSinceLastReport = 0;
-
-            // Wait a bit
-            PltSleepMsInterruptible(&lossStatsThread, LOSS_REPORT_INTERVAL_MS);
-        }
-
-        free(lossStatsPayload);
-    }
-}
-
-static void requestIdrFrame(void) {
-    // If this server does not have a known IDR frame request
-    // message, we'll accomplish the same thing by creating a
-    // reference frame invalidation request.
-    if (!supportsIdrFrameRequest) {
-        int64_t payload[3];
-
-        // Form the payload
-        if (lastSeenFrame < 0x20) {
-            payload[0] = 0;
-            payload[1] = LE64(lastSeenFrame);
-        }
-        else {
-            payload[0] = LE64(lastSeenFrame - 0x20);
-            payload[1] = LE64(lastSeenFrame);
-        }
-
-        payload[2] = 0;
+// Tears down the connection to the host when startControlStream() fails
+static void closeControlStreamConnection(void) {
+    stopping = true;
 
-        // Send the reference frame invalidation request and read the response
-        if (!sendMessageAndDiscardReply(packetTypes[IDX_INVALIDATE_REF_FRAMES],
-            payloadLengths[IDX_INVALIDATE_REF_FRAMES], payload)) {
-            Limelog("Request IDR Frame: Transaction failed: %d\n", (int)LastSocketError());
-            ListenerCallbacks.connectionTerminated(LastSocketFail());
-            return;
-        }
+    if (ctlSock != INVALID_SOCKET) {
+        closeSocket(ctlSock);
+        ctlSock = INVALID_SOCKET;
     }
     else {
-        // Send IDR frame request and read the response
-        if (!sendMessageAndDiscardReply(packetTypes[IDX_REQUEST_IDR_FRAME],
-            payloadLengths[IDX_REQUEST_IDR_FRAME], preconstructedPayloads[IDX_REQUEST_IDR_FRAME])) {
-            Limelog("Request IDR Frame: Transaction failed: %d\n", (int)LastSocketError());
-            ListenerCallbacks.connectionTerminated(LastSocketFail());
-            return;
-        }
-    }
-
-    Limelog("IDR frame request sent\n");
-}
-
-static void requestInvalidateReferenceFrames(int startFrame, int endFrame) {
-    int64_t payload[3];
-
-    LC_ASSERT(startFrame <= endFrame);
-    LC_ASSERT(isReferenceFrameInvalidationEnabled());
-
-    payload[0] = LE64(startFrame);
-    payload[1] = LE64(endFrame);
-    payload[2] = 0;
-
-    // Send the reference frame invalidation request and read the response
-    if (!sendMessageAndDiscardReply(packetTypes[IDX_INVALIDATE_REF_FRAMES],
-        payloadLengths[IDX_INVALIDATE_REF_FRAMES], payload)) {
-        Limelog("Request Invaldiate Reference Frames: Transaction failed: %d\n", (int)LastSocketError());
-        ListenerCallbacks.connectionTerminated(LastSocketFail());
-        return;
-    }
-
-    Limelog("Invalidate reference frame request sent (%d to %d)\n", startFrame, endFrame);
-}
-
-static void invalidateRefFramesFunc(void* context) {
-    LC_ASSERT(isReferenceFrameInvalidationEnabled());
-
-    while (!PltIsThreadInterrupted(&invalidateRefFramesThread)) {
-        PQUEUED_FRAME_INVALIDATION_TUPLE qfit;
-        int startFrame;
-        int endFrame;
-
-        // Wait for a reference frame invalidation request or a request to shutdown
-        if (LbqWaitForQueueElement(&invalidReferenceFrameTuples, (void**)&qfit) != LBQ_SUCCESS) {
-            // Bail if we're stopping
-            return;
-        }
-
-        startFrame = qfit->startFrame;
-        endFrame = qfit->endFrame;
-
-        // Aggregate all lost frames into one range
-        do {
-            LC_ASSERT(qfit->endFrame >= endFrame);
-            endFrame = qfit->endFrame;
-            free(qfit);
-        } while (LbqPollQueueElement(&invalidReferenceFrameTuples, (void**)&qfit) == LBQ_SUCCESS);
-
-        // Send the reference frame invalidation request
-        requestInvalidateReferenceFrames(startFrame, endFrame);
-    }
-}
-
-static void requestIdrFrameFunc(void* context) {
-    while (!PltIsThreadInterrupted(&requestIdrFrameThread)) {
-        PltWaitForEvent(&idrFrameRequiredEvent);
-        PltClearEvent(&idrFrameRequiredEvent);
-
-        if (stopping) {
-            // Bail if we're stopping
-            return;
-        }
-
-        // Any pending reference frame invalidation requests are now redundant
-        freeFrameInvalidationList(LbqFlushQueueItems(&invalidReferenceFrameTuples));
-
-        // Request the IDR frame
-        requestIdrFrame();
+        enet_peer_disconnect_now(peer, 0);
+        peer = NULL;
+        enet_host_destroy(client);
+        client = NULL;
     }
 }
 
 // Stops the control stream
 int stopControlStream(void) {
     stopping = true;
-    LbqSignalQueueShutdown(&invalidReferenceFrameTuples);
-    PltSetEvent(&idrFrameRequiredEvent);
 
     // This must be set to stop in a timely manner
     LC_ASSERT(ConnectionInterrupted);
@@ -1086,29 +1246,26 @@ int stopControlStream(void) {
     if (ctlSock != INVALID_SOCKET) {
         shutdownTcpSocket(ctlSock);
     }
-    
-    PltInterruptThread(&lossStatsThread);
-    PltInterruptThread(&requestIdrFrameThread);
-    PltInterruptThread(&controlReceiveThread);
 
-    PltJoinThread(&lossStatsThread);
-    PltJoinThread(&requestIdrFrameThread);
-    PltJoinThread(&controlReceiveThread);
+    PltInterruptThread(&controlThread);
+    signalSocketWakeup(&controlWakeup);
+    PltJoinThread(&controlThread);
+    PltCloseThread(&controlThread);
 
-    PltCloseThread(&lossStatsThread);
-    PltCloseThread(&requestIdrFrameThread);
-    PltCloseThread(&controlReceiveThread);
+    PltAtomicStore(&peerConnected, 0);
+    PltAtomicStore(&peerDataInTransit, 0);
 
-    // We will only have an RFI thread if RFI is enabled
     if (isReferenceFrameInvalidationEnabled()) {
-        PltInterruptThread(&invalidateRefFramesThread);
-        PltJoinThread(&invalidateRefFramesThread);
-        PltCloseThread(&invalidateRefFramesThread);
+        Limelog("Reference frame invalidation: %d sent, %d merged, %d escalated to IDR\n",
+                PltAtomicLoad(&rfiSentCount),
+                PltAtomicLoad(&rfiMergedCount),
+                PltAtomicLoad(&rfiEscalatedCount));
     }
 
     if (peer != NULL) {
         // Gracefully disconnect to ensure the remote host receives all of our final
         // outbound traffic, including any key up events that might be sent.
+        sendQueuedControlMessages();
         gracefullyDisconnectEnetPeer(client, peer, CONTROL_STREAM_LINGER_TIMEOUT_SEC * 1000);
         peer = NULL;
     }
@@ -1127,48 +1284,53 @@ int stopControlStream(void) {
 
 // Called by the input stream to send a packet for Gen 5+ servers
 int sendInputPacketOnControlStream(unsigned char* data, int length) {
+    PQUEUED_CONTROL_MESSAGE message;
+
     LC_ASSERT(AppVersionQuad[0] >= 5);
 
-    // Send the input data (no reply expected)
-    if (sendMessageAndForget(packetTypes[IDX_INPUT_DATA], length, data) == 0) {
+    message = malloc(sizeof(*message) + length);
+    if (message == NULL) {
         return -1;
     }
 
+    message->type = packetTypes[IDX_INPUT_DATA];
+    message->payloadLength = (short)length;
+    memcpy(message + 1, data, length);
+
+    // Queue the input data for the control thread (no reply expected)
+    if (LbqOfferQueueItem(&outgoingMessages, message, &message->entry) != LBQ_SUCCESS) {
+        free(message);
+        return -1;
+    }
+
+    signalSocketWakeup(&controlWakeup);
     return 0;
 }
 
 bool isControlDataInTransit(void) {
-    bool ret = false;
-
-    PltLockMutex(&enetMutex);
-    if (peer != NULL && peer->state == ENET_PEER_STATE_CONNECTED) {
-        if (peer->reliableDataInTransit != 0) {
-            ret = true;
-        }
-    }
-    PltUnlockMutex(&enetMutex);
+    return LbqGetItemCount(&outgoingMessages) != 0 || PltAtomicLoad(&peerDataInTransit) != 0;
+}
 
-    return ret;
+void LiGetFrameInvalidationStats(PFRAME_INVALIDATION_STATS stats) {
+    stats->rfiSent = (uint32_t)PltAtomicLoad(&rfiSentCount);
+    stats->rangesMerged = (uint32_t)PltAtomicLoad(&rfiMergedCount);
+    stats->idrEscalations = (uint32_t)PltAtomicLoad(&rfiEscalatedCount);
 }
 
 bool LiGetEstimatedRttInfo(uint32_t* estimatedRtt, uint32_t* estimatedRttVariance) {
-    bool ret = false;
-
-    PltLockMutex(&enetMutex);
-    if (peer != NULL && peer->state == ENET_PEER_STATE_CONNECTED) {
-        if (estimatedRtt != NULL) {
-            *estimatedRtt = peer->roundTripTime;
-        }
+    if (!PltAtomicLoad(&peerConnected)) {
+        return false;
+    }
 
-        if (estimatedRttVariance != NULL) {
-            *estimatedRttVariance = peer->roundTripTimeVariance;
-        }
+    if (estimatedRtt != NULL) {
+        *estimatedRtt = (uint32_t)PltAtomicLoad(&peerRoundTripTime);
+    }
 
-        ret = true;
+    if (estimatedRttVariance != NULL) {
+        *estimatedRttVariance = (uint32_t)PltAtomicLoad(&peerRoundTripTimeVariance);
     }
-    PltUnlockMutex(&enetMutex);
 
-    return ret;
+    return true;
 }
 
 // Starts the control stream
@@ -1233,21 +1395,7 @@ int startControlStream(void) {
         enableNoDelay(ctlSock);
     }
 
-    err = PltCreateThread("ControlRecv", controlReceiveThreadFunc, NULL, &controlReceiveThread);
-    if (err != 0) {
-        stopping = true;
-        if (ctlSock != INVALID_SOCKET) {
-            closeSocket(ctlSock);
-            ctlSock = INVALID_SOCKET;
-        }
-        else {
-            enet_peer_disconnect_now(peer, 0);
-            peer = NULL;
-            enet_host_destroy(client);
-            client = NULL;
-        }
-        return err;
-    }
+    // The control thread isn't running yet, so we can send these directly
 
     // Send START A
     if (!sendMessageAndDiscardReply(packetTypes[IDX_START_A],
@@ -1255,29 +1403,7 @@ int startControlStream(void) {
         preconstructedPayloads[IDX_START_A])) {
         Limelog("Start A failed: %d\n", (int)LastSocketError());
         err = LastSocketFail();
-        stopping = true;
-
-        if (ctlSock != INVALID_SOCKET) {
-            shutdownTcpSocket(ctlSock);
-        }
-        else {
-            ConnectionInterrupted = true;
-        }
-
-        PltInterruptThread(&controlReceiveThread);
-        PltJoinThread(&controlReceiveThread);
-        PltCloseThread(&controlReceiveThread);
-
-        if (ctlSock != INVALID_SOCKET) {
-            closeSocket(ctlSock);
-            ctlSock = INVALID_SOCKET;
-        }
-        else {
-            enet_peer_disconnect_now(peer, 0);
-            peer = NULL;
-            enet_host_destroy(client);
-            client = NULL;
-        }
+        closeControlStreamConnection();
         return err;
     }
 
@@ -1287,134 +1413,21 @@ int startControlStream(void) {
         preconstructedPayloads[IDX_START_B])) {
         Limelog("Start B failed: %d\n", (int)LastSocketError());
         err = LastSocketFail();
-        stopping = true;
-
-        if (ctlSock != INVALID_SOCKET) {
-            shutdownTcpSocket(ctlSock);
-        }
-        else {
-            ConnectionInterrupted = true;
-        }
-
-        PltInterruptThread(&controlReceiveThread);
-        PltJoinThread(&controlReceiveThread);
-        PltCloseThread(&controlReceiveThread);
-
-        if (ctlSock != INVALID_SOCKET) {
-            closeSocket(ctlSock);
-            ctlSock = INVALID_SOCKET;
-        }
-        else {
-            enet_peer_disconnect_now(peer, 0);
-            peer = NULL;
-            enet_host_destroy(client);
-            client = NULL;
-        }
+        closeControlStreamConnection();
         return err;
     }
 
-    err = PltCreateThread("LossStats", lossStatsThreadFunc, NULL, &lossStatsThread);
-    if (err != 0) {
-        stopping = true;
-
-        if (ctlSock != INVALID_SOCKET) {
-            shutdownTcpSocket(ctlSock);
-        }
-        else {
-            ConnectionInterrupted = true;
-        }
-
-        PltInterruptThread(&controlReceiveThread);
-        PltJoinThread(&controlReceiveThread);
-        PltCloseThread(&controlReceiveThread);
-
-        if (ctlSock != INVALID_SOCKET) {
-            closeSocket(ctlSock);
-            ctlSock = INVALID_SOCKET;
-        }
-        else {
-            enet_peer_disconnect_now(peer, 0);
-            peer = NULL;
-            enet_host_destroy(client);
-            client = NULL;
-        }
-        return err;
+    if (client != NULL) {
+        enet_host_flush(client);
+        publishPeerState();
     }
 
-    err = PltCreateThread("ReqIdrFrame", requestIdrFrameFunc, NULL, &requestIdrFrameThread);
+    err = PltCreateThread("ControlStream", controlThreadFunc, NULL, &controlThread);
     if (err != 0) {
-        stopping = true;
-
-        if (ctlSock != INVALID_SOCKET) {
-            shutdownTcpSocket(ctlSock);
-        }
-        else {
-            ConnectionInterrupted = true;
-        }
-
-        PltInterruptThread(&lossStatsThread);
-        PltJoinThread(&lossStatsThread);
-        PltCloseThread(&lossStatsThread);
-
-        PltInterruptThread(&controlReceiveThread);
-        PltJoinThread(&controlReceiveThread);
-        PltCloseThread(&controlReceiveThread);
-
-        if (ctlSock != INVALID_SOCKET) {
-            closeSocket(ctlSock);
-            ctlSock = INVALID_SOCKET;
-        }
-        else {
-            enet_peer_disconnect_now(peer, 0);
-            peer = NULL;
-            enet_host_destroy(client);
-            client = NULL;
-        }
-
+        closeControlStreamConnection();
         return err;
     }
 
-    // Only create the reference frame invalidation thread if RFI is enabled
-    if (isReferenceFrameInvalidationEnabled()) {
-        err = PltCreateThread("InvRefFrames", invalidateRefFramesFunc, NULL, &invalidateRefFramesThread);
-        if (err != 0) {
-            stopping = true;
-            PltSetEvent(&idrFrameRequiredEvent);
-
-            if (ctlSock != INVALID_SOCKET) {
-                shutdownTcpSocket(ctlSock);
-            }
-            else {
-                ConnectionInterrupted = true;
-            }
-
-            PltInterruptThread(&lossStatsThread);
-            PltJoinThread(&lossStatsThread);
-            PltCloseThread(&lossStatsThread);
-
-            PltInterruptThread(&controlReceiveThread);
-            PltJoinThread(&controlReceiveThread);
-            PltCloseThread(&controlReceiveThread);
-
-            PltInterruptThread(&requestIdrFrameThread);
-            PltJoinThread(&requestIdrFrameThread);
-            PltCloseThread(&requestIdrFrameThread);
-
-            if (ctlSock != INVALID_SOCKET) {
-                closeSocket(ctlSock);
-                ctlSock = INVALID_SOCKET;
-            }
-            else {
-                enet_peer_disconnect_now(peer, 0);
-                peer = NULL;
-                enet_host_destroy(client);
-                client = NULL;
-            }
-
-            return err;
-        }
-    }
-
     return 0;
 }
 
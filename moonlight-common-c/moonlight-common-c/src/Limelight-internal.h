@@ -10,6 +10,10 @@
 #include "RtpAudioQueue.h"
 #include "RtpVideoQueue.h"
 #include "ByteBuffer.h"
+#include "PacketPool.h"
+#include "RingQueue.h"
+#include "NetworkImpairment.h"
+#include "StartCodeScanner.h"
 
 #include <enet/enet.h>
 
@@ -83,6 +87,7 @@ int initializeControlStream(void);
 int startControlStream(void);
 int stopControlStream(void);
 void destroyControlStream(void);
+void destroyUnstartedControlStream(void);
 void requestIdrOnDemand(void);
 void connectionDetectedFrameLoss(int startFrame, int endFrame);
 void connectionReceivedCompleteFrame(int frameIndex);
@@ -95,21 +100,37 @@ int performRtspHandshake(void);
 
 void initializeVideoDepacketizer(int pktSize);
 void destroyVideoDepacketizer(void);
-void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntry);
+void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntry, uint64_t frameCompleteTimeUs);
 void stopVideoDepacketizer(void);
+int getPendingVideoFramesPeak(void);
 void requestDecoderRefresh(void);
 
-void initializeVideoStream(void);
+int initializeVideoStream(void);
 void destroyVideoStream(void);
 void notifyKeyFrameReceived(void);
+void* allocateVideoPacketBuffer(void);
+void freeVideoPacketBuffer(void* buffer);
 int startVideoStream(void* rendererContext, int drFlags);
 void stopVideoStream(void);
+int startVideoReplay(void* rendererContext, int drFlags);
+void stopVideoReplay(void);
+bool replayVideoPacket(const char* data, int length);
 
 int initializeAudioStream(void);
 int notifyAudioPortNegotiationComplete(void);
 void destroyAudioStream(void);
 int startAudioStream(void* audioContext, int arFlags);
 void stopAudioStream(void);
+int startAudioReplay(void* audioContext, int arFlags);
+void stopAudioReplay(void);
+bool replayAudioPacket(const char* data, int length);
+
+#define CAPTURE_STREAM_VIDEO 0
+#define CAPTURE_STREAM_AUDIO 1
+
+void startPacketCapture(void);
+void capturePacket(int stream, const char* data, int length);
+void stopPacketCapture(void);
 
 int initializeInputStream(void);
 void destroyInputStream(void);
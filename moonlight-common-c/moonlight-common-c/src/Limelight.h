@@ -155,6 +155,10 @@ typedef struct _DECODE_UNIT {
     // but the same epoch as enqueueTimeMs and LiGetMillis().
     uint64_t receiveTimeMs;
 
+    // Time the last packet of the frame was received or recovered by FEC. This
+    // uses the same epoch as receiveTimeMs.
+    uint64_t frameCompleteTimeMs;
+
     // Time the frame was fully assembled and queued for the video decoder to process.
     // This is also approximately the same time as the final packet was received, so
     // enqueueTimeMs - receiveTimeMs is the time taken to receive the frame. At the
@@ -162,6 +166,12 @@ typedef struct _DECODE_UNIT {
     // can be calculated by LiGetMillis() - enqueueTimeMs.
     uint64_t enqueueTimeMs;
 
+    // The same times as above in microseconds, using the same epoch as
+    // LiGetMicroseconds(). The millisecond values are truncated from these.
+    uint64_t receiveTimeUs;
+    uint64_t frameCompleteTimeUs;
+    uint64_t enqueueTimeUs;
+
     // Presentation time in milliseconds with the epoch at the first captured frame.
     // This can be used to aid frame pacing or to drop old frames that were queued too
     // long prior to display.
@@ -249,6 +259,18 @@ typedef struct _DECODE_UNIT {
 // also providing a sample callback is not allowed.
 #define CAPABILITY_PULL_RENDERER 0x20
 
+// If set in the video renderer capabilities field, this flag specifies that the renderer wants
+// each decode unit assembled into a single contiguous buffer. The buffer list still describes the
+// codec configuration NALUs and picture data as separate entries, but they reference consecutive
+// regions of one allocation starting at bufferList->data, which is followed by at least
+// VIDEO_FRAME_BUFFER_PADDING zeroed bytes. Renderers can take ownership of this buffer with
+// LiDetachVideoFrameBuffer() to hand it to a decoder without copying it.
+#define CAPABILITY_CONTIGUOUS_FRAME_BUFFER 0x40
+
+// Number of zeroed bytes following the data of a contiguous frame buffer. This is large enough
+// to satisfy FFmpeg's AV_INPUT_BUFFER_PADDING_SIZE requirement.
+#define VIDEO_FRAME_BUFFER_PADDING 64
+
 // If set in the video renderer capabilities field, this macro specifies that the renderer
 // supports slicing to increase decoding performance. The parameter specifies the desired
 // number of slices per frame. This capability is only valid on video renderers.
@@ -480,6 +502,49 @@ void LiStopConnection(void);
 // so it is not safe to start another connection before the first LiStartConnection() call returns.
 void LiInterruptConnection(void);
 
+// This function records every video and audio RTP packet received in subsequent connections to the
+// specified file, along with the arrival time of each packet. The file can be played back later with
+// LiReplayPacketCapture(). Pass NULL to stop capturing. This must not be called during a connection.
+// The session's encryption keys are only written to the file if includeEncryptionKeys is set, since
+// anyone holding them can decrypt the captured traffic. Without them, encrypted audio can't be replayed.
+void LiSetPacketCaptureFile(const char* path, bool includeEncryptionKeys);
+
+// This function enables synthetic network impairment of the video and audio packets received in
+// subsequent connections (or replayed by LiReplayPacketCapture()) for testing loss recovery. The
+// configuration is a comma-separated list of key=value options. All percentages are per-packet:
+//
+// loss=<percent>          - Random loss outside of bursts
+// burst-start=<percent>   - Chance of entering a loss burst (Gilbert-Elliott bad state)
+// burst-end=<percent>     - Chance of leaving a loss burst
+// burst-loss=<percent>    - Loss during a burst (default 100)
+// reorder=<percent>       - Chance of delivering a packet late
+// reorder-depth=<packets> - How many later packets overtake a reordered packet (default 3)
+// duplicate=<percent>     - Chance of delivering a packet twice
+// jitter=<ms>             - Maximum random delay added to packets, without reordering them
+// seed=<number>           - Random seed, for reproducible runs (default 1)
+//
+// Numbers always use '.' as the decimal separator. Percentages must be at most 100, reorder-depth at
+// most 512 and jitter at most 1000 ms. Pass NULL to disable impairment. Returns false if the
+// configuration is invalid. This must not be called during a connection.
+bool LiSetNetworkImpairment(const char* config);
+
+// This function moves FEC recovery and depacketization of video off the socket receive thread and
+// onto a second thread, so a slow FEC block can't make packets back up in the socket. It costs an
+// extra thread handoff per packet, so it's only worthwhile with a spare CPU core. This must not be
+// called during a connection.
+void LiSetVideoPipelining(bool enabled);
+
+// This function plays back a file recorded with LiSetPacketCaptureFile() through the RTP queues,
+// depacketizer, and the supplied decoder and audio renderer callbacks without a host. If realTime is
+// set, packets are submitted at their recorded arrival times. Otherwise, packets are submitted as fast
+// as the decoder consumes them. LiInterruptConnection() may be called to stop the replay early.
+//
+// This function blocks until the replay is complete. It is not thread-safe and must not be called
+// during a connection.
+int LiReplayPacketCapture(const char* path, bool realTime, PCONNECTION_LISTENER_CALLBACKS clCallbacks,
+    PDECODER_RENDERER_CALLBACKS drCallbacks, PAUDIO_RENDERER_CALLBACKS arCallbacks, void* renderContext, int drFlags,
+    void* audioContext, int arFlags);
+
 // Use to get a user-visible string to display initialization progress
 // from the integer passed to the ConnListenerStageXXX callbacks
 const char* LiGetStageName(int stage);
@@ -490,6 +555,22 @@ const char* LiGetStageName(int stage);
 // This function may only be called between LiStartConnection() and LiStopConnection().
 bool LiGetEstimatedRttInfo(uint32_t* estimatedRtt, uint32_t* estimatedRttVariance);
 
+typedef struct _FRAME_INVALIDATION_STATS {
+    // Reference frame invalidation requests sent to the host
+    uint32_t rfiSent;
+
+    // Lost frame ranges that were folded into another request instead of sent on their own
+    uint32_t rangesMerged;
+
+    // Lost frame spans too long for the host to invalidate, so an IDR frame was requested instead
+    uint32_t idrEscalations;
+} FRAME_INVALIDATION_STATS, *PFRAME_INVALIDATION_STATS;
+
+// This function returns how lost frames have been reported to the host since the connection
+// started. The counters stay at 0 unless reference frame invalidation is in use.
+// This function may only be called between LiStartConnection() and LiStopConnection().
+void LiGetFrameInvalidationStats(PFRAME_INVALIDATION_STATS stats);
+
 // This function queues a relative mouse move event to be sent to the remote server.
 int LiSendMouseMoveEvent(short deltaX, short deltaY);
 
@@ -578,6 +659,10 @@ int LiSendHighResScrollEvent(short scrollAmount);
 // populated from clock_gettime(CLOCK_MONOTONIC) if HAVE_CLOCK_GETTIME.
 uint64_t LiGetMillis(void);
 
+// This function returns a time in microseconds with the same epoch as LiGetMillis().
+// On Windows, this is populated from QueryPerformanceCounter().
+uint64_t LiGetMicroseconds(void);
+
 // This is a simplistic STUN function that can assist clients in getting the WAN address
 // for machines they find using mDNS over IPv4. This can be used to pre-populate the external
 // address for streaming after GFE stopped sending it a while back. wanAddr is returned in
@@ -588,6 +673,25 @@ int LiFindExternalAddressIP4(const char* stunServer, unsigned short stunPort, un
 // if CAPABILITY_DIRECT_SUBMIT is not set for the video renderer.
 int LiGetPendingVideoFrames(void);
 
+typedef struct _VIDEO_QUEUE_DEPTHS {
+    // Packets waiting for the depacketizer thread. These are 0 if video pipelining is disabled.
+    int receivedPackets;
+    int receivedPacketsPeak;
+
+    // Packets held until the rest of their frame arrives or is recovered with FEC
+    int fecPackets;
+    int fecPacketsPeak;
+
+    // Complete frames waiting for the decoder, as returned by LiGetPendingVideoFrames()
+    int decodeUnits;
+    int decodeUnitsPeak;
+} VIDEO_QUEUE_DEPTHS, *PVIDEO_QUEUE_DEPTHS;
+
+// This function returns the current depth of each queue in the video pipeline, along with the
+// deepest each queue has been since the last call. The stage with a growing queue is the one
+// holding up frames.
+void LiGetVideoQueueDepths(PVIDEO_QUEUE_DEPTHS depths);
+
 // Returns the number of queued audio frames ready for delivery. Only relevant
 // if CAPABILITY_DIRECT_SUBMIT is not set for the audio renderer. For most uses,
 // LiGetPendingAudioDuration() is probably a better option than this function.
@@ -658,11 +762,21 @@ unsigned int LiTestClientConnectivity(const char* testServer, unsigned short ref
 // In order to safely use these functions, you must set CAPABILITY_PULL_RENDERER on the video decoder.
 typedef void* VIDEO_FRAME_HANDLE;
 bool LiWaitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit);
+// Like LiWaitForNextVideoFrame(), but returns false if no frame arrives within timeoutMs
+bool LiWaitForNextVideoFrameTimeout(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit, int timeoutMs);
 bool LiPollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit);
 bool LiPeekNextVideoFrame(PDECODE_UNIT* decodeUnit);
 void LiWakeWaitForVideoFrame(void);
 void LiCompleteVideoFrame(VIDEO_FRAME_HANDLE handle, int drStatus);
 
+// These functions allow a renderer using CAPABILITY_CONTIGUOUS_FRAME_BUFFER to take ownership of
+// the frame buffer (bufferList->data) of a decode unit, so it can outlive LiCompleteVideoFrame().
+// LiDetachVideoFrameBuffer() returns NULL if the decode unit doesn't have a contiguous buffer.
+// The buffer list entries must not be used after the detached buffer is freed, and detached
+// buffers must be released with LiFreeVideoFrameBuffer().
+void* LiDetachVideoFrameBuffer(PDECODE_UNIT decodeUnit);
+void LiFreeVideoFrameBuffer(void* buffer);
+
 // This function returns the last reported HDR mode from the host PC.
 // See ConnListenerSetHdrMode() for more details.
 bool LiGetCurrentHostDisplayHdrMode(void);
@@ -82,6 +82,18 @@ int LbqGetItemCount(PLINKED_BLOCKING_QUEUE queueHead) {
     return queueHead->currentSize;
 }
 
+// Returns the largest number of items queued since the last call
+int LbqGetPeakItemCount(PLINKED_BLOCKING_QUEUE queueHead) {
+    int peakSize;
+
+    PltLockMutex(&queueHead->mutex);
+    peakSize = queueHead->peakSize;
+    queueHead->peakSize = queueHead->currentSize;
+    PltUnlockMutex(&queueHead->mutex);
+
+    return peakSize;
+}
+
 int LbqOfferQueueItem(PLINKED_BLOCKING_QUEUE queueHead, void* data, PLINKED_BLOCKING_QUEUE_ENTRY entry) {
     bool wasEmpty;
     
@@ -118,6 +130,9 @@ int LbqOfferQueueItem(PLINKED_BLOCKING_QUEUE queueHead, void* data, PLINKED_BLOC
 
     queueHead->currentSize++;
     queueHead->lifetimeSize++;
+    if (queueHead->currentSize > queueHead->peakSize) {
+        queueHead->peakSize = queueHead->currentSize;
+    }
 
     PltUnlockMutex(&queueHead->mutex);
 
@@ -197,14 +212,28 @@ int LbqPollQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
     return LBQ_SUCCESS;
 }
 
-int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
+// A negative timeout waits forever
+static int waitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data, int timeoutMs) {
     PLINKED_BLOCKING_QUEUE_ENTRY entry;
+    uint64_t deadline = timeoutMs >= 0 ? PltGetMillis() + timeoutMs : 0;
 
     PltLockMutex(&queueHead->mutex);
 
     // Wait for a waking condition: either data available or rundown
     while (queueHead->head == NULL && !queueHead->draining && !queueHead->shutdown && !queueHead->pendingUserWake) {
-        PltWaitForConditionVariable(&queueHead->cond, &queueHead->mutex);
+        if (timeoutMs < 0) {
+            PltWaitForConditionVariable(&queueHead->cond, &queueHead->mutex);
+        }
+        else {
+            uint64_t now = PltGetMillis();
+
+            if (now >= deadline) {
+                PltUnlockMutex(&queueHead->mutex);
+                return LBQ_NO_ELEMENT;
+            }
+
+            PltWaitForConditionVariableTimeout(&queueHead->cond, &queueHead->mutex, (int)(deadline - now));
+        }
     }
 
     // If we're shutting down, abort immediately, even if there's data available
@@ -247,3 +276,13 @@ int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
 
     return LBQ_SUCCESS;
 }
+
+int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
+    return waitForQueueElement(queueHead, data, -1);
+}
+
+// Returns LBQ_NO_ELEMENT if nothing arrives within the timeout
+int LbqWaitForQueueElementTimeout(PLINKED_BLOCKING_QUEUE queueHead, void** data, int timeoutMs) {
+    LC_ASSERT(timeoutMs >= 0);
+    return waitForQueueElement(queueHead, data, timeoutMs);
+}
@@ -22,6 +22,7 @@ typedef struct _LINKED_BLOCKING_QUEUE {
     PLINKED_BLOCKING_QUEUE_ENTRY tail;
     int sizeBound;
     int currentSize;
+    int peakSize;
     int lifetimeSize;
     bool shutdown;
     bool draining;
@@ -31,6 +32,7 @@ typedef struct _LINKED_BLOCKING_QUEUE {
 int LbqInitializeLinkedBlockingQueue(PLINKED_BLOCKING_QUEUE queueHead, int sizeBound);
 int LbqOfferQueueItem(PLINKED_BLOCKING_QUEUE queueHead, void* data, PLINKED_BLOCKING_QUEUE_ENTRY entry);
 int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data);
+int LbqWaitForQueueElementTimeout(PLINKED_BLOCKING_QUEUE queueHead, void** data, int timeoutMs);
 int LbqPollQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data);
 int LbqPeekQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data);
 PLINKED_BLOCKING_QUEUE_ENTRY LbqDestroyLinkedBlockingQueue(PLINKED_BLOCKING_QUEUE queueHead);
@@ -39,3 +41,4 @@ void LbqSignalQueueShutdown(PLINKED_BLOCKING_QUEUE queueHead);
 void LbqSignalQueueDrain(PLINKED_BLOCKING_QUEUE queueHead);
 void LbqSignalQueueUserWake(PLINKED_BLOCKING_QUEUE queueHead);
 int LbqGetItemCount(PLINKED_BLOCKING_QUEUE queueHead);
+int LbqGetPeakItemCount(PLINKED_BLOCKING_QUEUE queueHead);
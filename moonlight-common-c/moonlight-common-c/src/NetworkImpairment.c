@@ -0,0 +1,326 @@
+#include "Limelight-internal.h"
+
+static bool impairmentConfigured;
+static IMPAIRMENT_CONFIG impairmentConfig;
+
+// Parses a non-negative decimal number like "12" or "0.5". This doesn't use strtod()
+// because the decimal separator would follow the application's locale.
+static bool parseNumber(const char* str, const char** end, double* number) {
+    const char* c = str;
+    double scale = 1;
+
+    *number = 0;
+    while (*c >= '0' && *c <= '9') {
+        *number = (*number * 10) + (*c++ - '0');
+    }
+
+    if (*c == '.') {
+        c++;
+        while (*c >= '0' && *c <= '9') {
+            scale /= 10;
+            *number += (*c++ - '0') * scale;
+        }
+    }
+
+    *end = c;
+
+    // There must be at least one digit
+    return c != str && !(c == str + 1 && *str == '.');
+}
+
+// Parses a comma-separated list of key=value pairs, such as
+// "loss=1,burst-start=2,burst-end=25,reorder=1,jitter=5"
+bool LiSetNetworkImpairment(const char* config) {
+    IMPAIRMENT_CONFIG newConfig;
+    const char* option;
+
+    if (config == NULL || config[0] == 0) {
+        impairmentConfigured = false;
+        return true;
+    }
+
+    memset(&newConfig, 0, sizeof(newConfig));
+    newConfig.burstLossPercent = 100;
+    newConfig.reorderDepth = 3;
+    newConfig.seed = 1;
+
+    option = config;
+    while (*option != 0) {
+        const char* value = strchr(option, '=');
+        size_t keyLength;
+        const char* end;
+        double number;
+        float* percent;
+
+        if (value == NULL) {
+            return false;
+        }
+
+        keyLength = value - option;
+        if (!parseNumber(value + 1, &end, &number) || (*end != ',' && *end != 0)) {
+            return false;
+        }
+
+#define OPTION_IS(x) (keyLength == strlen(x) && strncmp(option, x, keyLength) == 0)
+        percent = NULL;
+        if (OPTION_IS("loss")) {
+            percent = &newConfig.lossPercent;
+        }
+        else if (OPTION_IS("burst-start")) {
+            percent = &newConfig.burstStartPercent;
+        }
+        else if (OPTION_IS("burst-end")) {
+            percent = &newConfig.burstEndPercent;
+        }
+        else if (OPTION_IS("burst-loss")) {
+            percent = &newConfig.burstLossPercent;
+        }
+        else if (OPTION_IS("reorder")) {
+            percent = &newConfig.reorderPercent;
+        }
+        else if (OPTION_IS("reorder-depth")) {
+            // A packet can't wait for more packets than we can hold
+            if (number > IMPAIRMENT_MAX_HELD_PACKETS) {
+                return false;
+            }
+            newConfig.reorderDepth = (int)number;
+        }
+        else if (OPTION_IS("duplicate")) {
+            percent = &newConfig.duplicatePercent;
+        }
+        else if (OPTION_IS("jitter")) {
+            if (number > IMPAIRMENT_MAX_JITTER_MS) {
+                return false;
+            }
+            newConfig.jitterMs = (int)number;
+        }
+        else if (OPTION_IS("seed")) {
+            if (number > UINT32_MAX) {
+                return false;
+            }
+            newConfig.seed = (uint32_t)number;
+        }
+        else {
+            return false;
+        }
+#undef OPTION_IS
+
+        if (percent != NULL) {
+            if (number > 100) {
+                return false;
+            }
+            *percent = (float)number;
+        }
+
+        option = *end == ',' ? end + 1 : end;
+    }
+
+    // A burst that never ends would drop the rest of the stream
+    if (newConfig.burstStartPercent > 0 && newConfig.burstEndPercent == 0) {
+        return false;
+    }
+
+    impairmentConfig = newConfig;
+    impairmentConfigured = true;
+    return true;
+}
+
+// xorshift32 is plenty for this and keeps runs reproducible for a given seed
+static uint32_t nextRandom(PPACKET_IMPAIRMENT impairment) {
+    uint32_t x = impairment->rngState;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    impairment->rngState = x;
+
+    return x;
+}
+
+// Returns true with the given probability (in percent)
+static bool randomChance(PPACKET_IMPAIRMENT impairment, float percent) {
+    if (percent <= 0) {
+        return false;
+    }
+
+    return (nextRandom(impairment) % 10000) < (uint32_t)(percent * 100);
+}
+
+void ImpInitializeImpairment(PPACKET_IMPAIRMENT impairment, const char* name,
+                             ImpAllocateBuffer allocateBuffer, ImpFreeBuffer freeBuffer) {
+    const char* c;
+
+    memset(impairment, 0, sizeof(*impairment));
+
+    impairment->name = name;
+    impairment->enabled = impairmentConfigured;
+    impairment->config = impairmentConfig;
+    impairment->allocateBuffer = allocateBuffer;
+    impairment->freeBuffer = freeBuffer;
+
+    // Seed each stream differently, since they'd otherwise see identical loss patterns.
+    // xorshift32 must never be seeded with 0.
+    impairment->rngState = impairmentConfig.seed;
+    for (c = name; *c != 0; c++) {
+        impairment->rngState = (impairment->rngState * 31) + (uint8_t)*c;
+    }
+    if (impairment->rngState == 0) {
+        impairment->rngState = 1;
+    }
+
+    if (impairment->enabled) {
+        Limelog("%s impairment: loss %.2f%%, bursts start %.2f%% end %.2f%% loss %.2f%%, reorder %.2f%% (depth %d), duplicate %.2f%%, jitter %d ms\n",
+                name,
+                impairmentConfig.lossPercent,
+                impairmentConfig.burstStartPercent,
+                impairmentConfig.burstEndPercent,
+                impairmentConfig.burstLossPercent,
+                impairmentConfig.reorderPercent,
+                impairmentConfig.reorderDepth,
+                impairmentConfig.duplicatePercent,
+                impairmentConfig.jitterMs);
+    }
+}
+
+void ImpCleanupImpairment(PPACKET_IMPAIRMENT impairment) {
+    int i;
+
+    if (!impairment->enabled) {
+        return;
+    }
+
+    for (i = 0; i < impairment->heldCount; i++) {
+        impairment->freeBuffer(impairment->heldPackets[i].buffer);
+    }
+    impairment->heldCount = 0;
+
+    if (impairment->packets != 0) {
+        Limelog("%s impairment: %u packets, %u dropped (%u in %u bursts), %u reordered, %u duplicated, %.2f ms average added delay\n",
+                impairment->name,
+                impairment->packets,
+                impairment->dropped,
+                impairment->burstDropped,
+                impairment->bursts,
+                impairment->reordered,
+                impairment->duplicated,
+                (double)impairment->totalDelayUs / impairment->packets / 1000.0);
+    }
+}
+
+static void holdPacket(PPACKET_IMPAIRMENT impairment, char* buffer, int length, uint64_t now) {
+    PIMPAIRED_PACKET heldPacket;
+    uint64_t deliveryTimeUs;
+
+    // If too much is held up, drop the packet like an overflowing router queue would
+    if (impairment->heldCount == IMPAIRMENT_MAX_HELD_PACKETS) {
+        impairment->freeBuffer(buffer);
+        impairment->dropped++;
+        return;
+    }
+
+    // Jitter delays packets without reordering them, like a congested link would
+    deliveryTimeUs = now;
+    if (impairment->config.jitterMs > 0) {
+        deliveryTimeUs += nextRandom(impairment) % ((uint32_t)impairment->config.jitterMs * 1000);
+    }
+    if (deliveryTimeUs < impairment->lastDeliveryTimeUs) {
+        deliveryTimeUs = impairment->lastDeliveryTimeUs;
+    }
+    impairment->lastDeliveryTimeUs = deliveryTimeUs;
+    impairment->totalDelayUs += deliveryTimeUs - now;
+
+    heldPacket = &impairment->heldPackets[impairment->heldCount++];
+    heldPacket->buffer = buffer;
+    heldPacket->length = length;
+    heldPacket->deliveryTimeUs = deliveryTimeUs;
+    heldPacket->packetsToWait = 0;
+
+    if (randomChance(impairment, impairment->config.reorderPercent)) {
+        heldPacket->packetsToWait = impairment->config.reorderDepth;
+        impairment->reordered++;
+    }
+}
+
+// Takes ownership of the buffer
+void ImpSubmitPacket(PPACKET_IMPAIRMENT impairment, char* buffer, int length) {
+    uint64_t now = PltGetMicroseconds();
+    bool lost;
+
+    LC_ASSERT(impairment->enabled);
+
+    impairment->packets++;
+
+    // Gilbert-Elliott state transitions
+    if (impairment->inBurst) {
+        if (randomChance(impairment, impairment->config.burstEndPercent)) {
+            impairment->inBurst = false;
+        }
+    }
+    else if (randomChance(impairment, impairment->config.burstStartPercent)) {
+        impairment->inBurst = true;
+        impairment->bursts++;
+    }
+
+    if (impairment->inBurst) {
+        lost = randomChance(impairment, impairment->config.burstLossPercent);
+        if (lost) {
+            impairment->burstDropped++;
+        }
+    }
+    else {
+        lost = randomChance(impairment, impairment->config.lossPercent);
+    }
+
+    if (lost) {
+        impairment->dropped++;
+        impairment->freeBuffer(buffer);
+        return;
+    }
+
+    if (randomChance(impairment, impairment->config.duplicatePercent)) {
+        char* duplicate = impairment->allocateBuffer();
+        if (duplicate != NULL) {
+            memcpy(duplicate, buffer, length);
+            holdPacket(impairment, duplicate, length, now);
+            impairment->duplicated++;
+        }
+    }
+
+    holdPacket(impairment, buffer, length, now);
+}
+
+// Returns the next packet that is due for delivery, if any
+bool ImpGetPacket(PPACKET_IMPAIRMENT impairment, char** buffer, int* length) {
+    uint64_t now;
+    int i;
+
+    if (impairment->heldCount == 0) {
+        return false;
+    }
+
+    now = PltGetMicroseconds();
+    for (i = 0; i < impairment->heldCount; i++) {
+        PIMPAIRED_PACKET heldPacket = &impairment->heldPackets[i];
+
+        if (heldPacket->packetsToWait == 0 && heldPacket->deliveryTimeUs <= now) {
+            int j;
+
+            *buffer = heldPacket->buffer;
+            *length = heldPacket->length;
+
+            memmove(heldPacket, heldPacket + 1, (impairment->heldCount - i - 1) * sizeof(*heldPacket));
+            impairment->heldCount--;
+
+            // Packets being reordered wait on packets that were received after them
+            for (j = 0; j < i; j++) {
+                if (impairment->heldPackets[j].packetsToWait > 0) {
+                    impairment->heldPackets[j].packetsToWait--;
+                }
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Platform.h"
+
+// Synthetic network impairment applied to received packets before they reach
+// the RTP queues. This is a testing aid for measuring FEC recovery and frame
+// drops under lossy conditions. It is configured with LiSetNetworkImpairment().
+
+typedef struct _IMPAIRMENT_CONFIG {
+    // Gilbert-Elliott loss model. All values are per-packet percentages.
+    float lossPercent;
+    float burstStartPercent;
+    float burstEndPercent;
+    float burstLossPercent;
+
+    // Reordered packets are held until reorderDepth later packets are delivered
+    float reorderPercent;
+    int reorderDepth;
+
+    float duplicatePercent;
+
+    // Each packet is delayed by a random amount up to this, without reordering
+    int jitterMs;
+
+    uint32_t seed;
+} IMPAIRMENT_CONFIG, *PIMPAIRMENT_CONFIG;
+
+#define IMPAIRMENT_MAX_HELD_PACKETS 512
+
+// Longer delays would stall the stream rather than impair it
+#define IMPAIRMENT_MAX_JITTER_MS 1000
+
+typedef struct _IMPAIRED_PACKET {
+    char* buffer;
+    int length;
+    int packetsToWait;
+    uint64_t deliveryTimeUs;
+} IMPAIRED_PACKET, *PIMPAIRED_PACKET;
+
+typedef void* (*ImpAllocateBuffer)(void);
+typedef void (*ImpFreeBuffer)(void* buffer);
+
+typedef struct _PACKET_IMPAIRMENT {
+    const char* name;
+    bool enabled;
+    IMPAIRMENT_CONFIG config;
+    ImpAllocateBuffer allocateBuffer;
+    ImpFreeBuffer freeBuffer;
+
+    uint32_t rngState;
+    bool inBurst;
+    uint64_t lastDeliveryTimeUs;
+
+    IMPAIRED_PACKET heldPackets[IMPAIRMENT_MAX_HELD_PACKETS];
+    int heldCount;
+
+    // Statistics
+    uint32_t packets;
+    uint32_t dropped;
+    uint32_t burstDropped;
+    uint32_t bursts;
+    uint32_t reordered;
+    uint32_t duplicated;
+    uint64_t totalDelayUs;
+} PACKET_IMPAIRMENT, *PPACKET_IMPAIRMENT;
+
+void ImpInitializeImpairment(PPACKET_IMPAIRMENT impairment, const char* name,
+                             ImpAllocateBuffer allocateBuffer, ImpFreeBuffer freeBuffer);
+void ImpCleanupImpairment(PPACKET_IMPAIRMENT impairment);
+void ImpSubmitPacket(PPACKET_IMPAIRMENT impairment, char* buffer, int length);
+bool ImpGetPacket(PPACKET_IMPAIRMENT impairment, char** buffer, int* length);
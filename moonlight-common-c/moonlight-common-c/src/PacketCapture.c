@@ -0,0 +1,392 @@
+#include "Limelight-internal.h"
+
+// A packet capture file starts with a header describing the negotiated stream,
+// followed by one record for each video and audio packet in the order they
+// arrived. Packets are stored exactly as they were received from the network,
+// before byte-swapping or decryption. All fields are little-endian.
+//
+// The stream encryption keys are only written if the caller opted in. They
+// are zeroed otherwise, and encrypted audio is skipped during replay.
+//
+// Header:
+//   uint32_t magic
+//   uint32_t version
+//   uint32_t appVersionQuad[4]
+//   uint32_t videoFormat, width, height, fps, bitrate, packetSize
+//   uint32_t audioConfiguration, audioPacketDuration, audioEncryptionEnabled
+//   uint32_t opusSampleRate, opusChannelCount, opusStreams, opusCoupledStreams
+//   uint8_t  opusMapping[AUDIO_CONFIGURATION_MAX_CHANNEL_COUNT]
+//   uint32_t keysIncluded
+//   uint8_t  remoteInputAesKey[16]
+//   uint8_t  remoteInputAesIv[16]
+//
+// Record:
+//   uint8_t  stream (CAPTURE_STREAM_*)
+//   uint8_t  reserved
+//   uint16_t length
+//   uint32_t microseconds since the previous record
+//   uint8_t  data[length]
+#define CAPTURE_MAGIC 0x5041434C
+#define CAPTURE_VERSION 2
+#define CAPTURE_HEADER_SIZE ((20 * 4) + AUDIO_CONFIGURATION_MAX_CHANNEL_COUNT + 16 + 16)
+#define CAPTURE_RECORD_HEADER_SIZE 8
+
+// When replaying as fast as possible, we stop feeding packets once this many
+// decode units or audio packets are waiting on the decoders. Otherwise we'd
+// just overflow the queues and measure how fast we can drop frames.
+#define REPLAY_MAX_PENDING_VIDEO_FRAMES 4
+#define REPLAY_MAX_PENDING_AUDIO_FRAMES 10
+
+static char* capturePath;
+static bool captureIncludeKeys;
+static FILE* captureFile;
+static PLT_MUTEX captureMutex;
+static uint64_t lastCaptureTimeUs;
+
+void LiSetPacketCaptureFile(const char* path, bool includeEncryptionKeys) {
+    free(capturePath);
+    capturePath = path != NULL ? strdup(path) : NULL;
+    captureIncludeKeys = includeEncryptionKeys;
+}
+
+// This must be called after the RTSP handshake, since the header
+// contains the negotiated stream parameters.
+void startPacketCapture(void) {
+    char header[CAPTURE_HEADER_SIZE];
+    BYTE_BUFFER bb;
+    POPUS_MULTISTREAM_CONFIGURATION opusConfig;
+    int i;
+
+    LC_ASSERT(captureFile == NULL);
+
+    if (capturePath == NULL) {
+        return;
+    }
+
+    opusConfig = HighQualitySurroundEnabled ? &HighQualityOpusConfig : &NormalQualityOpusConfig;
+
+    BbInitializeWrappedBuffer(&bb, header, 0, sizeof(header), BYTE_ORDER_LITTLE);
+    BbPut32(&bb, CAPTURE_MAGIC);
+    BbPut32(&bb, CAPTURE_VERSION);
+    for (i = 0; i < 4; i++) {
+        BbPut32(&bb, (uint32_t)AppVersionQuad[i]);
+    }
+    BbPut32(&bb, (uint32_t)NegotiatedVideoFormat);
+    BbPut32(&bb, (uint32_t)StreamConfig.width);
+    BbPut32(&bb, (uint32_t)StreamConfig.height);
+    BbPut32(&bb, (uint32_t)StreamConfig.fps);
+    BbPut32(&bb, (uint32_t)StreamConfig.bitrate);
+    BbPut32(&bb, (uint32_t)StreamConfig.packetSize);
+    BbPut32(&bb, (uint32_t)StreamConfig.audioConfiguration);
+    BbPut32(&bb, (uint32_t)AudioPacketDuration);
+    BbPut32(&bb, AudioEncryptionEnabled ? 1 : 0);
+    BbPut32(&bb, (uint32_t)opusConfig->sampleRate);
+    BbPut32(&bb, (uint32_t)opusConfig->channelCount);
+    BbPut32(&bb, (uint32_t)opusConfig->streams);
+    BbPut32(&bb, (uint32_t)opusConfig->coupledStreams);
+    for (i = 0; i < AUDIO_CONFIGURATION_MAX_CHANNEL_COUNT; i++) {
+        BbPut8(&bb, opusConfig->mapping[i]);
+    }
+    BbPut32(&bb, captureIncludeKeys ? 1 : 0);
+    for (i = 0; i < (int)sizeof(StreamConfig.remoteInputAesKey); i++) {
+        BbPut8(&bb, captureIncludeKeys ? (uint8_t)StreamConfig.remoteInputAesKey[i] : 0);
+    }
+    for (i = 0; i < (int)sizeof(StreamConfig.remoteInputAesIv); i++) {
+        BbPut8(&bb, captureIncludeKeys ? (uint8_t)StreamConfig.remoteInputAesIv[i] : 0);
+    }
+    LC_ASSERT(bb.position == sizeof(header));
+
+    captureFile = fopen(capturePath, "wb");
+    if (captureFile == NULL) {
+        Limelog("Unable to open packet capture file: %s\n", capturePath);
+        return;
+    }
+
+    if (fwrite(header, sizeof(header), 1, captureFile) != 1) {
+        Limelog("Unable to write packet capture file: %s\n", capturePath);
+        fclose(captureFile);
+        captureFile = NULL;
+        return;
+    }
+
+    PltCreateMutex(&captureMutex);
+    lastCaptureTimeUs = PltGetMicroseconds();
+
+    Limelog("Capturing video and audio packets to %s\n", capturePath);
+    if (captureIncludeKeys) {
+        Limelog("WARNING: The packet capture contains this session's encryption keys. "
+                "Anyone with the file can decrypt the captured audio and control traffic.\n");
+    }
+}
+
+// This may be called concurrently by the video and audio receive threads
+void capturePacket(int stream, const char* data, int length) {
+    char recordHeader[CAPTURE_RECORD_HEADER_SIZE];
+    BYTE_BUFFER bb;
+    uint64_t now;
+
+    // The capture file is only opened or closed while the receive threads are stopped
+    if (captureFile == NULL) {
+        return;
+    }
+
+    LC_ASSERT(length >= 0 && length <= UINT16_MAX);
+
+    PltLockMutex(&captureMutex);
+
+    now = PltGetMicroseconds();
+
+    BbInitializeWrappedBuffer(&bb, recordHeader, 0, sizeof(recordHeader), BYTE_ORDER_LITTLE);
+    BbPut8(&bb, (uint8_t)stream);
+    BbPut8(&bb, 0);
+    BbPut16(&bb, (uint16_t)length);
+    BbPut32(&bb, (uint32_t)(now - lastCaptureTimeUs > UINT32_MAX ? UINT32_MAX : now - lastCaptureTimeUs));
+    lastCaptureTimeUs = now;
+
+    fwrite(recordHeader, sizeof(recordHeader), 1, captureFile);
+    fwrite(data, 1, length, captureFile);
+
+    PltUnlockMutex(&captureMutex);
+}
+
+void stopPacketCapture(void) {
+    if (captureFile == NULL) {
+        return;
+    }
+
+    fclose(captureFile);
+    captureFile = NULL;
+    PltDeleteMutex(&captureMutex);
+}
+
+static int getInt(PBYTE_BUFFER bb) {
+    uint32_t value = 0;
+    BbGet32(bb, &value);
+    return (int)value;
+}
+
+// Populates the stream globals from the capture header
+static bool readCaptureHeader(FILE* file, bool* keysIncluded) {
+    char header[CAPTURE_HEADER_SIZE];
+    BYTE_BUFFER bb;
+    uint8_t value;
+    int i;
+
+    if (fread(header, sizeof(header), 1, file) != 1) {
+        return false;
+    }
+
+    BbInitializeWrappedBuffer(&bb, header, 0, sizeof(header), BYTE_ORDER_LITTLE);
+    if ((uint32_t)getInt(&bb) != CAPTURE_MAGIC || getInt(&bb) != CAPTURE_VERSION) {
+        return false;
+    }
+
+    for (i = 0; i < 4; i++) {
+        AppVersionQuad[i] = getInt(&bb);
+    }
+
+    memset(&StreamConfig, 0, sizeof(StreamConfig));
+    NegotiatedVideoFormat = getInt(&bb);
+    StreamConfig.width = getInt(&bb);
+    StreamConfig.height = getInt(&bb);
+    StreamConfig.fps = getInt(&bb);
+    StreamConfig.bitrate = getInt(&bb);
+    StreamConfig.packetSize = getInt(&bb);
+    StreamConfig.audioConfiguration = getInt(&bb);
+    AudioPacketDuration = getInt(&bb);
+    AudioEncryptionEnabled = getInt(&bb) != 0;
+
+    // The captured Opus configuration is the one that was chosen for the stream
+    memset(&NormalQualityOpusConfig, 0, sizeof(NormalQualityOpusConfig));
+    HighQualitySurroundSupported = false;
+    HighQualitySurroundEnabled = false;
+    NormalQualityOpusConfig.sampleRate = getInt(&bb);
+    NormalQualityOpusConfig.channelCount = getInt(&bb);
+    NormalQualityOpusConfig.streams = getInt(&bb);
+    NormalQualityOpusConfig.coupledStreams = getInt(&bb);
+    for (i = 0; i < AUDIO_CONFIGURATION_MAX_CHANNEL_COUNT; i++) {
+        BbGet8(&bb, &NormalQualityOpusConfig.mapping[i]);
+    }
+
+    // Without the keys, these are left as zeroes
+    *keysIncluded = getInt(&bb) != 0;
+    for (i = 0; i < (int)sizeof(StreamConfig.remoteInputAesKey); i++) {
+        BbGet8(&bb, &value);
+        StreamConfig.remoteInputAesKey[i] = (char)value;
+    }
+    for (i = 0; i < (int)sizeof(StreamConfig.remoteInputAesIv); i++) {
+        BbGet8(&bb, &value);
+        StreamConfig.remoteInputAesIv[i] = (char)value;
+    }
+    LC_ASSERT(bb.position == sizeof(header));
+
+    return NegotiatedVideoFormat != 0 && StreamConfig.packetSize > 0 && AudioPacketDuration > 0;
+}
+
+int LiReplayPacketCapture(const char* path, bool realTime, PCONNECTION_LISTENER_CALLBACKS clCallbacks,
+    PDECODER_RENDERER_CALLBACKS drCallbacks, PAUDIO_RENDERER_CALLBACKS arCallbacks, void* renderContext, int drFlags,
+    void* audioContext, int arFlags) {
+    FILE* file;
+    char recordHeader[CAPTURE_RECORD_HEADER_SIZE];
+    char* packet;
+    uint64_t startTimeUs;
+    uint64_t captureTimeUs;
+    uint32_t videoPackets;
+    uint32_t audioPackets;
+    uint32_t skippedAudioPackets;
+    bool keysIncluded;
+    int err;
+
+    // Replace missing callbacks with placeholders
+    fixupMissingCallbacks(&drCallbacks, &arCallbacks, &clCallbacks);
+    memcpy(&VideoCallbacks, drCallbacks, sizeof(VideoCallbacks));
+    memcpy(&AudioCallbacks, arCallbacks, sizeof(AudioCallbacks));
+    memcpy(&ListenerCallbacks, clCallbacks, sizeof(ListenerCallbacks));
+
+    // There's no host to act on reference frame invalidation requests
+    VideoCallbacks.capabilities &= ~(CAPABILITY_REFERENCE_FRAME_INVALIDATION_AVC | CAPABILITY_REFERENCE_FRAME_INVALIDATION_HEVC);
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        Limelog("Unable to open packet capture file: %s\n", path);
+        return -1;
+    }
+
+    if (!readCaptureHeader(file, &keysIncluded)) {
+        Limelog("Invalid packet capture file: %s\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    packet = malloc(UINT16_MAX);
+    if (packet == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    ConnectionInterrupted = false;
+    OriginalVideoBitrate = StreamConfig.bitrate;
+
+    err = initializePlatform();
+    if (err != 0) {
+        goto CloseFile;
+    }
+
+    // The depacketizer reports frame loss through the control stream
+    err = initializeControlStream();
+    if (err != 0) {
+        goto CleanupPlatform;
+    }
+
+    err = initializeVideoStream();
+    if (err != 0) {
+        goto DestroyControlStream;
+    }
+
+    err = startVideoReplay(renderContext, drFlags);
+    if (err != 0) {
+        Limelog("Video stream start failed: %d\n", err);
+        goto DestroyStreams;
+    }
+
+    err = startAudioReplay(audioContext, arFlags);
+    if (err != 0) {
+        Limelog("Audio stream start failed: %d\n", err);
+        goto StopVideo;
+    }
+
+    Limelog("Replaying %s at %s\n", path, realTime ? "recorded speed" : "maximum speed");
+    if (AudioEncryptionEnabled && !keysIncluded) {
+        Limelog("Packet capture has no encryption keys. Encrypted audio will be skipped.\n");
+    }
+
+    videoPackets = 0;
+    audioPackets = 0;
+    skippedAudioPackets = 0;
+    captureTimeUs = 0;
+    startTimeUs = PltGetMicroseconds();
+    while (!ConnectionInterrupted && fread(recordHeader, sizeof(recordHeader), 1, file) == 1) {
+        BYTE_BUFFER bb;
+        uint8_t stream;
+        uint8_t reserved;
+        uint16_t length;
+        uint32_t deltaUs;
+
+        BbInitializeWrappedBuffer(&bb, recordHeader, 0, sizeof(recordHeader), BYTE_ORDER_LITTLE);
+        BbGet8(&bb, &stream);
+        BbGet8(&bb, &reserved);
+        BbGet16(&bb, &length);
+        BbGet32(&bb, &deltaUs);
+
+        if (length != 0 && fread(packet, length, 1, file) != 1) {
+            Limelog("Packet capture file is truncated\n");
+            break;
+        }
+
+        captureTimeUs += deltaUs;
+
+        if (realTime) {
+            // Wait until this packet's arrival time relative to the start of the replay
+            uint64_t elapsedUs = PltGetMicroseconds() - startTimeUs;
+            if (captureTimeUs >= elapsedUs + 1000) {
+                PltSleepMs((int)((captureTimeUs - elapsedUs) / 1000));
+            }
+        }
+        else {
+            while (!ConnectionInterrupted &&
+                   (LiGetPendingVideoFrames() >= REPLAY_MAX_PENDING_VIDEO_FRAMES ||
+                    LiGetPendingAudioFrames() >= REPLAY_MAX_PENDING_AUDIO_FRAMES)) {
+                PltSleepMs(1);
+            }
+        }
+
+        if (stream == CAPTURE_STREAM_VIDEO) {
+            if (!replayVideoPacket(packet, length)) {
+                err = -1;
+                break;
+            }
+            videoPackets++;
+        }
+        else if (stream == CAPTURE_STREAM_AUDIO) {
+            if (AudioEncryptionEnabled && !keysIncluded) {
+                // We can't decrypt this without the key
+                skippedAudioPackets++;
+                continue;
+            }
+
+            if (!replayAudioPacket(packet, length)) {
+                err = -1;
+                break;
+            }
+            audioPackets++;
+        }
+    }
+
+    // Let the decoders finish what's already queued
+    while (!ConnectionInterrupted && (LiGetPendingVideoFrames() > 0 || LiGetPendingAudioFrames() > 0)) {
+        PltSleepMs(1);
+    }
+
+    Limelog("Replayed %u video and %u audio packets (%u encrypted audio packets skipped) in %llu ms\n",
+            videoPackets, audioPackets, skippedAudioPackets,
+            (unsigned long long)((PltGetMicroseconds() - startTimeUs) / 1000));
+
+    stopAudioReplay();
+
+StopVideo:
+    stopVideoReplay();
+
+DestroyStreams:
+    destroyVideoStream();
+
+DestroyControlStream:
+    destroyUnstartedControlStream();
+
+CleanupPlatform:
+    cleanupPlatform();
+
+CloseFile:
+    free(packet);
+    fclose(file);
+    return err;
+}
@@ -0,0 +1,105 @@
+#include "Limelight-internal.h"
+
+// Keep each buffer suitably aligned for the queue entries stored at the end
+#define POOL_BUFFER_ALIGNMENT 16
+
+// Initialize a pool of 'capacity' fixed-size buffers
+int PoolInitializePacketPool(PPACKET_POOL pool, int bufferSize, int capacity) {
+    int err;
+    int i;
+
+    memset(pool, 0, sizeof(*pool));
+
+    err = PltCreateMutex(&pool->mutex);
+    if (err != 0) {
+        return err;
+    }
+
+    pool->bufferSize = (bufferSize + POOL_BUFFER_ALIGNMENT - 1) & ~(POOL_BUFFER_ALIGNMENT - 1);
+
+    pool->slab = (char*)malloc((size_t)pool->bufferSize * capacity);
+    if (pool->slab == NULL) {
+        Limelog("Packet pool: unable to allocate %d buffers\n", capacity);
+        PltDeleteMutex(&pool->mutex);
+        return -1;
+    }
+
+    pool->capacity = capacity;
+    pool->slabEnd = pool->slab + ((size_t)pool->bufferSize * capacity);
+
+    // Thread the free list through the buffers themselves
+    for (i = capacity - 1; i >= 0; i--) {
+        PPACKET_POOL_ENTRY entry = (PPACKET_POOL_ENTRY)&pool->slab[(size_t)pool->bufferSize * i];
+        entry->next = pool->freeList;
+        pool->freeList = entry;
+    }
+
+    return 0;
+}
+
+void PoolDestroyPacketPool(PPACKET_POOL pool) {
+    // All slab buffers must have been returned before we free the slab
+    LC_ASSERT(pool->outstanding == 0);
+
+    Limelog("Packet pool: %llu allocations, %u misses, high-water mark %d of %d buffers\n",
+            (unsigned long long)pool->allocations, pool->misses, pool->highWaterMark, pool->capacity);
+
+    free(pool->slab);
+    pool->slab = pool->slabEnd = NULL;
+    pool->freeList = NULL;
+
+    PltDeleteMutex(&pool->mutex);
+}
+
+// Returns a buffer of at least the pool's buffer size, or NULL on OOM
+void* PoolAllocatePacket(PPACKET_POOL pool) {
+    PPACKET_POOL_ENTRY entry;
+
+    PltLockMutex(&pool->mutex);
+
+    pool->allocations++;
+
+    entry = pool->freeList;
+    if (entry != NULL) {
+        pool->freeList = entry->next;
+        pool->outstanding++;
+        if (pool->outstanding > pool->highWaterMark) {
+            pool->highWaterMark = pool->outstanding;
+        }
+    }
+    else {
+        pool->misses++;
+    }
+
+    PltUnlockMutex(&pool->mutex);
+
+    if (entry == NULL) {
+        // The pool is exhausted, so fall back to the heap
+        return malloc(pool->bufferSize);
+    }
+
+    return entry;
+}
+
+// Releases a buffer from PoolAllocatePacket(). Buffers outside the slab
+// (pool misses or plain malloc() allocations) are returned to the heap.
+void PoolFreePacket(PPACKET_POOL pool, void* buffer) {
+    PPACKET_POOL_ENTRY entry = (PPACKET_POOL_ENTRY)buffer;
+
+    if ((char*)buffer < pool->slab || (char*)buffer >= pool->slabEnd) {
+        free(buffer);
+        return;
+    }
+
+    LC_ASSERT(((char*)buffer - pool->slab) % pool->bufferSize == 0);
+
+    PltLockMutex(&pool->mutex);
+
+    entry->next = pool->freeList;
+    pool->freeList = entry;
+
+    LC_ASSERT(pool->outstanding > 0);
+    pool->outstanding--;
+
+    PltUnlockMutex(&pool->mutex);
+}
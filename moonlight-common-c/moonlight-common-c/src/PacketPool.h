@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Platform.h"
+#include "PlatformThreads.h"
+
+typedef struct _PACKET_POOL_ENTRY {
+    struct _PACKET_POOL_ENTRY* next;
+} PACKET_POOL_ENTRY, *PPACKET_POOL_ENTRY;
+
+typedef struct _PACKET_POOL {
+    PLT_MUTEX mutex;
+    char* slab;
+    char* slabEnd;
+    PPACKET_POOL_ENTRY freeList;
+    int bufferSize;
+    int capacity;
+
+    // Statistics
+    int outstanding;
+    int highWaterMark;
+    uint32_t misses;
+    uint64_t allocations;
+} PACKET_POOL, *PPACKET_POOL;
+
+int PoolInitializePacketPool(PPACKET_POOL pool, int bufferSize, int capacity);
+void PoolDestroyPacketPool(PPACKET_POOL pool);
+void* PoolAllocatePacket(PPACKET_POOL pool);
+void PoolFreePacket(PPACKET_POOL pool, void* buffer);
@@ -351,6 +351,26 @@ int PltCreateConditionVariable(PLT_COND* cond, PLT_MUTEX* mutex) {
     }
 #elif defined(__WIIU__)
     OSFastCond_Init(cond, "");
+#elif HAVE_CLOCK_GETTIME && !defined(__APPLE__)
+    pthread_condattr_t attr;
+    int err;
+
+    // Use the monotonic clock for timed waits, so wall clock changes
+    // don't stretch or cut short our timeouts
+    err = pthread_condattr_init(&attr);
+    if (err != 0) {
+        return err;
+    }
+
+    err = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (err == 0) {
+        err = pthread_cond_init(cond, &attr);
+    }
+
+    pthread_condattr_destroy(&attr);
+    if (err != 0) {
+        return err;
+    }
 #else
     pthread_cond_init(cond, NULL);
 #endif
@@ -393,21 +413,81 @@ void PltWaitForConditionVariable(PLT_COND* cond, PLT_MUTEX* mutex) {
 #endif
 }
 
+// Returns after the condition variable is signalled or the timeout expires.
+// Like PltWaitForConditionVariable(), spurious wakeups are possible.
+void PltWaitForConditionVariableTimeout(PLT_COND* cond, PLT_MUTEX* mutex, int timeoutMs) {
+#if defined(LC_WINDOWS)
+    SleepConditionVariableSRW(cond, mutex, timeoutMs, 0);
+#elif defined(__vita__)
+    SceUInt timeoutUs = timeoutMs * 1000;
+    sceKernelWaitCond(*cond, &timeoutUs);
+#elif defined(__WIIU__)
+    // OSFastCondition has no timed wait, so just sleep for the timeout
+    PltUnlockMutex(mutex);
+    PltSleepMs(timeoutMs);
+    PltLockMutex(mutex);
+#elif defined(__APPLE__)
+    struct timespec timeout;
+
+    // Darwin lacks pthread_condattr_setclock(), but it can wait on a
+    // relative timeout which isn't affected by wall clock changes
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+
+    pthread_cond_timedwait_relative_np(cond, mutex, &timeout);
+#else
+    struct timespec deadline;
+
+    // pthread_cond_timedwait() takes an absolute deadline on the clock
+    // the condition variable was created with
+#if HAVE_CLOCK_GETTIME
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+#else
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    deadline.tv_sec = now.tv_sec;
+    deadline.tv_nsec = now.tv_usec * 1000;
+#endif
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_cond_timedwait(cond, mutex, &deadline);
+#endif
+}
+
+// Derived from PltGetMicroseconds() so that millisecond and microsecond
+// timestamps can be compared with each other
 uint64_t PltGetMillis(void) {
+    return PltGetMicroseconds() / 1000;
+}
+
+uint64_t PltGetMicroseconds(void) {
 #if defined(LC_WINDOWS)
-    return GetTickCount64();
+    LARGE_INTEGER frequency, counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    // Split the conversion to avoid overflowing the multiplication
+    return ((counter.QuadPart / frequency.QuadPart) * 1000000) +
+           (((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
 #elif HAVE_CLOCK_GETTIME
     struct timespec tv;
-    
+
     clock_gettime(CLOCK_MONOTONIC, &tv);
-    
-    return (tv.tv_sec * 1000) + (tv.tv_nsec / 1000000);
+
+    return ((uint64_t)tv.tv_sec * 1000000) + (tv.tv_nsec / 1000);
 #else
     struct timeval tv;
 
     gettimeofday(&tv, NULL);
 
-    return (tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+    return ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
 #endif
 }
 
@@ -1,5 +1,11 @@
+#define _GNU_SOURCE
 #include "Limelight-internal.h"
 
+#if defined(__linux__)
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#endif
+
 #define TEST_PORT_TIMEOUT_SEC 3
 
 #define RCV_BUFFER_SIZE_MIN  32767
@@ -160,6 +166,79 @@ bool isSocketReadable(SOCKET s) {
     return true;
 }
 
+int createSocketWakeup(PSOCKET_WAKEUP wakeup) {
+#if defined(__linux__)
+    wakeup->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeup->fd < 0) {
+        int err = LastSocketFail();
+        Limelog("eventfd() failed: %d\n", err);
+        return err;
+    }
+
+    return 0;
+#else
+    struct sockaddr_in addr;
+    SOCKADDR_LEN addrLen;
+    int err;
+
+    wakeup->fd = createSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP, true);
+    if (wakeup->fd == INVALID_SOCKET) {
+        return LastSocketFail();
+    }
+
+    // Bind to an ephemeral loopback port and connect the socket to itself,
+    // so signalling is a send() and the socket polls readable until drained.
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addrLen = sizeof(addr);
+    if (bind(wakeup->fd, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            getsockname(wakeup->fd, (struct sockaddr*)&addr, &addrLen) == SOCKET_ERROR ||
+            connect(wakeup->fd, (struct sockaddr*)&addr, addrLen) == SOCKET_ERROR) {
+        err = LastSocketFail();
+        Limelog("Failed to create loopback wakeup socket: %d\n", err);
+        closeSocket(wakeup->fd);
+        wakeup->fd = INVALID_SOCKET;
+        return err;
+    }
+
+    return 0;
+#endif
+}
+
+void signalSocketWakeup(PSOCKET_WAKEUP wakeup) {
+#if defined(__linux__)
+    uint64_t count = 1;
+
+    // This can only fail if the counter would overflow, which means it's already signalled
+    (void)!write(wakeup->fd, &count, sizeof(count));
+#else
+    char wakeByte = 0;
+
+    // A full socket buffer means we're already signalled
+    send(wakeup->fd, &wakeByte, sizeof(wakeByte), 0);
+#endif
+}
+
+void drainSocketWakeup(PSOCKET_WAKEUP wakeup) {
+#if defined(__linux__)
+    uint64_t count;
+
+    (void)!read(wakeup->fd, &count, sizeof(count));
+#else
+    char buffer[16];
+
+    while (recv(wakeup->fd, buffer, sizeof(buffer), 0) > 0);
+#endif
+}
+
+void closeSocketWakeup(PSOCKET_WAKEUP wakeup) {
+    if (wakeup->fd != INVALID_SOCKET) {
+        closeSocket(wakeup->fd);
+        wakeup->fd = INVALID_SOCKET;
+    }
+}
+
 int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect) {
     int err;
     
@@ -206,6 +285,79 @@ int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect) {
     return err;
 }
 
+int recvUdpSocketBatch(SOCKET s, char** buffers, int* lengths, int size, int count, bool useSelect) {
+#if defined(__linux__)
+    struct mmsghdr msgs[UDP_RECV_MAX_BATCH];
+    struct iovec iovs[UDP_RECV_MAX_BATCH];
+    int err, i;
+
+    LC_ASSERT(count > 0 && count <= UDP_RECV_MAX_BATCH);
+
+    for (i = 0; i < count; i++) {
+        iovs[i].iov_base = buffers[i];
+        iovs[i].iov_len = size;
+
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_len = 0;
+    }
+
+    do {
+        if (useSelect) {
+            struct pollfd pfd;
+
+            // Wait up to 100 ms for the socket to be readable
+            pfd.fd = s;
+            pfd.events = POLLIN;
+            err = pollSockets(&pfd, 1, UDP_RECV_POLL_TIMEOUT_MS);
+            if (err <= 0) {
+                // Return if an error or timeout occurs
+                return err;
+            }
+
+            // Drain whatever is queued without blocking
+            err = recvmmsg(s, msgs, count, MSG_DONTWAIT, NULL);
+        }
+        else {
+            // MSG_WAITFORONE blocks (up to SO_RCVTIMEO) for the first
+            // packet, then picks up anything else already queued.
+            err = recvmmsg(s, msgs, count, MSG_WAITFORONE, NULL);
+        }
+
+        if (err < 0 &&
+                (LastSocketError() == EWOULDBLOCK ||
+                 LastSocketError() == EINTR ||
+                 LastSocketError() == EAGAIN ||
+                 LastSocketError() == ETIMEDOUT)) {
+            // Return 0 for timeout
+            return 0;
+        }
+
+    // Ignore errors from stale ICMP Port Unreachable messages like recvUdpSocket()
+    } while (err < 0 && LastSocketError() == ECONNREFUSED);
+
+    for (i = 0; i < err; i++) {
+        lengths[i] = (int)msgs[i].msg_len;
+    }
+
+    return err;
+#else
+    int err;
+
+    LC_ASSERT(count == 1);
+
+    // No batched receive API on this platform, so just read a single packet
+    err = recvUdpSocket(s, buffers[0], size, useSelect);
+    if (err <= 0) {
+        return err;
+    }
+
+    lengths[0] = err;
+    return 1;
+#endif
+}
+
 void closeSocket(SOCKET s) {
 #if defined(LC_WINDOWS)
     closesocket(s);
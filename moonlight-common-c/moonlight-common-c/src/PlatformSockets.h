@@ -91,6 +91,16 @@ SOCKET bindUdpSocket(int addrfamily, int bufferSize);
 int enableNoDelay(SOCKET s);
 int setSocketNonBlocking(SOCKET s, bool enabled);
 int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect);
+
+// Receives up to 'count' datagrams into 'buffers' with a single syscall where the
+// platform supports it (recvmmsg() on Linux). Returns the number of datagrams received
+// with their sizes in 'lengths', 0 on timeout, or < 0 on error.
+#if defined(__linux__)
+#define UDP_RECV_MAX_BATCH 32
+#else
+#define UDP_RECV_MAX_BATCH 1
+#endif
+int recvUdpSocketBatch(SOCKET s, char** buffers, int* lengths, int size, int count, bool useSelect);
 void shutdownTcpSocket(SOCKET s);
 int setNonFatalRecvTimeoutMs(SOCKET s, int timeoutMs);
 void closeSocket(SOCKET s);
@@ -98,6 +108,18 @@ bool isPrivateNetworkAddress(struct sockaddr_storage* address);
 int pollSockets(struct pollfd* pollFds, int pollFdsCount, int timeoutMs);
 bool isSocketReadable(SOCKET s);
 
+// A pollable object that lets other threads wake up a thread blocked in
+// pollSockets(). It is an eventfd on Linux and a loopback UDP socket
+// connected to itself elsewhere.
+typedef struct _SOCKET_WAKEUP {
+    SOCKET fd;
+} SOCKET_WAKEUP, *PSOCKET_WAKEUP;
+
+int createSocketWakeup(PSOCKET_WAKEUP wakeup);
+void signalSocketWakeup(PSOCKET_WAKEUP wakeup);
+void drainSocketWakeup(PSOCKET_WAKEUP wakeup);
+void closeSocketWakeup(PSOCKET_WAKEUP wakeup);
+
 #define TCP_PORT_MASK 0xFFFF
 #define TCP_PORT_FLAG_ALWAYS_TEST 0x10000
 int resolveHostName(const char* host, int family, int tcpTestPort, struct sockaddr_storage* addr, SOCKADDR_LEN* addrLen);
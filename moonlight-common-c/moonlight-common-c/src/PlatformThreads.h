@@ -70,6 +70,58 @@ int PltCreateConditionVariable(PLT_COND* cond, PLT_MUTEX* mutex);
 void PltDeleteConditionVariable(PLT_COND* cond);
 void PltSignalConditionVariable(PLT_COND* cond);
 void PltWaitForConditionVariable(PLT_COND* cond, PLT_MUTEX* mutex);
+void PltWaitForConditionVariableTimeout(PLT_COND* cond, PLT_MUTEX* mutex, int timeoutMs);
 
 void PltSleepMs(int ms);
 void PltSleepMsInterruptible(PLT_THREAD* thread, int ms);
+
+// Sequentially consistent atomic operations on 32-bit integers
+#if defined(LC_WINDOWS)
+typedef volatile LONG PLT_ATOMIC_INT;
+
+static inline int PltAtomicLoad(PLT_ATOMIC_INT* value) {
+    return InterlockedCompareExchange(value, 0, 0);
+}
+
+static inline void PltAtomicStore(PLT_ATOMIC_INT* value, int newValue) {
+    InterlockedExchange(value, newValue);
+}
+
+static inline int PltAtomicExchange(PLT_ATOMIC_INT* value, int newValue) {
+    return InterlockedExchange(value, newValue);
+}
+
+// Returns the new value
+static inline int PltAtomicAdd(PLT_ATOMIC_INT* value, int addend) {
+    return InterlockedExchangeAdd(value, addend) + addend;
+}
+
+static inline bool PltAtomicCompareExchange(PLT_ATOMIC_INT* value, int expected, int newValue) {
+    return InterlockedCompareExchange(value, newValue, expected) == expected;
+}
+#else
+typedef volatile int32_t PLT_ATOMIC_INT;
+
+static inline int PltAtomicLoad(PLT_ATOMIC_INT* value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static inline void PltAtomicStore(PLT_ATOMIC_INT* value, int newValue) {
+    __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+static inline int PltAtomicExchange(PLT_ATOMIC_INT* value, int newValue) {
+    return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+// Returns the new value
+static inline int PltAtomicAdd(PLT_ATOMIC_INT* value, int addend) {
+    return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+}
+
+static inline bool PltAtomicCompareExchange(PLT_ATOMIC_INT* value, int expected, int newValue) {
+    int32_t expectedValue = expected;
+    return __atomic_compare_exchange_n(value, &expectedValue, newValue, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
@@ -0,0 +1,275 @@
+#include "RingQueue.h"
+
+// Claim the entry at the head of the queue. This is safe to call from
+// multiple threads because the head only moves by compare-and-exchange.
+static bool dequeueEntry(PRING_QUEUE queueHead, PLINKED_BLOCKING_QUEUE_ENTRY* entry) {
+    for (;;) {
+        unsigned int head = (unsigned int)PltAtomicLoad(&queueHead->head);
+        unsigned int tail = (unsigned int)PltAtomicLoad(&queueHead->tail);
+        PLINKED_BLOCKING_QUEUE_ENTRY headEntry;
+
+        if (head == tail) {
+            return false;
+        }
+
+        // The producer can't reuse this slot until the head moves past it,
+        // so the entry we read here is valid if we win the exchange.
+        headEntry = queueHead->slots[head & queueHead->mask];
+        if (PltAtomicCompareExchange(&queueHead->head, (int)head, (int)(head + 1))) {
+            *entry = headEntry;
+            return true;
+        }
+    }
+}
+
+// Wake the consumer blocked in RqWaitForQueueElement() (if any)
+static void wakeWaiters(PRING_QUEUE queueHead) {
+    // Taking the lock ensures the waiter has either seen our update
+    // or is already waiting on the condition variable.
+    PltLockMutex(&queueHead->mutex);
+    PltUnlockMutex(&queueHead->mutex);
+    PltSignalConditionVariable(&queueHead->cond);
+}
+
+// Ring queue init
+int RqInitializeRingQueue(PRING_QUEUE queueHead, int sizeBound) {
+    unsigned int capacity;
+    int err;
+
+    LC_ASSERT(sizeBound > 0);
+
+    memset(queueHead, 0, sizeof(*queueHead));
+
+    // Round the ring up to a power of 2 so we can mask the indexes
+    capacity = 1;
+    while (capacity < (unsigned int)sizeBound) {
+        capacity <<= 1;
+    }
+
+    queueHead->slots = malloc(capacity * sizeof(*queueHead->slots));
+    if (queueHead->slots == NULL) {
+        return -1;
+    }
+
+    err = PltCreateMutex(&queueHead->mutex);
+    if (err != 0) {
+        free(queueHead->slots);
+        return err;
+    }
+
+    err = PltCreateConditionVariable(&queueHead->cond, &queueHead->mutex);
+    if (err != 0) {
+        PltDeleteMutex(&queueHead->mutex);
+        free(queueHead->slots);
+        return err;
+    }
+
+    queueHead->mask = capacity - 1;
+    queueHead->sizeBound = sizeBound;
+
+    return 0;
+}
+
+// Flush the queue
+PLINKED_BLOCKING_QUEUE_ENTRY RqFlushQueueItems(PRING_QUEUE queueHead) {
+    PLINKED_BLOCKING_QUEUE_ENTRY head = NULL;
+    PLINKED_BLOCKING_QUEUE_ENTRY tail = NULL;
+    PLINKED_BLOCKING_QUEUE_ENTRY entry;
+
+    // Claim each entry individually, since a consumer may be racing with us
+    while (dequeueEntry(queueHead, &entry)) {
+        entry->flink = NULL;
+        entry->blink = tail;
+
+        if (tail == NULL) {
+            head = entry;
+        }
+        else {
+            tail->flink = entry;
+        }
+        tail = entry;
+    }
+
+    return head;
+}
+
+// Destroy the ring queue and associated mutex and condition variable
+PLINKED_BLOCKING_QUEUE_ENTRY RqDestroyRingQueue(PRING_QUEUE queueHead) {
+    PLINKED_BLOCKING_QUEUE_ENTRY head;
+
+    LC_ASSERT(queueHead->shutdown || queueHead->draining || queueHead->lifetimeSize == 0);
+
+    head = RqFlushQueueItems(queueHead);
+
+    PltDeleteMutex(&queueHead->mutex);
+    PltDeleteConditionVariable(&queueHead->cond);
+    free(queueHead->slots);
+    queueHead->slots = NULL;
+
+    return head;
+}
+
+void RqSignalQueueShutdown(PRING_QUEUE queueHead) {
+    PltAtomicStore(&queueHead->shutdown, 1);
+    wakeWaiters(queueHead);
+}
+
+void RqSignalQueueDrain(PRING_QUEUE queueHead) {
+    PltAtomicStore(&queueHead->draining, 1);
+    wakeWaiters(queueHead);
+}
+
+void RqSignalQueueUserWake(PRING_QUEUE queueHead) {
+    PltAtomicStore(&queueHead->pendingUserWake, 1);
+    wakeWaiters(queueHead);
+}
+
+int RqGetItemCount(PRING_QUEUE queueHead) {
+    unsigned int head = (unsigned int)PltAtomicLoad(&queueHead->head);
+    unsigned int tail = (unsigned int)PltAtomicLoad(&queueHead->tail);
+
+    return (int)(tail - head);
+}
+
+// Returns the most items that were queued at once since the last call
+int RqGetPeakItemCount(PRING_QUEUE queueHead) {
+    return PltAtomicExchange(&queueHead->peakCount, RqGetItemCount(queueHead));
+}
+
+// This must only be called by the producer thread
+int RqOfferQueueItem(PRING_QUEUE queueHead, void* data, PLINKED_BLOCKING_QUEUE_ENTRY entry) {
+    unsigned int head, tail;
+
+    if (PltAtomicLoad(&queueHead->shutdown) || PltAtomicLoad(&queueHead->draining)) {
+        return LBQ_INTERRUPTED;
+    }
+
+    // Consumers can only shrink the queue, so this check can't be invalidated
+    head = (unsigned int)PltAtomicLoad(&queueHead->head);
+    tail = (unsigned int)queueHead->tail;
+    if (tail - head >= (unsigned int)queueHead->sizeBound) {
+        return LBQ_BOUND_EXCEEDED;
+    }
+
+    entry->flink = NULL;
+    entry->blink = NULL;
+    entry->data = data;
+
+    // Publish the entry
+    queueHead->slots[tail & queueHead->mask] = entry;
+    PltAtomicStore(&queueHead->tail, (int)(tail + 1));
+
+    queueHead->lifetimeSize++;
+
+    // A reset by RqGetPeakItemCount() may race with this, but either
+    // way the peak ends up as a depth the queue actually reached.
+    if ((int)(tail + 1 - head) > PltAtomicLoad(&queueHead->peakCount)) {
+        PltAtomicStore(&queueHead->peakCount, (int)(tail + 1 - head));
+    }
+
+    // Only take the lock when transitioning from empty -> non-empty with
+    // a consumer blocked on the queue. Otherwise there's nobody to wake.
+    if (PltAtomicLoad(&queueHead->waiters) != 0) {
+        wakeWaiters(queueHead);
+    }
+
+    return LBQ_SUCCESS;
+}
+
+// This must be synchronized with RqFlushQueueItems by the caller
+int RqPeekQueueElement(PRING_QUEUE queueHead, void** data) {
+    unsigned int head, tail;
+
+    if (PltAtomicLoad(&queueHead->shutdown)) {
+        return LBQ_INTERRUPTED;
+    }
+
+    head = (unsigned int)PltAtomicLoad(&queueHead->head);
+    tail = (unsigned int)PltAtomicLoad(&queueHead->tail);
+    if (head == tail) {
+        return PltAtomicLoad(&queueHead->draining) ? LBQ_INTERRUPTED : LBQ_NO_ELEMENT;
+    }
+
+    *data = queueHead->slots[head & queueHead->mask]->data;
+
+    return LBQ_SUCCESS;
+}
+
+int RqPollQueueElement(PRING_QUEUE queueHead, void** data) {
+    PLINKED_BLOCKING_QUEUE_ENTRY entry;
+
+    if (PltAtomicLoad(&queueHead->shutdown)) {
+        return LBQ_INTERRUPTED;
+    }
+
+    if (!dequeueEntry(queueHead, &entry)) {
+        return PltAtomicLoad(&queueHead->draining) ? LBQ_INTERRUPTED : LBQ_NO_ELEMENT;
+    }
+
+    *data = entry->data;
+
+    return LBQ_SUCCESS;
+}
+
+// A negative timeout waits indefinitely. Otherwise, this blocks at most once
+// and returns LBQ_NO_ELEMENT if nothing arrived before the timeout expired.
+static int waitForQueueElement(PRING_QUEUE queueHead, void** data, int timeoutMs) {
+    PLINKED_BLOCKING_QUEUE_ENTRY entry;
+    bool waited = false;
+
+    for (;;) {
+        // If we're shutting down, abort immediately, even if there's data available
+        if (PltAtomicLoad(&queueHead->shutdown)) {
+            return LBQ_INTERRUPTED;
+        }
+
+        // If this is a user requested wake, process it now
+        if (PltAtomicExchange(&queueHead->pendingUserWake, 0)) {
+            return LBQ_USER_WAKE;
+        }
+
+        if (dequeueEntry(queueHead, &entry)) {
+            *data = entry->data;
+            return LBQ_SUCCESS;
+        }
+
+        // If we're draining, only abort if we have no data available
+        if (PltAtomicLoad(&queueHead->draining)) {
+            return LBQ_INTERRUPTED;
+        }
+
+        if (waited && timeoutMs >= 0) {
+            return LBQ_NO_ELEMENT;
+        }
+
+        // Wait for a waking condition: either data available or rundown.
+        // The producer checks the waiter count after publishing an entry,
+        // so we must register ourselves before checking the queue again.
+        PltLockMutex(&queueHead->mutex);
+        PltAtomicStore(&queueHead->waiters, PltAtomicLoad(&queueHead->waiters) + 1);
+        if (RqGetItemCount(queueHead) == 0 &&
+                !PltAtomicLoad(&queueHead->shutdown) &&
+                !PltAtomicLoad(&queueHead->draining) &&
+                !PltAtomicLoad(&queueHead->pendingUserWake)) {
+            if (timeoutMs >= 0) {
+                PltWaitForConditionVariableTimeout(&queueHead->cond, &queueHead->mutex, timeoutMs);
+            }
+            else {
+                PltWaitForConditionVariable(&queueHead->cond, &queueHead->mutex);
+            }
+        }
+        PltAtomicStore(&queueHead->waiters, PltAtomicLoad(&queueHead->waiters) - 1);
+        PltUnlockMutex(&queueHead->mutex);
+
+        waited = true;
+    }
+}
+
+int RqWaitForQueueElement(PRING_QUEUE queueHead, void** data) {
+    return waitForQueueElement(queueHead, data, -1);
+}
+
+int RqWaitForQueueElementTimeout(PRING_QUEUE queueHead, void** data, int timeoutMs) {
+    LC_ASSERT(timeoutMs >= 0);
+    return waitForQueueElement(queueHead, data, timeoutMs);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "LinkedBlockingQueue.h"
+
+// A bounded queue with the same semantics and LBQ_* return values as the
+// linked blocking queue, backed by a ring of entry pointers. Offers must come
+// from a single producer thread, but any thread may poll, peek, or flush.
+// Offers and polls never take the mutex. It is only used to block a consumer
+// waiting on an empty queue and the producer only touches it when a consumer
+// is actually waiting.
+
+#define RQ_CACHE_LINE_SIZE 64
+
+typedef struct _RING_QUEUE {
+    PLINKED_BLOCKING_QUEUE_ENTRY* slots;
+    unsigned int mask;
+    int sizeBound;
+    int lifetimeSize;
+
+    PLT_MUTEX mutex;
+    PLT_COND cond;
+    PLT_ATOMIC_INT waiters;
+    PLT_ATOMIC_INT shutdown;
+    PLT_ATOMIC_INT draining;
+    PLT_ATOMIC_INT pendingUserWake;
+    PLT_ATOMIC_INT peakCount;
+
+    // Advanced by consumers
+    char headPadding[RQ_CACHE_LINE_SIZE];
+    PLT_ATOMIC_INT head;
+
+    // Advanced by the producer
+    char tailPadding[RQ_CACHE_LINE_SIZE - sizeof(PLT_ATOMIC_INT)];
+    PLT_ATOMIC_INT tail;
+} RING_QUEUE, *PRING_QUEUE;
+
+int RqInitializeRingQueue(PRING_QUEUE queueHead, int sizeBound);
+int RqOfferQueueItem(PRING_QUEUE queueHead, void* data, PLINKED_BLOCKING_QUEUE_ENTRY entry);
+int RqWaitForQueueElement(PRING_QUEUE queueHead, void** data);
+int RqWaitForQueueElementTimeout(PRING_QUEUE queueHead, void** data, int timeoutMs);
+int RqPollQueueElement(PRING_QUEUE queueHead, void** data);
+int RqPeekQueueElement(PRING_QUEUE queueHead, void** data);
+PLINKED_BLOCKING_QUEUE_ENTRY RqDestroyRingQueue(PRING_QUEUE queueHead);
+PLINKED_BLOCKING_QUEUE_ENTRY RqFlushQueueItems(PRING_QUEUE queueHead);
+void RqSignalQueueShutdown(PRING_QUEUE queueHead);
+void RqSignalQueueDrain(PRING_QUEUE queueHead);
+void RqSignalQueueUserWake(PRING_QUEUE queueHead);
+int RqGetItemCount(PRING_QUEUE queueHead);
+int RqGetPeakItemCount(PRING_QUEUE queueHead);
@@ -189,6 +189,11 @@ void RtpaCleanupQueue(PRTP_AUDIO_QUEUE queue) {
 
     LC_ASSERT(queue->freeBlockCount == 0);
 
+    if (queue->rs != NULL && queue->rs->decode_cache_hits + queue->rs->decode_cache_misses != 0) {
+        Limelog("Audio FEC cache: decode matrices %u hits / %u misses\n",
+                queue->rs->decode_cache_hits, queue->rs->decode_cache_misses);
+    }
+
     reed_solomon_release(queue->rs);
     queue->rs = NULL;
 }
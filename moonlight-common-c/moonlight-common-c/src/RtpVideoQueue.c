@@ -16,13 +16,15 @@ void RtpvInitializeQueue(PRTP_VIDEO_QUEUE queue) {
     queue->currentFrameNumber = UINT16_MAX;
 
     queue->multiFecCapable = APP_VERSION_AT_LEAST(7, 1, 431);
+
+    reed_solomon_cache_init(&queue->rsCache);
 }
 
 static void purgeListEntries(PRTPV_QUEUE_LIST list) {
     while (list->head != NULL) {
         PRTPV_QUEUE_ENTRY entry = list->head;
         list->head = entry->next;
-        free(entry->packet);
+        freeVideoPacketBuffer(entry->packet);
     }
 
     list->tail = NULL;
@@ -32,6 +34,14 @@ static void purgeListEntries(PRTPV_QUEUE_LIST list) {
 void RtpvCleanupQueue(PRTP_VIDEO_QUEUE queue) {
     purgeListEntries(&queue->pendingFecBlockList);
     purgeListEntries(&queue->completedFecBlockList);
+
+    reed_solomon_cache_release(&queue->rsCache);
+
+    if (queue->rsCache.hits + queue->rsCache.misses != 0) {
+        Limelog("Video FEC cache: RS encoders %u hits / %u misses, decode matrices %u hits / %u misses\n",
+                queue->rsCache.hits, queue->rsCache.misses,
+                queue->rsCache.decode_cache_hits, queue->rsCache.decode_cache_misses);
+    }
 }
 
 static void insertEntryIntoList(PRTPV_QUEUE_LIST list, PRTPV_QUEUE_ENTRY entry) {
@@ -126,7 +136,7 @@ static bool queuePacket(PRTP_VIDEO_QUEUE queue, PRTPV_QUEUE_ENTRY newEntry, PRTP
     Limelog("FEC recovery returned corrupt packet %d" \
             " (frame %d)", rtpPacket->sequenceNumber, \
             queue->currentFrameNumber);               \
-    free(packets[i]);                                 \
+    freeVideoPacketBuffer(packets[i]);                                 \
     continue
 
 // Returns 0 if the frame is completely constructed
@@ -172,10 +182,11 @@ static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
         goto cleanup;
     }
     
-    rs = reed_solomon_new(queue->bufferDataPackets, queue->bufferParityPackets);
+    // The RS object is owned by the cache and reused for later FEC blocks with the same shape
+    rs = reed_solomon_cache_get(&queue->rsCache, queue->bufferDataPackets, queue->bufferParityPackets);
     
-    // This could happen in an OOM condition, but it could also mean the FEC data
-    // that we fed to reed_solomon_new() is bogus, so we'll assert to get a better look.
+    // This could happen in an OOM condition, but it could also mean the shard counts
+    // we asked the cache for are bogus, so we'll assert to get a better look.
     LC_ASSERT(rs != NULL);
     if (rs == NULL) {
         ret = -3;
@@ -185,7 +196,6 @@ static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
     memset(marks, 1, sizeof(char) * (totalPackets));
     
     int receiveSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
-    int packetBufferSize = receiveSize + sizeof(RTPV_QUEUE_ENTRY);
 
 #ifdef FEC_VALIDATION_MODE
     // Choose a packet to drop
@@ -223,7 +233,7 @@ static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
     unsigned int i;
     for (i = 0; i < totalPackets; i++) {
         if (marks[i]) {
-            packets[i] = malloc(packetBufferSize);
+            packets[i] = allocateVideoPacketBuffer();
             if (packets[i] == NULL) {
                 ret = -4;
                 goto cleanup_packets;
@@ -234,8 +244,11 @@ static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
     ret = reed_solomon_reconstruct(rs, packets, marks, totalPackets, receiveSize);
     
     // We should always provide enough parity to recover the missing data successfully.
-    // If this fails, something is probably wrong with our FEC state.
-    LC_ASSERT(ret == 0);
+    // If this fails, something is probably wrong with our FEC state, so don't submit
+    // the unrecovered shards. The frame will be dropped once the next one arrives.
+    if (ret != 0) {
+        Limelog("Unable to recover frame %d from FEC data: %d\n", queue->currentFrameNumber, ret);
+    }
 
 #ifdef FEC_VERBOSE
     if (queue->bufferDataPackets != queue->receivedBufferDataPackets) {
@@ -314,7 +327,7 @@ cleanup_packets:
 
                     // This drop was fake, so we don't want to actually submit it to the depacketizer.
                     // It will get confused because it's already seen this packet before.
-                    free(packets[i]);
+                    freeVideoPacketBuffer(packets[i]);
                     continue;
                 }
 #endif
@@ -345,14 +358,12 @@ cleanup_packets:
                 LC_ASSERT(isBefore16(rtpPacket->sequenceNumber, queue->bufferFirstParitySequenceNumber));
                 queuePacket(queue, queueEntry, rtpPacket, StreamConfig.packetSize + dataOffset, false);
             } else if (packets[i] != NULL) {
-                free(packets[i]);
+                freeVideoPacketBuffer(packets[i]);
             }
         }
     }
 
 cleanup:
-    reed_solomon_release(rs);
-
     if (packets != NULL)
         free(packets);
 
@@ -385,7 +396,7 @@ static void stageCompleteFecBlock(PRTP_VIDEO_QUEUE queue) {
                 removeEntryFromList(&queue->pendingFecBlockList, parityEntry);
 
                 // Free the entry and packet
-                free(parityEntry->packet);
+                freeVideoPacketBuffer(parityEntry->packet);
 
                 continue;
             }
@@ -398,8 +409,8 @@ static void stageCompleteFecBlock(PRTP_VIDEO_QUEUE queue) {
                 // and use the first packet's receive time for all packets. This ends up
                 // actually being better for the measurements that the depacketizer does,
                 // since it properly handles out of order packets.
-                LC_ASSERT(queue->bufferFirstRecvTimeMs != 0);
-                entry->receiveTimeMs = queue->bufferFirstRecvTimeMs;
+                LC_ASSERT(queue->bufferFirstRecvTimeUs != 0);
+                entry->receiveTimeUs = queue->bufferFirstRecvTimeUs;
 
                 // Move this packet to the completed FEC block list
                 insertEntryIntoList(&queue->completedFecBlockList, entry);
@@ -424,6 +435,9 @@ static void stageCompleteFecBlock(PRTP_VIDEO_QUEUE queue) {
 }
 
 static void submitCompletedFrame(PRTP_VIDEO_QUEUE queue) {
+    // All packets of the frame are here (or were recovered by FEC) now
+    uint64_t frameCompleteTimeUs = PltGetMicroseconds();
+
     while (queue->completedFecBlockList.count > 0) {
         PRTPV_QUEUE_ENTRY entry = queue->completedFecBlockList.head;
 
@@ -432,11 +446,18 @@ static void submitCompletedFrame(PRTP_VIDEO_QUEUE queue) {
 
         // Submit this packet for decoding. It will own freeing the entry now.
         removeEntryFromList(&queue->completedFecBlockList, entry);
-        queueRtpPacket(entry);
+        queueRtpPacket(entry, frameCompleteTimeUs);
     }
 }
 
-int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry) {
+// Returns the number of packets held until their frame is complete
+int RtpvGetQueuedPacketCount(PRTP_VIDEO_QUEUE queue) {
+    return (int)(queue->pendingFecBlockList.count + queue->completedFecBlockList.count);
+}
+
+// receiveTimeUs is when the packet arrived from the network, which may be earlier
+// than now if it waited for the depacketizer thread.
+int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry, uint64_t receiveTimeUs) {
     if (isBefore16(packet->sequenceNumber, queue->nextContiguousSequenceNumber)) {
         // Reject packets behind our current buffer window
         return RTPF_RET_REJECTED;
@@ -546,7 +567,7 @@ int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_
         // being able to reconstruct a full frame from it.
         connectionSawFrame(queue->currentFrameNumber);
         
-        queue->bufferFirstRecvTimeMs = PltGetMillis();
+        queue->bufferFirstRecvTimeUs = receiveTimeUs;
         queue->bufferLowestSequenceNumber = U16(packet->sequenceNumber - fecIndex);
         queue->nextContiguousSequenceNumber = queue->bufferLowestSequenceNumber;
         queue->receivedBufferDataPackets = 0;
@@ -2,11 +2,13 @@
 
 #include "Video.h"
 
+#include "rs.h"
+
 typedef struct _RTPV_QUEUE_ENTRY {
     struct _RTPV_QUEUE_ENTRY* next;
     struct _RTPV_QUEUE_ENTRY* prev;
     PRTP_PACKET packet;
-    uint64_t receiveTimeMs;
+    uint64_t receiveTimeUs;
     uint32_t presentationTimeMs;
     int length;
     bool isParity;
@@ -22,7 +24,7 @@ typedef struct _RTP_VIDEO_QUEUE {
     RTPV_QUEUE_LIST pendingFecBlockList;
     RTPV_QUEUE_LIST completedFecBlockList;
 
-    uint64_t bufferFirstRecvTimeMs;
+    uint64_t bufferFirstRecvTimeUs;
     uint32_t bufferLowestSequenceNumber;
     uint32_t bufferHighestSequenceNumber;
     uint32_t bufferFirstParitySequenceNumber;
@@ -37,6 +39,9 @@ typedef struct _RTP_VIDEO_QUEUE {
     bool multiFecCapable;
     uint8_t multiFecCurrentBlockNumber;
     uint8_t multiFecLastBlockNumber;
+
+    // RS encoders (and their inverted decode matrices) for recently seen FEC block shapes
+    reed_solomon_cache rsCache;
 } RTP_VIDEO_QUEUE, *PRTP_VIDEO_QUEUE;
 
 #define RTPF_RET_QUEUED    0
@@ -44,5 +49,6 @@ typedef struct _RTP_VIDEO_QUEUE {
 
 void RtpvInitializeQueue(PRTP_VIDEO_QUEUE queue);
 void RtpvCleanupQueue(PRTP_VIDEO_QUEUE queue);
-int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry);
+int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry, uint64_t receiveTimeUs);
+int RtpvGetQueuedPacketCount(PRTP_VIDEO_QUEUE queue);
 void RtpvSubmitQueuedPackets(PRTP_VIDEO_QUEUE queue);
@@ -0,0 +1,206 @@
+#include "Limelight-internal.h"
+
+// The x86 scanners are selected at runtime based on CPUID, so they are compiled
+// with per-function target attributes rather than requiring -mavx2 for the whole file.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SC_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SC_TARGET(x)
+#else
+#define SC_TARGET(x) __attribute__((target(x)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define SC_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+typedef int (*ScScanner)(const char* data, int length);
+
+static int findStartCodeScalar(const char* data, int length) {
+    const uint8_t* p = (const uint8_t*)data;
+    int i = 0;
+
+    while (i + 2 < length) {
+        // A sequence starting at i, i + 1, or i + 2 all need p[i + 2] to be 0 or 1
+        if (p[i + 2] > 1) {
+            i += 3;
+        }
+        else if (p[i] == 0 && p[i + 1] == 0) {
+            return i;
+        }
+        else {
+            i++;
+        }
+    }
+
+    return length;
+}
+
+#ifdef SC_SIMD_X86
+static int countTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Each lane i is checked for 00 00 0x (x <= 1) using loads offset by 0, 1, and 2 bytes
+SC_TARGET("sse2")
+static int findStartCodeSse2(const char* data, int length) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i notOne = _mm_set1_epi8((char)0xFE);
+    int i;
+
+    for (i = 0; i + 2 + 16 <= length; i += 16) {
+        __m128i b0 = _mm_loadu_si128((const __m128i*)&data[i]);
+        __m128i b1 = _mm_loadu_si128((const __m128i*)&data[i + 1]);
+        __m128i b2 = _mm_loadu_si128((const __m128i*)&data[i + 2]);
+        __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero),
+                                                    _mm_cmpeq_epi8(b1, zero)),
+                                      _mm_cmpeq_epi8(_mm_and_si128(b2, notOne), zero));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(match);
+
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+
+    return i + findStartCodeScalar(&data[i], length - i);
+}
+
+SC_TARGET("avx2")
+static int findStartCodeAvx2(const char* data, int length) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i notOne = _mm256_set1_epi8((char)0xFE);
+    int i;
+
+    for (i = 0; i + 2 + 32 <= length; i += 32) {
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)&data[i]);
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)&data[i + 1]);
+        __m256i b2 = _mm256_loadu_si256((const __m256i*)&data[i + 2]);
+        __m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero),
+                                                          _mm256_cmpeq_epi8(b1, zero)),
+                                         _mm256_cmpeq_epi8(_mm256_and_si256(b2, notOne), zero));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(match);
+
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+
+    return i + findStartCodeScalar(&data[i], length - i);
+}
+
+#ifdef _MSC_VER
+static bool cpuHasSse2(void) {
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+}
+
+static bool cpuHasAvx2(void) {
+    int info[4];
+
+    // AVX2 also requires the OS to save the YMM state (OSXSAVE + XCR0)
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+#else
+static bool cpuHasSse2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+static bool cpuHasAvx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif
+
+#ifdef SC_SIMD_NEON
+static int findStartCodeNeon(const char* data, int length) {
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t notOne = vdupq_n_u8(0xFE);
+    int i;
+
+    for (i = 0; i + 2 + 16 <= length; i += 16) {
+        uint8x16_t b0 = vld1q_u8(&p[i]);
+        uint8x16_t b1 = vld1q_u8(&p[i + 1]);
+        uint8x16_t b2 = vld1q_u8(&p[i + 2]);
+        uint8x16_t match = vandq_u8(vandq_u8(vceqq_u8(b0, zero), vceqq_u8(b1, zero)),
+                                    vceqq_u8(vandq_u8(b2, notOne), zero));
+        uint64x2_t match64 = vreinterpretq_u64_u8(match);
+
+        // NEON has no movemask, so let the scalar scanner find the exact
+        // position once we know this block contains a match.
+        if ((vgetq_lane_u64(match64, 0) | vgetq_lane_u64(match64, 1)) != 0) {
+            break;
+        }
+    }
+
+    return i + findStartCodeScalar(&data[i], length - i);
+}
+#endif
+
+// Selected by ScInitializeScanner()
+static ScScanner scanner = findStartCodeScalar;
+
+#ifdef LC_DEBUG
+// Check that the selected scanner agrees with the scalar one for start
+// codes at every position within a vector, including the unaligned tail.
+static void validateScanner(void) {
+    char buffer[200];
+    int offset, position, length;
+
+    memset(buffer, 0x5A, sizeof(buffer));
+    for (offset = 0; offset < 3; offset++) {
+        for (position = offset; position < (int)sizeof(buffer) - 3; position++) {
+            memcpy(&buffer[position], "\x00\x00\x01", 3);
+            for (length = position - offset; length <= (int)sizeof(buffer) - offset; length += 7) {
+                LC_ASSERT(scanner(&buffer[offset], length) == findStartCodeScalar(&buffer[offset], length));
+            }
+
+            // Leave a lone zero behind as a near miss for the next position
+            memcpy(&buffer[position], "\x5A\x00\x5A", 3);
+        }
+    }
+}
+#endif
+
+void ScInitializeScanner(void) {
+#if defined(SC_SIMD_X86)
+    if (cpuHasAvx2()) {
+        scanner = findStartCodeAvx2;
+    }
+    else if (cpuHasSse2()) {
+        scanner = findStartCodeSse2;
+    }
+#elif defined(SC_SIMD_NEON)
+    scanner = findStartCodeNeon;
+#endif
+
+#ifdef LC_DEBUG
+    validateScanner();
+#endif
+}
+
+int ScFindStartCode(const char* data, int length) {
+    return scanner(data, length);
+}
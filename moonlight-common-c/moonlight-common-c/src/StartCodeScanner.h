@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Platform.h"
+
+// Selects the fastest scanner for this CPU. Must be called before ScFindStartCode().
+void ScInitializeScanner(void);
+
+// Returns the offset of the first "00 00 00" or "00 00 01" sequence in the buffer,
+// which are the only places an Annex B start sequence or padding can begin. If no
+// such sequence exists, length is returned.
+int ScFindStartCode(const char* data, int length);
@@ -2,9 +2,18 @@
 
 #include "LinkedBlockingQueue.h"
 
+// Maximum number of buffer list entries in a contiguous frame buffer. Only
+// codec configuration NALUs need their own entries, so this is plenty. A frame
+// that needs more is dropped and an IDR frame is requested.
+#define MAX_FRAME_BUFFER_ENTRIES 8
+
 typedef struct _QUEUED_DECODE_UNIT {
     DECODE_UNIT decodeUnit;
     LINKED_BLOCKING_QUEUE_ENTRY entry;
+
+    // Only used with CAPABILITY_CONTIGUOUS_FRAME_BUFFER
+    char* frameBuffer;
+    LENTRY frameBufferEntries[MAX_FRAME_BUFFER_ENTRIES];
 } QUEUED_DECODE_UNIT, *PQUEUED_DECODE_UNIT;
 
 #pragma pack(push, 1)
@@ -4,6 +4,17 @@ static PLENTRY nalChainHead;
 static PLENTRY nalChainTail;
 static int nalChainDataLength;
 
+// Frame assembly state for CAPABILITY_CONTIGUOUS_FRAME_BUFFER. The NAL chain
+// is built from frameBufferEntries, and the entries' data pointers are only
+// filled in when the frame is reassembled since the buffer may be reallocated.
+static char* frameBuffer;
+static int frameBufferSize;
+static int frameBufferSizeHint;
+static LENTRY frameBufferEntries[MAX_FRAME_BUFFER_ENTRIES];
+static int frameBufferEntryCount;
+
+#define FRAME_BUFFER_MIN_SIZE (32 * 1024)
+
 static unsigned int nextFrameNumber;
 static unsigned int startFrameNumber;
 static bool waitingForNextSuccessfulFrame;
@@ -11,7 +22,8 @@ static bool waitingForIdrFrame;
 static unsigned int lastPacketInStream;
 static bool decodingFrame;
 static bool strictIdrFrameWait;
-static uint64_t firstPacketReceiveTime;
+static uint64_t firstPacketReceiveTimeUs;
+static uint64_t frameCompleteTimeUs;
 static unsigned int firstPacketPresentationTime;
 static bool dropStatePending;
 static bool idrFrameProcessed;
@@ -31,6 +43,9 @@ typedef struct _BUFFER_DESC {
 
 typedef struct _LENTRY_INTERNAL {
     LENTRY entry;
+
+    // Either a video packet buffer or a malloc()ed fragment. Both
+    // are released with freeVideoPacketBuffer().
     void* allocPtr;
 } LENTRY_INTERNAL, *PLENTRY_INTERNAL;
 
@@ -50,6 +65,7 @@ typedef struct _LENTRY_INTERNAL {
 // Init
 void initializeVideoDepacketizer(int pktSize) {
     LbqInitializeLinkedBlockingQueue(&decodeUnitQueue, 15);
+    ScInitializeScanner();
 
     nextFrameNumber = 1;
     startFrameNumber = 0;
@@ -57,21 +73,34 @@ void initializeVideoDepacketizer(int pktSize) {
     waitingForIdrFrame = true;
     lastPacketInStream = UINT32_MAX;
     decodingFrame = false;
-    firstPacketReceiveTime = 0;
+    firstPacketReceiveTimeUs = 0;
+    frameCompleteTimeUs = 0;
     firstPacketPresentationTime = 0;
     dropStatePending = false;
     idrFrameProcessed = false;
     strictIdrFrameWait = !isReferenceFrameInvalidationEnabled();
+    frameBufferSizeHint = FRAME_BUFFER_MIN_SIZE;
+    frameBufferEntryCount = 0;
+}
+
+static bool usingContiguousFrameBuffer(void) {
+    return (VideoCallbacks.capabilities & CAPABILITY_CONTIGUOUS_FRAME_BUFFER) != 0;
 }
 
 // Free the NAL chain
 static void cleanupFrameState(void) {
     PLENTRY_INTERNAL lastEntry;
 
+    if (usingContiguousFrameBuffer()) {
+        // The entries are static and the frame buffer is reused for the next frame
+        nalChainHead = NULL;
+        frameBufferEntryCount = 0;
+    }
+
     while (nalChainHead != NULL) {
         lastEntry = (PLENTRY_INTERNAL)nalChainHead;
         nalChainHead = lastEntry->entry.next;
-        free(lastEntry->allocPtr);
+        freeVideoPacketBuffer(lastEntry->allocPtr);
     }
 
     nalChainTail = NULL;
@@ -133,6 +162,10 @@ void stopVideoDepacketizer(void) {
 void destroyVideoDepacketizer(void) {
     freeDecodeUnitList(LbqDestroyLinkedBlockingQueue(&decodeUnitQueue));
     cleanupFrameState();
+
+    free(frameBuffer);
+    frameBuffer = NULL;
+    frameBufferSize = 0;
 }
 
 static bool isSeqFrameStart(PBUFFER_DESC candidate) {
@@ -183,6 +216,15 @@ static bool getSpecialSeq(PBUFFER_DESC current, PBUFFER_DESC candidate) {
     return false;
 }
 
+// Advance the buffer descriptor by at least one byte to the next position where
+// getSpecialSeq() could succeed, or to the end of the buffer if there are none
+static void skipToNextSpecialSeq(PBUFFER_DESC buffer) {
+    int skip = 1 + ScFindStartCode(&buffer->data[buffer->offset + 1], buffer->length - 1);
+
+    buffer->offset += skip;
+    buffer->length -= skip;
+}
+
 bool LiWaitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit) {
     PQUEUED_DECODE_UNIT qdu;
 
@@ -196,6 +238,19 @@ bool LiWaitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* deco
     return true;
 }
 
+bool LiWaitForNextVideoFrameTimeout(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit, int timeoutMs) {
+    PQUEUED_DECODE_UNIT qdu;
+
+    int err = LbqWaitForQueueElementTimeout(&decodeUnitQueue, (void**)&qdu, timeoutMs);
+    if (err != LBQ_SUCCESS) {
+        return false;
+    }
+
+    *frameHandle = qdu;
+    *decodeUnit = &qdu->decodeUnit;
+    return true;
+}
+
 bool LiPollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit) {
     PQUEUED_DECODE_UNIT qdu;
 
@@ -244,10 +299,18 @@ void LiCompleteVideoFrame(VIDEO_FRAME_HANDLE handle, int drStatus) {
         idrFrameProcessed = true;
     }
 
+    if (usingContiguousFrameBuffer()) {
+        // The entries live in the QUEUED_DECODE_UNIT itself. The frame buffer
+        // will be NULL if the renderer detached it.
+        free(qdu->frameBuffer);
+        qdu->frameBuffer = NULL;
+        qdu->decodeUnit.bufferList = NULL;
+    }
+
     while (qdu->decodeUnit.bufferList != NULL) {
         lastEntry = (PLENTRY_INTERNAL)qdu->decodeUnit.bufferList;
         qdu->decodeUnit.bufferList = lastEntry->entry.next;
-        free(lastEntry->allocPtr);
+        freeVideoPacketBuffer(lastEntry->allocPtr);
     }
 
     // We will have stack-allocated entries iff we have a direct-submit decoder
@@ -256,6 +319,19 @@ void LiCompleteVideoFrame(VIDEO_FRAME_HANDLE handle, int drStatus) {
     }
 }
 
+void* LiDetachVideoFrameBuffer(PDECODE_UNIT decodeUnit) {
+    // The decode unit is always the first member of a QUEUED_DECODE_UNIT
+    PQUEUED_DECODE_UNIT qdu = (PQUEUED_DECODE_UNIT)decodeUnit;
+    void* buffer = qdu->frameBuffer;
+
+    qdu->frameBuffer = NULL;
+    return buffer;
+}
+
+void LiFreeVideoFrameBuffer(void* buffer) {
+    free(buffer);
+}
+
 static bool isSeqReferenceFrameStart(PBUFFER_DESC specialSeq) {
     if (NegotiatedVideoFormat & VIDEO_FORMAT_MASK_H264) {
         return H264_NAL_TYPE(specialSeq->data[specialSeq->offset + specialSeq->length]) == 5;
@@ -336,8 +412,7 @@ static void skipToNextNal(PBUFFER_DESC buffer) {
             return;
         }
 
-        buffer->offset++;
-        buffer->length--;
+        skipToNextSpecialSeq(buffer);
     }
 }
 
@@ -375,12 +450,48 @@ static void reassembleFrame(int frameNumber) {
         }
 
         if (qdu != NULL) {
+            if (usingContiguousFrameBuffer()) {
+                char* data = frameBuffer;
+
+                // Point the entries at their data now that the buffer won't move
+                for (int i = 0; i < frameBufferEntryCount; i++) {
+                    qdu->frameBufferEntries[i] = frameBufferEntries[i];
+                    qdu->frameBufferEntries[i].data = data;
+                    qdu->frameBufferEntries[i].next = (i + 1 < frameBufferEntryCount) ?
+                        &qdu->frameBufferEntries[i + 1] : NULL;
+                    data += frameBufferEntries[i].length;
+                }
+
+                // Zero the padding so the decoder can safely overread
+                memset(&frameBuffer[nalChainDataLength], 0, VIDEO_FRAME_BUFFER_PADDING);
+
+                // The decode unit owns the buffer now, so the next frame needs a new one.
+                // Size it for this frame to avoid reallocating as packets arrive.
+                frameBufferSizeHint = nalChainDataLength + nalChainDataLength / 4 + VIDEO_FRAME_BUFFER_PADDING;
+                if (frameBufferSizeHint < FRAME_BUFFER_MIN_SIZE) {
+                    frameBufferSizeHint = FRAME_BUFFER_MIN_SIZE;
+                }
+
+                qdu->frameBuffer = frameBuffer;
+                nalChainHead = qdu->frameBufferEntries;
+                frameBuffer = NULL;
+                frameBufferSize = 0;
+                frameBufferEntryCount = 0;
+            }
+            else {
+                qdu->frameBuffer = NULL;
+            }
+
             qdu->decodeUnit.bufferList = nalChainHead;
             qdu->decodeUnit.fullLength = nalChainDataLength;
             qdu->decodeUnit.frameNumber = frameNumber;
-            qdu->decodeUnit.receiveTimeMs = firstPacketReceiveTime;
+            qdu->decodeUnit.receiveTimeUs = firstPacketReceiveTimeUs;
+            qdu->decodeUnit.frameCompleteTimeUs = frameCompleteTimeUs;
+            qdu->decodeUnit.enqueueTimeUs = PltGetMicroseconds();
+            qdu->decodeUnit.receiveTimeMs = qdu->decodeUnit.receiveTimeUs / 1000;
+            qdu->decodeUnit.frameCompleteTimeMs = qdu->decodeUnit.frameCompleteTimeUs / 1000;
+            qdu->decodeUnit.enqueueTimeMs = qdu->decodeUnit.enqueueTimeUs / 1000;
             qdu->decodeUnit.presentationTimeMs = firstPacketPresentationTime;
-            qdu->decodeUnit.enqueueTimeMs = LiGetMillis();
 
             // IDR frames will have leading CSD buffers
             if (nalChainHead->bufferType != BUFFER_TYPE_PICDATA) {
@@ -398,8 +509,13 @@ static void reassembleFrame(int frameNumber) {
                     Limelog("Video decode unit queue overflow\n");
 
                     // Clear frame state and wait for an IDR
-                    nalChainHead = qdu->decodeUnit.bufferList;
-                    nalChainDataLength = qdu->decodeUnit.fullLength;
+                    if (usingContiguousFrameBuffer()) {
+                        free(qdu->frameBuffer);
+                    }
+                    else {
+                        nalChainHead = qdu->decodeUnit.bufferList;
+                        nalChainDataLength = qdu->decodeUnit.fullLength;
+                    }
                     dropFrameState();
 
                     // Free the DU
@@ -472,11 +588,79 @@ static int getBufferFlags(char* data, int length) {
     }
 }
 
+// Copy a fragment into the contiguous frame buffer. Consecutive fragments of the
+// same buffer type share an entry, so picture data ends up in a single entry.
+// Returns 0 on success or -1 if the frame buffer couldn't be grown or the frame
+// needs more entries than we have.
+static int appendFrameBuffer(char* data, int length) {
+    int bufferType = getBufferFlags(data, length);
+    int requiredSize = nalChainDataLength + length + VIDEO_FRAME_BUFFER_PADDING;
+    bool newEntry = frameBufferEntryCount == 0 ||
+        frameBufferEntries[frameBufferEntryCount - 1].bufferType != bufferType;
+
+    // Merging this fragment into the previous entry would mislabel it
+    if (newEntry && frameBufferEntryCount == MAX_FRAME_BUFFER_ENTRIES) {
+        Limelog("Frame needs more than %d buffer entries\n", MAX_FRAME_BUFFER_ENTRIES);
+        return -1;
+    }
+
+    if (requiredSize > frameBufferSize) {
+        int newSize = frameBufferSize != 0 ? frameBufferSize : frameBufferSizeHint;
+        char* newBuffer;
+
+        while (newSize < requiredSize) {
+            newSize *= 2;
+        }
+
+        newBuffer = (char*)realloc(frameBuffer, newSize);
+        if (newBuffer == NULL) {
+            Limelog("Failed to grow frame buffer to %d bytes\n", newSize);
+            return -1;
+        }
+
+        frameBuffer = newBuffer;
+        frameBufferSize = newSize;
+    }
+
+    memcpy(&frameBuffer[nalChainDataLength], data, length);
+    nalChainDataLength += length;
+
+    if (!newEntry) {
+        frameBufferEntries[frameBufferEntryCount - 1].length += length;
+    }
+    else {
+        PLENTRY entry = &frameBufferEntries[frameBufferEntryCount++];
+
+        entry->next = NULL;
+        entry->data = NULL;
+        entry->length = length;
+        entry->bufferType = bufferType;
+
+        if (nalChainTail == NULL) {
+            LC_ASSERT(nalChainHead == NULL);
+            nalChainHead = nalChainTail = entry;
+        }
+        else {
+            LC_ASSERT(nalChainHead != NULL);
+            nalChainTail->next = entry;
+            nalChainTail = entry;
+        }
+    }
+
+    return 0;
+}
+
 // As an optimization, we can cast the existing packet buffer to a PLENTRY and avoid
 // a malloc() and a memcpy() of the packet data.
-static void queueFragment(PLENTRY_INTERNAL* existingEntry, char* data, int offset, int length) {
+// Returns 0 on success or -1 if the fragment couldn't be added to the frame.
+static int queueFragment(PLENTRY_INTERNAL* existingEntry, char* data, int offset, int length) {
     PLENTRY_INTERNAL entry;
 
+    if (usingContiguousFrameBuffer()) {
+        // The caller will return the packet buffer to the pool once we've copied it
+        return appendFrameBuffer(&data[offset], length);
+    }
+
     if (existingEntry == NULL || *existingEntry == NULL) {
         entry = (PLENTRY_INTERNAL)malloc(sizeof(*entry) + length);
     }
@@ -520,10 +704,13 @@ static void queueFragment(PLENTRY_INTERNAL* existingEntry, char* data, int offse
             nalChainTail = nalChainTail->next;
         }
     }
+
+    return 0;
 }
 
 // Process an RTP Payload using the slow path that handles multiple NALUs per packet
-static void processRtpPayloadSlow(PBUFFER_DESC currentPos, PLENTRY_INTERNAL* existingEntry) {
+// Returns 0 on success or -1 if a fragment couldn't be added to the frame.
+static int processRtpPayloadSlow(PBUFFER_DESC currentPos, PLENTRY_INTERNAL* existingEntry) {
     BUFFER_DESC specialSeq;
     bool decodingVideo = false;
 
@@ -587,18 +774,21 @@ static void processRtpPayloadSlow(PBUFFER_DESC currentPos, PLENTRY_INTERNAL* exi
                 }
             }
 
-            // This byte is part of the NAL data
-            currentPos->offset++;
-            currentPos->length--;
+            // Everything up to the next special sequence is part of the NAL data
+            skipToNextSpecialSeq(currentPos);
         }
 
         if (decodingVideo) {
             // To minimize copies, we'll use allocate for SPS, PPS, and VPS to allow
             // us to reuse the packet buffer for the picture data in the I-frame.
-            queueFragment(containsPicData ? existingEntry : NULL,
-                          currentPos->data, start, currentPos->offset - start);
+            if (queueFragment(containsPicData ? existingEntry : NULL,
+                              currentPos->data, start, currentPos->offset - start) != 0) {
+                return -1;
+            }
         }
     }
+
+    return 0;
 }
 
 // Dumps the decode unit queue and ensures the next frame submitted to the decoder will be
@@ -632,7 +822,7 @@ static int isFirstPacket(uint8_t flags, uint8_t fecBlockNumber) {
 // Process an RTP Payload
 // The caller will free *existingEntry unless we NULL it
 static void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length,
-                       uint64_t receiveTimeMs, unsigned int presentationTimeMs,
+                       uint64_t receiveTimeUs, unsigned int presentationTimeMs,
                        PLENTRY_INTERNAL* existingEntry) {
     BUFFER_DESC currentPos;
     uint32_t frameIndex;
@@ -641,6 +831,7 @@ static void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length,
     uint32_t streamPacketIndex;
     uint8_t fecCurrentBlockNumber;
     uint8_t fecLastBlockNumber;
+    int err;
 
     // Mask the top 8 bits from the SPI
     videoPacket->streamPacketIndex >>= 8;
@@ -708,7 +899,7 @@ static void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length,
 
         // We're now decoding a frame
         decodingFrame = true;
-        firstPacketReceiveTime = receiveTimeMs;
+        firstPacketReceiveTimeUs = receiveTimeUs;
         firstPacketPresentationTime = presentationTimeMs;
     }
 
@@ -775,11 +966,24 @@ static void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length,
     if (firstPacket && isIdrFrameStart(&currentPos))
     {
         // SPS and PPS prefix is padded between NALs, so we must decode it with the slow path
-        processRtpPayloadSlow(&currentPos, existingEntry);
+        err = processRtpPayloadSlow(&currentPos, existingEntry);
     }
     else
     {
-        queueFragment(existingEntry, currentPos.data, currentPos.offset, currentPos.length);
+        err = queueFragment(existingEntry, currentPos.data, currentPos.offset, currentPos.length);
+    }
+
+    if (err != 0) {
+        // We can't hand a partial frame to the decoder, so drop the rest of
+        // this frame and request an IDR frame to resynchronize.
+        Limelog("Dropping frame %d: unable to assemble it\n", frameIndex);
+        decodingFrame = false;
+        nextFrameNumber = frameIndex + 1;
+        dropFrameState();
+
+        waitingForIdrFrame = true;
+        requestIdrOnDemand();
+        return;
     }
 
     if ((flags & FLAG_EOF) && fecCurrentBlockNumber == fecLastBlockNumber) {
@@ -830,12 +1034,14 @@ static void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length,
 }
 
 // Add an RTP Packet to the queue
-void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntryPtr) {
+void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntryPtr, uint64_t frameCompleteTime) {
     int dataOffset;
     RTPV_QUEUE_ENTRY queueEntry = *queueEntryPtr;
 
     LC_ASSERT(!queueEntry.isParity);
-    LC_ASSERT(queueEntry.receiveTimeMs != 0);
+    LC_ASSERT(queueEntry.receiveTimeUs != 0);
+
+    frameCompleteTimeUs = frameCompleteTime;
 
     dataOffset = sizeof(*queueEntry.packet);
     if (queueEntry.packet->header & FLAG_EXTENSION) {
@@ -851,16 +1057,20 @@ void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntryPtr) {
 
     processRtpPayload((PNV_VIDEO_PACKET)(((char*)queueEntry.packet) + dataOffset),
                       queueEntry.length - dataOffset,
-                      queueEntry.receiveTimeMs,
+                      queueEntry.receiveTimeUs,
                       queueEntry.presentationTimeMs,
                       &existingEntry);
 
     if (existingEntry != NULL) {
         // processRtpPayload didn't want this packet, so just free it
-        free(existingEntry->allocPtr);
+        freeVideoPacketBuffer(existingEntry->allocPtr);
     }
 }
 
 int LiGetPendingVideoFrames(void) {
     return LbqGetItemCount(&decodeUnitQueue);
 }
+
+int getPendingVideoFramesPeak(void) {
+    return LbqGetPeakItemCount(&decodeUnitQueue);
+}
@@ -8,37 +8,132 @@
 #define RTP_RECV_BUFFER (512 * 1024)
 
 static RTP_VIDEO_QUEUE rtpQueue;
+static PACKET_POOL packetPool;
+static PACKET_IMPAIRMENT impairment;
 
 static SOCKET rtpSocket = INVALID_SOCKET;
 static SOCKET firstFrameSocket = INVALID_SOCKET;
 
 static PLT_THREAD udpPingThread;
 static PLT_THREAD receiveThread;
+static PLT_THREAD depacketizerThread;
 static PLT_THREAD decoderThread;
 
+// With pipelining, the receive thread hands packets to the depacketizer
+// thread through this queue. FEC recovery and depacketization happen there.
+static bool pipeliningConfigured;
+static bool pipeliningActive;
+static RING_QUEUE receivedPacketQueue;
+static uint32_t receivedPacketQueueDrops;
+
+// Published by whichever thread adds packets to the RTP queue
+static PLT_ATOMIC_INT rtpQueueDepth;
+static PLT_ATOMIC_INT rtpQueuePeak;
+
+// While a packet waits in receivedPacketQueue, this lives in the space after
+// the packet that the RTP queue later uses for its RTPV_QUEUE_ENTRY.
+typedef struct _RECEIVED_PACKET_ENTRY {
+    LINKED_BLOCKING_QUEUE_ENTRY entry;
+    uint64_t receiveTimeUs;
+    int length;
+} RECEIVED_PACKET_ENTRY, *PRECEIVED_PACKET_ENTRY;
+
 static bool receivedDataFromPeer;
 static uint64_t firstDataTimeMs;
-static bool receivedFullFrame;
+// Set once a key frame has been submitted to the decoder, which happens on the
+// decoder or depacketizer thread, and read by the receive thread
+static PLT_ATOMIC_INT receivedFullFrame;
+
+// Receive batching statistics
+#define RECV_BATCH_HISTOGRAM_BUCKETS 6
+static uint64_t recvBatchCount;
+static uint64_t recvBatchPacketCount;
+static int recvBatchMaxPackets;
+static uint32_t recvBatchHistogram[RECV_BATCH_HISTOGRAM_BUCKETS];
 
 // We can't request an IDR frame until the depacketizer knows
 // that a packet was lost. This timeout bounds the time that
 // the RTP queue will wait for missing/reordered packets.
 #define RTP_QUEUE_DELAY 10
 
+// Bounds on the number of preallocated video packet buffers. The pool is sized
+// to hold roughly PACKET_POOL_FRAMES average frames at the configured bitrate.
+// Allocations beyond the pool capacity fall back to malloc().
+#define PACKET_POOL_FRAMES 16
+#define PACKET_POOL_MIN_BUFFERS 512
+#define PACKET_POOL_MAX_BUFFERS 4096
+
+static int getPacketPoolCapacity(void) {
+    int packetsPerFrame;
+    int capacity;
+
+    if (StreamConfig.fps <= 0 || StreamConfig.packetSize <= 0) {
+        return PACKET_POOL_MIN_BUFFERS;
+    }
+
+    // Bitrate is in Kbps
+    packetsPerFrame = (int)(((int64_t)StreamConfig.bitrate * 1000 / 8 / StreamConfig.fps) / StreamConfig.packetSize) + 1;
+    capacity = packetsPerFrame * PACKET_POOL_FRAMES;
+
+    if (capacity < PACKET_POOL_MIN_BUFFERS) {
+        capacity = PACKET_POOL_MIN_BUFFERS;
+    }
+    else if (capacity > PACKET_POOL_MAX_BUFFERS) {
+        capacity = PACKET_POOL_MAX_BUFFERS;
+    }
+
+    return capacity;
+}
 
 // Initialize the video stream
-void initializeVideoStream(void) {
+int initializeVideoStream(void) {
+    int err;
+
+    err = PoolInitializePacketPool(&packetPool,
+                                   StreamConfig.packetSize + MAX_RTP_HEADER_SIZE + sizeof(RTPV_QUEUE_ENTRY),
+                                   getPacketPoolCapacity());
+    if (err != 0) {
+        return err;
+    }
+
+    ImpInitializeImpairment(&impairment, "Video", allocateVideoPacketBuffer, freeVideoPacketBuffer);
     initializeVideoDepacketizer(StreamConfig.packetSize);
     RtpvInitializeQueue(&rtpQueue);
     receivedDataFromPeer = false;
     firstDataTimeMs = 0;
-    receivedFullFrame = false;
+    PltAtomicStore(&receivedFullFrame, 0);
+    recvBatchCount = 0;
+    recvBatchPacketCount = 0;
+    recvBatchMaxPackets = 0;
+    memset(recvBatchHistogram, 0, sizeof(recvBatchHistogram));
+    pipeliningActive = false;
+    receivedPacketQueueDrops = 0;
+    PltAtomicStore(&rtpQueueDepth, 0);
+    PltAtomicStore(&rtpQueuePeak, 0);
+
+    LC_ASSERT(sizeof(RECEIVED_PACKET_ENTRY) <= sizeof(RTPV_QUEUE_ENTRY));
+
+    return 0;
 }
 
 // Clean up the video stream
 void destroyVideoStream(void) {
     destroyVideoDepacketizer();
     RtpvCleanupQueue(&rtpQueue);
+    ImpCleanupImpairment(&impairment);
+
+    // This must be last because the depacketizer and RTP queue return their buffers to the pool
+    PoolDestroyPacketPool(&packetPool);
+}
+
+// Allocates a packet buffer of StreamConfig.packetSize + MAX_RTP_HEADER_SIZE + sizeof(RTPV_QUEUE_ENTRY) bytes
+void* allocateVideoPacketBuffer(void) {
+    return PoolAllocatePacket(&packetPool);
+}
+
+// Frees a buffer from allocateVideoPacketBuffer(). Buffers allocated with malloc() may also be passed here.
+void freeVideoPacketBuffer(void* buffer) {
+    PoolFreePacket(&packetPool, buffer);
 }
 
 // UDP Ping proc
@@ -62,20 +157,123 @@ static void VideoPingThreadProc(void* context) {
     }
 }
 
+static void recordReceiveBatch(int packets) {
+    int bucket;
+
+    recvBatchCount++;
+    recvBatchPacketCount += packets;
+    if (packets > recvBatchMaxPackets) {
+        recvBatchMaxPackets = packets;
+    }
+
+    // Power of 2 buckets: 1, 2-3, 4-7, 8-15, 16-31, 32+
+    for (bucket = 0; bucket < RECV_BATCH_HISTOGRAM_BUCKETS - 1 && (packets >> (bucket + 1)) != 0; bucket++);
+    recvBatchHistogram[bucket]++;
+}
+
+static void logReceiveBatchStats(void) {
+    if (recvBatchCount == 0) {
+        return;
+    }
+
+    Limelog("Video receive: %llu packets in %llu receive calls (%.2f packets per call, max %d)\n",
+            (unsigned long long)recvBatchPacketCount,
+            (unsigned long long)recvBatchCount,
+            (double)recvBatchPacketCount / recvBatchCount,
+            recvBatchMaxPackets);
+    Limelog("Video receive batch sizes: 1: %u | 2-3: %u | 4-7: %u | 8-15: %u | 16-31: %u | 32+: %u\n",
+            recvBatchHistogram[0], recvBatchHistogram[1], recvBatchHistogram[2],
+            recvBatchHistogram[3], recvBatchHistogram[4], recvBatchHistogram[5]);
+}
+
+// Runs FEC recovery and depacketization for a packet. Returns true if the RTP queue took ownership of the buffer.
+static bool addPacketToRtpQueue(char* buffer, int length, int receiveSize, uint64_t receiveTimeUs) {
+    bool queued;
+    int depth;
+
+    queued = RtpvAddPacket(&rtpQueue, (PRTP_PACKET)buffer, length,
+                           (PRTPV_QUEUE_ENTRY)&buffer[receiveSize], receiveTimeUs) == RTPF_RET_QUEUED;
+
+    // Only this thread writes these, so the peak can't go backwards
+    depth = RtpvGetQueuedPacketCount(&rtpQueue);
+    PltAtomicStore(&rtpQueueDepth, depth);
+    if (depth > PltAtomicLoad(&rtpQueuePeak)) {
+        PltAtomicStore(&rtpQueuePeak, depth);
+    }
+
+    return queued;
+}
+
+// Hands a received packet to the depacketizer thread if pipelining is enabled, otherwise
+// directly to the RTP queue. Returns true if ownership of the buffer was taken.
+static bool queueReceivedPacket(char* buffer, int length, int receiveSize) {
+    PRTP_PACKET packet;
+
+    // Convert fields to host byte-order
+    packet = (PRTP_PACKET)&buffer[0];
+    packet->sequenceNumber = BE16(packet->sequenceNumber);
+    packet->timestamp = BE32(packet->timestamp);
+    packet->ssrc = BE32(packet->ssrc);
+
+    if (pipeliningActive) {
+        PRECEIVED_PACKET_ENTRY entry = (PRECEIVED_PACKET_ENTRY)&buffer[receiveSize];
+
+        entry->receiveTimeUs = PltGetMicroseconds();
+        entry->length = length;
+        if (RqOfferQueueItem(&receivedPacketQueue, buffer, &entry->entry) != LBQ_SUCCESS) {
+            // The depacketizer thread is far behind. Dropping the packet here is no worse
+            // than letting the socket buffer overflow, and FEC or an IDR frame recovers.
+            receivedPacketQueueDrops++;
+            return false;
+        }
+
+        return true;
+    }
+
+    return addPacketToRtpQueue(buffer, length, receiveSize, PltGetMicroseconds());
+}
+
+// Hands a received packet to the impairment stage if it's enabled, otherwise directly
+// to the RTP queue. Returns true if ownership of the buffer was taken.
+static bool submitReceivedPacket(char* buffer, int length, int receiveSize) {
+    if (impairment.enabled) {
+        ImpSubmitPacket(&impairment, buffer, length);
+        return true;
+    }
+
+    return queueReceivedPacket(buffer, length, receiveSize);
+}
+
+// Passes any packets released by the impairment stage on to the RTP queue
+static void deliverImpairedPackets(int receiveSize) {
+    char* buffer;
+    int length;
+
+    while (ImpGetPacket(&impairment, &buffer, &length)) {
+        if (!queueReceivedPacket(buffer, length, receiveSize)) {
+            freeVideoPacketBuffer(buffer);
+        }
+    }
+}
+
 // Receive thread proc
 static void VideoReceiveThreadProc(void* context) {
     int err;
-    int bufferSize, receiveSize;
-    char* buffer;
-    int queueStatus;
+    int receiveSize;
+    char* buffers[UDP_RECV_MAX_BATCH];
+    int lengths[UDP_RECV_MAX_BATCH];
     bool useSelect;
+    int recvTimeoutMs;
     int waitingForVideoMs;
+    int i;
 
     receiveSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
-    bufferSize = receiveSize + sizeof(RTPV_QUEUE_ENTRY);
-    buffer = NULL;
+    memset(buffers, 0, sizeof(buffers));
+
+    // Wake up often enough to release packets delayed by the impairment stage on time
+    recvTimeoutMs = (impairment.enabled && impairment.config.jitterMs > 0) ? 1 : UDP_RECV_POLL_TIMEOUT_MS;
 
-    if (setNonFatalRecvTimeoutMs(rtpSocket, UDP_RECV_POLL_TIMEOUT_MS) < 0) {
+    if (setNonFatalRecvTimeoutMs(rtpSocket, recvTimeoutMs) < 0) {
         // SO_RCVTIMEO failed, so use select() to wait
         useSelect = true;
     }
@@ -86,28 +284,31 @@ static void VideoReceiveThreadProc(void* context) {
 
     waitingForVideoMs = 0;
     while (!PltIsThreadInterrupted(&receiveThread)) {
-        PRTP_PACKET packet;
-
-        if (buffer == NULL) {
-            buffer = (char*)malloc(bufferSize);
-            if (buffer == NULL) {
-                Limelog("Video Receive: malloc() failed\n");
-                ListenerCallbacks.connectionTerminated(-1);
-                return;
+        // Refill any slots in the receive ring that were handed off to the RTP queue
+        for (i = 0; i < UDP_RECV_MAX_BATCH; i++) {
+            if (buffers[i] == NULL) {
+                buffers[i] = (char*)allocateVideoPacketBuffer();
+                if (buffers[i] == NULL) {
+                    Limelog("Video Receive: allocateVideoPacketBuffer() failed\n");
+                    ListenerCallbacks.connectionTerminated(-1);
+                    goto Exit;
+                }
             }
         }
 
-        err = recvUdpSocket(rtpSocket, buffer, receiveSize, useSelect);
+        err = recvUdpSocketBatch(rtpSocket, buffers, lengths, receiveSize, UDP_RECV_MAX_BATCH, useSelect);
         if (err < 0) {
-            Limelog("Video Receive: recvUdpSocket() failed: %d\n", (int)LastSocketError());
+            Limelog("Video Receive: recvUdpSocketBatch() failed: %d\n", (int)LastSocketError());
             ListenerCallbacks.connectionTerminated(LastSocketFail());
             break;
         }
         else if  (err == 0) {
+            deliverImpairedPackets(receiveSize);
+
             if (!receivedDataFromPeer) {
                 // If we wait many seconds without ever receiving a video packet,
                 // assume something is broken and terminate the connection.
-                waitingForVideoMs += UDP_RECV_POLL_TIMEOUT_MS;
+                waitingForVideoMs += recvTimeoutMs;
                 if (waitingForVideoMs >= FIRST_FRAME_TIMEOUT_SEC * 1000) {
                     Limelog("Terminating connection due to lack of video traffic\n");
                     ListenerCallbacks.connectionTerminated(ML_ERROR_NO_VIDEO_TRAFFIC);
@@ -119,6 +320,8 @@ static void VideoReceiveThreadProc(void* context) {
             continue;
         }
 
+        recordReceiveBatch(err);
+
         if (!receivedDataFromPeer) {
             receivedDataFromPeer = true;
             Limelog("Received first video packet after %d ms\n", waitingForVideoMs);
@@ -126,7 +329,7 @@ static void VideoReceiveThreadProc(void* context) {
             firstDataTimeMs = PltGetMillis();
         }
 
-        if (!receivedFullFrame) {
+        if (!PltAtomicLoad(&receivedFullFrame)) {
             uint64_t now = PltGetMillis();
 
             if (now - firstDataTimeMs >= FIRST_FRAME_TIMEOUT_SEC * 1000) {
@@ -136,28 +339,118 @@ static void VideoReceiveThreadProc(void* context) {
             }
         }
 
-        // Convert fields to host byte-order
-        packet = (PRTP_PACKET)&buffer[0];
-        packet->sequenceNumber = BE16(packet->sequenceNumber);
-        packet->timestamp = BE32(packet->timestamp);
-        packet->ssrc = BE32(packet->ssrc);
+        // Hand each packet to the RTP queue in the order it was received
+        for (i = 0; i < err; i++) {
+            // Capture the packet exactly as it arrived from the network
+            capturePacket(CAPTURE_STREAM_VIDEO, buffers[i], lengths[i]);
 
-        queueStatus = RtpvAddPacket(&rtpQueue, packet, err, (PRTPV_QUEUE_ENTRY)&buffer[receiveSize]);
+            if (submitReceivedPacket(buffers[i], lengths[i], receiveSize)) {
+                // The queue owns the buffer
+                buffers[i] = NULL;
+            }
+        }
 
-        if (queueStatus == RTPF_RET_QUEUED) {
-            // The queue owns the buffer
-            buffer = NULL;
+        deliverImpairedPackets(receiveSize);
+    }
+
+Exit:
+    for (i = 0; i < UDP_RECV_MAX_BATCH; i++) {
+        if (buffers[i] != NULL) {
+            freeVideoPacketBuffer(buffers[i]);
         }
     }
+}
 
-    if (buffer != NULL) {
-        free(buffer);
+// Depacketizer thread proc
+static void VideoDepacketizerThreadProc(void* context) {
+    int receiveSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
+    char* buffer;
+
+    while (RqWaitForQueueElement(&receivedPacketQueue, (void**)&buffer) == LBQ_SUCCESS) {
+        PRECEIVED_PACKET_ENTRY entry = (PRECEIVED_PACKET_ENTRY)&buffer[receiveSize];
+
+        // Copy these first, since the RTP queue reuses this space for its own entry
+        int length = entry->length;
+        uint64_t receiveTimeUs = entry->receiveTimeUs;
+
+        if (!addPacketToRtpQueue(buffer, length, receiveSize, receiveTimeUs)) {
+            freeVideoPacketBuffer(buffer);
+        }
     }
 }
 
+static int startDepacketizerThread(void) {
+    int err;
+
+    if (!pipeliningConfigured) {
+        return 0;
+    }
+
+    // Leave at least half of the packet pool for the receive thread and RTP queue
+    err = RqInitializeRingQueue(&receivedPacketQueue, getPacketPoolCapacity() / 2);
+    if (err != 0) {
+        return err;
+    }
+
+    err = PltCreateThread("VideoDepkt", VideoDepacketizerThreadProc, NULL, &depacketizerThread);
+    if (err != 0) {
+        RqDestroyRingQueue(&receivedPacketQueue);
+        return err;
+    }
+
+    pipeliningActive = true;
+    return 0;
+}
+
+// This must only be called once the receive thread has exited
+static void stopDepacketizerThread(void) {
+    PLINKED_BLOCKING_QUEUE_ENTRY entry;
+
+    if (!pipeliningActive) {
+        return;
+    }
+
+    RqSignalQueueShutdown(&receivedPacketQueue);
+    PltInterruptThread(&depacketizerThread);
+    PltJoinThread(&depacketizerThread);
+    PltCloseThread(&depacketizerThread);
+    pipeliningActive = false;
+
+    // Free any packets the depacketizer thread didn't get to
+    entry = RqDestroyRingQueue(&receivedPacketQueue);
+    while (entry != NULL) {
+        PLINKED_BLOCKING_QUEUE_ENTRY nextEntry = entry->flink;
+        freeVideoPacketBuffer(entry->data);
+        entry = nextEntry;
+    }
+
+    if (receivedPacketQueueDrops != 0) {
+        Limelog("Video depacketizer fell behind: %u packets dropped\n", receivedPacketQueueDrops);
+    }
+}
+
+void LiSetVideoPipelining(bool enabled) {
+    pipeliningConfigured = enabled;
+}
+
+void LiGetVideoQueueDepths(PVIDEO_QUEUE_DEPTHS depths) {
+    memset(depths, 0, sizeof(*depths));
+
+    if (pipeliningActive) {
+        depths->receivedPackets = RqGetItemCount(&receivedPacketQueue);
+        depths->receivedPacketsPeak = RqGetPeakItemCount(&receivedPacketQueue);
+    }
+
+    depths->fecPackets = PltAtomicLoad(&rtpQueueDepth);
+    depths->fecPacketsPeak = PltAtomicExchange(&rtpQueuePeak, depths->fecPackets);
+
+    depths->decodeUnits = LiGetPendingVideoFrames();
+    depths->decodeUnitsPeak = getPendingVideoFramesPeak();
+}
+
 void notifyKeyFrameReceived(void) {
     // Remember that we got a full frame successfully
-    receivedFullFrame = true;
+    PltAtomicStore(&receivedFullFrame, 1);
 }
 
 // Decoder thread proc
@@ -217,6 +510,10 @@ void stopVideoStream(void) {
     if ((VideoCallbacks.capabilities & (CAPABILITY_DIRECT_SUBMIT | CAPABILITY_PULL_RENDERER)) == 0) {
         PltCloseThread(&decoderThread);
     }
+
+    stopDepacketizerThread();
+
+    logReceiveBatchStats();
     
     if (firstFrameSocket != INVALID_SOCKET) {
         closeSocket(firstFrameSocket);
@@ -230,6 +527,70 @@ void stopVideoStream(void) {
     VideoCallbacks.cleanup();
 }
 
+// Feeds a packet from a capture file into the RTP queue as if it was just received
+bool replayVideoPacket(const char* data, int length) {
+    int receiveSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
+    char* buffer;
+
+    if (length < (int)sizeof(RTP_PACKET) || length > receiveSize) {
+        // Not a packet we would have received
+        return true;
+    }
+
+    buffer = (char*)allocateVideoPacketBuffer();
+    if (buffer == NULL) {
+        return false;
+    }
+
+    memcpy(buffer, data, length);
+    if (!submitReceivedPacket(buffer, length, receiveSize)) {
+        freeVideoPacketBuffer(buffer);
+    }
+
+    deliverImpairedPackets(receiveSize);
+    return true;
+}
+
+// Starts the decoder without any network threads for packet capture replay
+int startVideoReplay(void* rendererContext, int drFlags) {
+    int err;
+
+    LC_ASSERT(NegotiatedVideoFormat != 0);
+    err = VideoCallbacks.setup(NegotiatedVideoFormat, StreamConfig.width,
+        StreamConfig.height, StreamConfig.fps, rendererContext, drFlags);
+    if (err != 0) {
+        return err;
+    }
+
+    VideoCallbacks.start();
+
+    if ((VideoCallbacks.capabilities & (CAPABILITY_DIRECT_SUBMIT | CAPABILITY_PULL_RENDERER)) == 0) {
+        err = PltCreateThread("VideoDec", VideoDecoderThreadProc, NULL, &decoderThread);
+        if (err != 0) {
+            VideoCallbacks.stop();
+            VideoCallbacks.cleanup();
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+void stopVideoReplay(void) {
+    VideoCallbacks.stop();
+
+    // Wake up client code that may be waiting on the decode unit queue
+    stopVideoDepacketizer();
+
+    if ((VideoCallbacks.capabilities & (CAPABILITY_DIRECT_SUBMIT | CAPABILITY_PULL_RENDERER)) == 0) {
+        PltInterruptThread(&decoderThread);
+        PltJoinThread(&decoderThread);
+        PltCloseThread(&decoderThread);
+    }
+
+    VideoCallbacks.cleanup();
+}
+
 // Start the video stream
 int startVideoStream(void* rendererContext, int drFlags) {
     int err;
@@ -253,9 +614,19 @@ int startVideoStream(void* rendererContext, int drFlags) {
 
     VideoCallbacks.start();
 
+    // This must be running before the receive thread starts handing it packets
+    err = startDepacketizerThread();
+    if (err != 0) {
+        VideoCallbacks.stop();
+        closeSocket(rtpSocket);
+        VideoCallbacks.cleanup();
+        return err;
+    }
+
     err = PltCreateThread("VideoRecv", VideoReceiveThreadProc, NULL, &receiveThread);
     if (err != 0) {
         VideoCallbacks.stop();
+        stopDepacketizerThread();
         closeSocket(rtpSocket);
         VideoCallbacks.cleanup();
         return err;
@@ -268,6 +639,7 @@ int startVideoStream(void* rendererContext, int drFlags) {
             PltInterruptThread(&receiveThread);
             PltJoinThread(&receiveThread);
             PltCloseThread(&receiveThread);
+            stopDepacketizerThread();
             closeSocket(rtpSocket);
             VideoCallbacks.cleanup();
             return err;
@@ -293,6 +665,7 @@ int startVideoStream(void* rendererContext, int drFlags) {
             if ((VideoCallbacks.capabilities & (CAPABILITY_DIRECT_SUBMIT | CAPABILITY_PULL_RENDERER)) == 0) {
                 PltCloseThread(&decoderThread);
             }
+            stopDepacketizerThread();
             closeSocket(rtpSocket);
             VideoCallbacks.cleanup();
             return LastSocketError();
@@ -317,6 +690,7 @@ int startVideoStream(void* rendererContext, int drFlags) {
         if ((VideoCallbacks.capabilities & (CAPABILITY_DIRECT_SUBMIT | CAPABILITY_PULL_RENDERER)) == 0) {
             PltCloseThread(&decoderThread);
         }
+        stopDepacketizerThread();
         closeSocket(rtpSocket);
         if (firstFrameSocket != INVALID_SOCKET) {
             closeSocket(firstFrameSocket);
@@ -0,0 +1,277 @@
+// Measures frame assembly with and without CAPABILITY_CONTIGUOUS_FRAME_BUFFER.
+// Synthetic H.264 frames are split into packets and fed to the depacketizer
+// with queueRtpPacket(), the way the RTP queue does once a frame's FEC block
+// is complete. A consumer then turns each decode unit into the single padded
+// buffer FFmpeg wants:
+//
+// copy:       the depacketizer chains the packet buffers, and the consumer
+//             copies the chain into its own buffer like
+//             FFmpegVideoDecoder::writeBuffer() does.
+// contiguous: the depacketizer copies each fragment into the frame buffer as
+//             it is queued, and the consumer detaches that buffer.
+//
+// Two times are reported per frame. "reassembly" is enqueueTimeUs minus
+// frameCompleteTimeUs, which is what the stats overlay shows. It runs on the
+// receive thread (or the depacketizer thread when pipelining), so it includes
+// the per-fragment memcpy of the contiguous mode. "submit" is the consumer's
+// work before avcodec_send_packet(), which the overlay counts as decode time.
+//
+// Usage: frame_bench [frames] [frame size in bytes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Limelight-internal.h"
+
+#define DEFAULT_FRAMES 2000
+#define DEFAULT_FRAME_SIZE (64 * 1024)
+#define PACKET_SIZE 1392
+#define IDR_INTERVAL 120
+
+// Host frame header that precedes the Annex B data in a frame's first packet
+#define FRAME_HEADER_SIZE 8
+
+typedef struct _BENCH_RESULT {
+    uint64_t reassemblyUs;
+    uint64_t submitUs;
+    uint64_t bytes;
+    int frames;
+} BENCH_RESULT;
+
+static unsigned int randomState = 1;
+
+static unsigned int nextRandom(void) {
+    randomState = randomState * 1103515245 + 12345;
+    return randomState >> 16;
+}
+
+// Builds an Annex B frame with the host's frame header in front. IDR frames
+// start with an SPS and a PPS. The slice data has no zero bytes, so it can't
+// contain a start code of its own.
+static int buildFrame(char* data, int size, bool idr) {
+    static const char sps[] = "\x00\x00\x00\x01\x67\x64\x00\x28\xac\x2b\x40\x3c\x01\x13\xf2\xc0\x3c\x48\x9a\x80";
+    static const char pps[] = "\x00\x00\x00\x01\x68\xee\x3c\xb0";
+    int offset = 0;
+    int i;
+
+    memset(data, 0, FRAME_HEADER_SIZE);
+    data[0] = 0x01;
+    offset += FRAME_HEADER_SIZE;
+
+    if (idr) {
+        memcpy(&data[offset], sps, sizeof(sps) - 1);
+        offset += sizeof(sps) - 1;
+        memcpy(&data[offset], pps, sizeof(pps) - 1);
+        offset += sizeof(pps) - 1;
+    }
+
+    memcpy(&data[offset], idr ? "\x00\x00\x00\x01\x65" : "\x00\x00\x00\x01\x41", 5);
+    offset += 5;
+
+    for (i = offset; i < size; i++) {
+        data[i] = (char)(1 + nextRandom() % 255);
+    }
+
+    return size;
+}
+
+// Splits the frame into packets in pool buffers laid out like received ones
+static int packetizeFrame(const char* data, int length, uint32_t frameIndex, uint32_t* streamPacketIndex,
+                          char** packets, int* packetLengths, int maxPackets) {
+    int payloadSize = PACKET_SIZE - (int)sizeof(NV_VIDEO_PACKET);
+    int count = 0;
+    int offset = 0;
+
+    while (offset < length) {
+        int chunk = length - offset < payloadSize ? length - offset : payloadSize;
+        char* buffer;
+        PRTP_PACKET rtp;
+        PNV_VIDEO_PACKET nv;
+
+        if (count == maxPackets || (buffer = (char*)allocateVideoPacketBuffer()) == NULL) {
+            return -1;
+        }
+
+        rtp = (PRTP_PACKET)buffer;
+        memset(rtp, 0, sizeof(*rtp));
+        rtp->header = 0x80;
+
+        nv = (PNV_VIDEO_PACKET)(rtp + 1);
+        memset(nv, 0, sizeof(*nv));
+        nv->streamPacketIndex = (*streamPacketIndex)++ << 8;
+        nv->frameIndex = frameIndex;
+        nv->flags = FLAG_CONTAINS_PIC_DATA;
+        if (offset == 0) {
+            nv->flags |= FLAG_SOF;
+        }
+        if (offset + chunk == length) {
+            nv->flags |= FLAG_EOF;
+        }
+
+        memcpy(nv + 1, &data[offset], chunk);
+        offset += chunk;
+
+        packets[count] = buffer;
+        packetLengths[count] = (int)(sizeof(*rtp) + sizeof(*nv)) + chunk;
+        count++;
+    }
+
+    return count;
+}
+
+// The copy FFmpegVideoDecoder makes when it can't use the frame buffer directly
+static void copyBufferList(PDECODE_UNIT du, char** buffer, int* bufferSize) {
+    int requiredSize = du->fullLength + VIDEO_FRAME_BUFFER_PADDING;
+    PLENTRY entry;
+    int offset = 0;
+
+    if (*bufferSize < requiredSize) {
+        free(*buffer);
+        *buffer = (char*)malloc(requiredSize);
+        *bufferSize = *buffer != NULL ? requiredSize : 0;
+        if (*buffer == NULL) {
+            return;
+        }
+    }
+
+    for (entry = du->bufferList; entry != NULL; entry = entry->next) {
+        memcpy(&(*buffer)[offset], entry->data, entry->length);
+        offset += entry->length;
+    }
+
+    memset(&(*buffer)[offset], 0, VIDEO_FRAME_BUFFER_PADDING);
+}
+
+static int runBenchmark(bool contiguous, int frames, int frameSize, BENCH_RESULT* result) {
+    int maxPackets = frameSize / (PACKET_SIZE - (int)sizeof(NV_VIDEO_PACKET)) + 1;
+    char* frameData = (char*)malloc(frameSize);
+    char** packets = (char**)malloc(sizeof(char*) * maxPackets);
+    int* packetLengths = (int*)malloc(sizeof(int) * maxPackets);
+    char* decodeBuffer = NULL;
+    int decodeBufferSize = 0;
+    uint32_t streamPacketIndex = 0;
+    int ret = -1;
+    int i, j;
+
+    memset(result, 0, sizeof(*result));
+    randomState = 1;
+
+    memset(&VideoCallbacks, 0, sizeof(VideoCallbacks));
+    VideoCallbacks.capabilities = contiguous ? CAPABILITY_CONTIGUOUS_FRAME_BUFFER : 0;
+
+    if (frameData == NULL || packets == NULL || packetLengths == NULL || initializeVideoStream() != 0) {
+        free(frameData);
+        free(packets);
+        free(packetLengths);
+        return -1;
+    }
+
+    for (i = 0; i < frames; i++) {
+        int length = buildFrame(frameData, frameSize, i % IDR_INTERVAL == 0);
+        int count = packetizeFrame(frameData, length, i + 1, &streamPacketIndex,
+                                   packets, packetLengths, maxPackets);
+        VIDEO_FRAME_HANDLE handle;
+        PDECODE_UNIT du;
+        uint64_t frameCompleteTimeUs, startTimeUs;
+
+        if (count < 0) {
+            fprintf(stderr, "Unable to allocate packets for frame %d\n", i + 1);
+            goto Exit;
+        }
+
+        frameCompleteTimeUs = PltGetMicroseconds();
+        for (j = 0; j < count; j++) {
+            PRTPV_QUEUE_ENTRY entry = (PRTPV_QUEUE_ENTRY)&packets[j][packetLengths[j]];
+
+            memset(entry, 0, sizeof(*entry));
+            entry->packet = (PRTP_PACKET)packets[j];
+            entry->length = packetLengths[j];
+            entry->receiveTimeUs = frameCompleteTimeUs;
+            queueRtpPacket(entry, frameCompleteTimeUs);
+        }
+
+        if (!LiPollNextVideoFrame(&handle, &du)) {
+            fprintf(stderr, "Frame %d was not assembled\n", i + 1);
+            goto Exit;
+        }
+        if (du->frameNumber != i + 1 || du->fullLength != length - FRAME_HEADER_SIZE) {
+            fprintf(stderr, "Frame %d came out as frame %d with %d bytes, expected %d\n",
+                    i + 1, du->frameNumber, du->fullLength, length - FRAME_HEADER_SIZE);
+            goto Exit;
+        }
+
+        result->reassemblyUs += du->enqueueTimeUs - du->frameCompleteTimeUs;
+
+        startTimeUs = PltGetMicroseconds();
+        if (contiguous) {
+            void* buffer = LiDetachVideoFrameBuffer(du);
+
+            if (buffer == NULL) {
+                fprintf(stderr, "Frame %d has no contiguous buffer\n", i + 1);
+                goto Exit;
+            }
+
+            // The decoder frees it once libavcodec is done with the packet
+            LiFreeVideoFrameBuffer(buffer);
+        }
+        else {
+            copyBufferList(du, &decodeBuffer, &decodeBufferSize);
+        }
+        LiCompleteVideoFrame(handle, DR_OK);
+        result->submitUs += PltGetMicroseconds() - startTimeUs;
+
+        result->bytes += length;
+        result->frames++;
+    }
+
+    ret = 0;
+
+Exit:
+    stopVideoDepacketizer();
+    destroyVideoStream();
+    free(decodeBuffer);
+    free(frameData);
+    free(packets);
+    free(packetLengths);
+    return ret;
+}
+
+static void printResult(const char* name, const BENCH_RESULT* result) {
+    double reassembly = (double)result->reassemblyUs / result->frames;
+    double submit = (double)result->submitUs / result->frames;
+
+    printf("%-10s reassembly %7.2f us  submit %7.2f us  total %7.2f us per frame\n",
+           name, reassembly, submit, reassembly + submit);
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES;
+    int frameSize = argc > 2 ? atoi(argv[2]) : DEFAULT_FRAME_SIZE;
+    BENCH_RESULT copyResult, contiguousResult;
+
+    if (frames <= 0 || frameSize < 256) {
+        fprintf(stderr, "Usage: frame_bench [frames] [frame size in bytes]\n");
+        return 1;
+    }
+
+    // A GFE version with the 8 byte frame header
+    AppVersionQuad[0] = 7;
+    AppVersionQuad[1] = 1;
+    AppVersionQuad[2] = 431;
+    AppVersionQuad[3] = 0;
+    NegotiatedVideoFormat = VIDEO_FORMAT_H264;
+    StreamConfig.packetSize = PACKET_SIZE;
+
+    printf("%d frames of %d bytes in %d byte packets\n", frames, frameSize, PACKET_SIZE);
+
+    if (runBenchmark(false, frames, frameSize, &copyResult) != 0 ||
+            runBenchmark(true, frames, frameSize, &contiguousResult) != 0) {
+        return 1;
+    }
+
+    printResult("copy", &copyResult);
+    printResult("contiguous", &contiguousResult);
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+// Compares the ring queue against the linked blocking queue on a single
+// producer path. The decode unit and audio packet queues stay on the LBQ
+// until this shows a gain. Two patterns are measured for each queue:
+//
+// paced: the producer offers one item at a time and waits for the consumer
+//        to take it, so every item wakes a blocked consumer. This is the
+//        latency a decode unit or audio packet sees on an idle queue.
+// burst: the producer offers items back to back, so the consumer rarely
+//        blocks. This reports the cost per item under load, since the
+//        latency is dominated by time spent waiting behind other items.
+//
+// Usage: queue_bench [items]
+// The program also checks that every item arrives exactly once and in order,
+// so it doubles as a cross-thread smoke test for both queues.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Platform.h"
+#include "PlatformThreads.h"
+#include "LinkedBlockingQueue.h"
+#include "RingQueue.h"
+
+#define DEFAULT_ITEMS 200000
+#define QUEUE_BOUND 1024
+
+typedef struct _BENCH_ITEM {
+    LINKED_BLOCKING_QUEUE_ENTRY entry;
+    unsigned int sequence;
+    uint64_t offerTimeUs;
+} BENCH_ITEM;
+
+typedef struct _QUEUE_OPS {
+    const char* name;
+    int (*initialize)(void* queue, int sizeBound);
+    int (*offer)(void* queue, void* data, PLINKED_BLOCKING_QUEUE_ENTRY entry);
+    int (*wait)(void* queue, void** data);
+    void (*shutdown)(void* queue);
+    void (*destroy)(void* queue);
+} QUEUE_OPS;
+
+static int lbqInitialize(void* queue, int sizeBound) {
+    return LbqInitializeLinkedBlockingQueue((PLINKED_BLOCKING_QUEUE)queue, sizeBound);
+}
+
+static int lbqOffer(void* queue, void* data, PLINKED_BLOCKING_QUEUE_ENTRY entry) {
+    return LbqOfferQueueItem((PLINKED_BLOCKING_QUEUE)queue, data, entry);
+}
+
+static int lbqWait(void* queue, void** data) {
+    return LbqWaitForQueueElement((PLINKED_BLOCKING_QUEUE)queue, data);
+}
+
+static void lbqShutdown(void* queue) {
+    LbqSignalQueueShutdown((PLINKED_BLOCKING_QUEUE)queue);
+}
+
+static void lbqDestroy(void* queue) {
+    LbqDestroyLinkedBlockingQueue((PLINKED_BLOCKING_QUEUE)queue);
+}
+
+static int rqInitialize(void* queue, int sizeBound) {
+    return RqInitializeRingQueue((PRING_QUEUE)queue, sizeBound);
+}
+
+static int rqOffer(void* queue, void* data, PLINKED_BLOCKING_QUEUE_ENTRY entry) {
+    return RqOfferQueueItem((PRING_QUEUE)queue, data, entry);
+}
+
+static int rqWait(void* queue, void** data) {
+    return RqWaitForQueueElement((PRING_QUEUE)queue, data);
+}
+
+static void rqShutdown(void* queue) {
+    RqSignalQueueShutdown((PRING_QUEUE)queue);
+}
+
+static void rqDestroy(void* queue) {
+    RqDestroyRingQueue((PRING_QUEUE)queue);
+}
+
+static const QUEUE_OPS LbqOps = { "LBQ", lbqInitialize, lbqOffer, lbqWait, lbqShutdown, lbqDestroy };
+static const QUEUE_OPS RqOps = { "RQ", rqInitialize, rqOffer, rqWait, rqShutdown, rqDestroy };
+
+typedef struct _BENCH_CONTEXT {
+    const QUEUE_OPS* ops;
+    void* queue;
+    unsigned int itemCount;
+    uint64_t* latenciesUs;
+    PLT_ATOMIC_INT consumed;
+    int errors;
+} BENCH_CONTEXT;
+
+static void consumerThreadProc(void* context) {
+    BENCH_CONTEXT* ctx = (BENCH_CONTEXT*)context;
+    unsigned int i;
+
+    for (i = 0; i < ctx->itemCount; i++) {
+        BENCH_ITEM* item;
+
+        if (ctx->ops->wait(ctx->queue, (void**)&item) != LBQ_SUCCESS) {
+            ctx->errors++;
+            break;
+        }
+
+        ctx->latenciesUs[i] = PltGetMicroseconds() - item->offerTimeUs;
+        if (item->sequence != i) {
+            ctx->errors++;
+        }
+
+        PltAtomicStore(&ctx->consumed, (int)(i + 1));
+    }
+}
+
+static int compareLatency(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static int runBenchmark(const QUEUE_OPS* ops, bool paced, BENCH_ITEM* items, unsigned int itemCount) {
+    LINKED_BLOCKING_QUEUE lbq;
+    RING_QUEUE rq;
+    BENCH_CONTEXT ctx;
+    PLT_THREAD consumerThread;
+    uint64_t startTimeUs, elapsedUs, totalUs;
+    unsigned int i;
+
+    ctx.ops = ops;
+    ctx.queue = (ops == &LbqOps) ? (void*)&lbq : (void*)&rq;
+    ctx.itemCount = itemCount;
+    ctx.latenciesUs = (uint64_t*)malloc(itemCount * sizeof(*ctx.latenciesUs));
+    ctx.consumed = 0;
+    ctx.errors = 0;
+
+    if (ctx.latenciesUs == NULL || ops->initialize(ctx.queue, QUEUE_BOUND) != 0) {
+        fprintf(stderr, "FAILED: %s initialization\n", ops->name);
+        free(ctx.latenciesUs);
+        return 1;
+    }
+
+    if (PltCreateThread("BenchConsumer", consumerThreadProc, &ctx, &consumerThread) != 0) {
+        fprintf(stderr, "FAILED: %s consumer thread creation\n", ops->name);
+        ops->destroy(ctx.queue);
+        free(ctx.latenciesUs);
+        return 1;
+    }
+
+    startTimeUs = PltGetMicroseconds();
+    for (i = 0; i < itemCount; i++) {
+        if (paced) {
+            // Wait for the consumer to drain the queue and block again. Yield
+            // while waiting so this also works on a single CPU.
+            while (PltAtomicLoad(&ctx.consumed) != (int)i) {
+                PltSleepMs(0);
+            }
+        }
+        else {
+            // Don't exceed the bound, since that would discard the item
+            while (i - (unsigned int)PltAtomicLoad(&ctx.consumed) >= QUEUE_BOUND) {
+                PltSleepMs(0);
+            }
+        }
+
+        items[i].sequence = i;
+        items[i].offerTimeUs = PltGetMicroseconds();
+        if (ops->offer(ctx.queue, &items[i], &items[i].entry) != LBQ_SUCCESS) {
+            fprintf(stderr, "FAILED: %s offer of item %u\n", ops->name, i);
+            ctx.errors++;
+            break;
+        }
+    }
+
+    if (ctx.errors != 0) {
+        // Unblock the consumer if we bailed out early
+        ops->shutdown(ctx.queue);
+        PltJoinThread(&consumerThread);
+        PltCloseThread(&consumerThread);
+        ops->destroy(ctx.queue);
+        free(ctx.latenciesUs);
+        return 1;
+    }
+
+    PltJoinThread(&consumerThread);
+    PltCloseThread(&consumerThread);
+    elapsedUs = PltGetMicroseconds() - startTimeUs;
+    ops->shutdown(ctx.queue);
+    ops->destroy(ctx.queue);
+
+    if (ctx.errors != 0) {
+        fprintf(stderr, "FAILED: %s delivered items out of order\n", ops->name);
+        free(ctx.latenciesUs);
+        return 1;
+    }
+
+    if (paced) {
+        totalUs = 0;
+        for (i = 0; i < itemCount; i++) {
+            totalUs += ctx.latenciesUs[i];
+        }
+        qsort(ctx.latenciesUs, itemCount, sizeof(*ctx.latenciesUs), compareLatency);
+
+        printf("%-4s paced: latency mean %.2f us, p50 %llu us, p99 %llu us, max %llu us\n",
+               ops->name,
+               (double)totalUs / itemCount,
+               (unsigned long long)ctx.latenciesUs[itemCount / 2],
+               (unsigned long long)ctx.latenciesUs[(uint64_t)itemCount * 99 / 100],
+               (unsigned long long)ctx.latenciesUs[itemCount - 1]);
+    }
+    else {
+        printf("%-4s burst: %.1f ns per item\n",
+               ops->name, (double)elapsedUs * 1000 / itemCount);
+    }
+
+    free(ctx.latenciesUs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    unsigned int itemCount = DEFAULT_ITEMS;
+    BENCH_ITEM* items;
+    int failures = 0;
+
+    if (argc > 1) {
+        itemCount = (unsigned int)strtoul(argv[1], NULL, 10);
+        if (itemCount == 0) {
+            fprintf(stderr, "Usage: %s [items]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    items = (BENCH_ITEM*)calloc(itemCount, sizeof(*items));
+    if (items == NULL) {
+        return 1;
+    }
+
+    printf("%u items per run\n", itemCount);
+
+    failures += runBenchmark(&LbqOps, true, items, itemCount);
+    failures += runBenchmark(&RqOps, true, items, itemCount);
+    failures += runBenchmark(&LbqOps, false, items, itemCount);
+    failures += runBenchmark(&RqOps, false, items, itemCount);
+
+    free(items);
+    return failures != 0 ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+// Checks the Reed-Solomon codec against a plain scalar GF(2^8) implementation.
+// The encoder's parity must be bit-exact with the reference for every block
+// size, including ones that leave an unaligned tail for the SIMD kernels, and
+// any loss pattern within the parity budget must be recovered exactly. Every
+// kernel available on this CPU is forced in turn, and each one's parity must
+// also match what the scalar kernel produced for the same data.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rs.h"
+
+#define MAX_BLOCK_SIZE 1500
+
+static int failures;
+
+// FNV-1a hash of all the parity a kernel produced, compared across kernels
+static unsigned int parityHash;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "FAILED: " __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static unsigned int randomState = 1;
+
+static unsigned int nextRandom(void) {
+    randomState = randomState * 1103515245 + 12345;
+    return randomState >> 16;
+}
+
+// GF(2^8) multiply with the codec's polynomial (x^8 + x^4 + x^3 + x^2 + 1)
+static unsigned char gfMul(unsigned char a, unsigned char b) {
+    unsigned int product = 0;
+    unsigned int x = a;
+
+    while (b != 0) {
+        if (b & 1) {
+            product ^= x;
+        }
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11d;
+        }
+        b >>= 1;
+    }
+
+    return (unsigned char)product;
+}
+
+static void testShape(int dataShards, int parityShards, int blockSize) {
+    int totalShards = dataShards + parityShards;
+    unsigned char** shards = malloc(totalShards * sizeof(*shards));
+    unsigned char** original = malloc(totalShards * sizeof(*original));
+    unsigned char* marks = malloc(totalShards);
+    reed_solomon* rs;
+    int i, j, k, lost, ret;
+
+    rs = reed_solomon_new(dataShards, parityShards);
+    CHECK(rs != NULL, "reed_solomon_new(%d, %d)", dataShards, parityShards);
+    if (rs == NULL) {
+        free(shards);
+        free(original);
+        free(marks);
+        return;
+    }
+
+    for (i = 0; i < totalShards; i++) {
+        shards[i] = malloc(blockSize);
+        original[i] = malloc(blockSize);
+        for (k = 0; k < blockSize; k++) {
+            shards[i][k] = i < dataShards ? (unsigned char)nextRandom() : 0xAA;
+        }
+    }
+
+    ret = reed_solomon_encode(rs, shards, totalShards, blockSize);
+    CHECK(ret == 0, "encode %d+%d x %d returned %d", dataShards, parityShards, blockSize, ret);
+
+    // Parity row j is the dot product of the parity matrix row with the data
+    for (j = 0; j < parityShards; j++) {
+        for (k = 0; k < blockSize; k++) {
+            unsigned char expected = 0;
+            for (i = 0; i < dataShards; i++) {
+                expected ^= gfMul(rs->parity[j * dataShards + i], shards[i][k]);
+            }
+            if (shards[dataShards + j][k] != expected) {
+                CHECK(0, "parity %d byte %d differs for %d+%d x %d", j, k, dataShards, parityShards, blockSize);
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < totalShards; i++) {
+        memcpy(original[i], shards[i], blockSize);
+    }
+    for (i = dataShards; i < totalShards; i++) {
+        for (k = 0; k < blockSize; k++) {
+            parityHash = (parityHash ^ shards[i][k]) * 16777619;
+        }
+    }
+
+    // Lose a random set of shards that the parity can still cover
+    memset(marks, 0, totalShards);
+    lost = 1 + (int)(nextRandom() % parityShards);
+    for (i = 0; i < lost; i++) {
+        j = (int)(nextRandom() % totalShards);
+        marks[j] = 1;
+        memset(shards[j], 0x55, blockSize);
+    }
+
+    ret = reed_solomon_reconstruct(rs, shards, marks, totalShards, blockSize);
+    CHECK(ret == 0, "reconstruct %d+%d x %d returned %d", dataShards, parityShards, blockSize, ret);
+
+    for (i = 0; i < dataShards; i++) {
+        CHECK(memcmp(shards[i], original[i], blockSize) == 0,
+              "data shard %d not recovered for %d+%d x %d", i, dataShards, parityShards, blockSize);
+    }
+
+    // Losing more shards than there is parity must fail rather than return garbage
+    memset(marks, 0, totalShards);
+    for (i = 0; i <= parityShards && i < dataShards; i++) {
+        marks[i] = 1;
+    }
+    if (parityShards < dataShards) {
+        ret = reed_solomon_reconstruct(rs, shards, marks, totalShards, blockSize);
+        CHECK(ret != 0, "reconstruct with %d of %d+%d lost succeeded", parityShards + 1, dataShards, parityShards);
+    }
+
+    for (i = 0; i < totalShards; i++) {
+        free(shards[i]);
+        free(original[i]);
+    }
+    free(shards);
+    free(original);
+    free(marks);
+    reed_solomon_release(rs);
+}
+
+static void testKernel(int kernel, const char* name, unsigned int* scalarHash) {
+    static const int shapes[][2] = {
+        { 1, 1 }, { 2, 1 }, { 4, 2 }, { 10, 3 }, { 20, 8 }, { 64, 16 }, { 100, 30 },
+    };
+    static const int blockSizes[] = {
+        1, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1027, MAX_BLOCK_SIZE,
+    };
+    unsigned int s, b;
+    int round;
+
+    if (reed_solomon_set_kernel(kernel) != 0) {
+        printf("Skipping the %s kernel, which isn't available\n", name);
+        return;
+    }
+
+    // Every kernel sees the same data, so their parity can be compared
+    randomState = 1;
+    parityHash = 2166136261u;
+
+    for (round = 0; round < 2; round++) {
+        for (s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+            for (b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+                testShape(shapes[s][0], shapes[s][1], blockSizes[b]);
+            }
+        }
+    }
+
+    if (kernel == RS_KERNEL_SCALAR) {
+        *scalarHash = parityHash;
+    }
+    else {
+        CHECK(parityHash == *scalarHash, "%s kernel parity differs from the scalar kernel", name);
+    }
+
+    printf("Checked the %s kernel\n", name);
+}
+
+int main(void) {
+    unsigned int scalarHash = 0;
+
+    reed_solomon_init();
+
+    // Scalar goes first since the others are compared against it
+    testKernel(RS_KERNEL_SCALAR, "scalar", &scalarHash);
+    testKernel(RS_KERNEL_SSSE3, "SSSE3", &scalarHash);
+    testKernel(RS_KERNEL_AVX2, "AVX2", &scalarHash);
+    testKernel(RS_KERNEL_NEON, "NEON", &scalarHash);
+
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("All Reed-Solomon checks passed\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+// Measures the Annex B start sequence search used by the depacketizer against
+// the byte-at-a-time comparison it replaced. Both walk the whole buffer from
+// one "00 00 0x" candidate to the next, the way the depacketizer does, and
+// must find the same candidates.
+//
+// Usage: sc_bench [iterations] [Annex B file]
+// With a file (e.g. IDR frames recorded from a stream with
+// "ffmpeg -i capture.mkv -c:v copy -f h264 idr.h264"), that data is scanned.
+// Without one, a synthetic 4 MiB IDR frame is generated: random slice data
+// with emulation prevention applied and a slice start code every 64 KiB.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Platform.h"
+#include "StartCodeScanner.h"
+
+#define DEFAULT_ITERATIONS 50
+#define SYNTHETIC_FRAME_SIZE (4 * 1024 * 1024)
+#define SYNTHETIC_SLICE_SIZE (64 * 1024)
+
+static unsigned int randomState = 1;
+
+static unsigned int nextRandom(void) {
+    randomState = randomState * 1103515245 + 12345;
+    return randomState >> 16;
+}
+
+// The original depacketizer check, done at every byte
+static int findStartCodeBytewise(const char* data, int length) {
+    int i;
+
+    for (i = 0; i + 2 < length; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && (data[i + 2] == 0 || data[i + 2] == 1)) {
+            return i;
+        }
+    }
+
+    return length;
+}
+
+// Returns the number of candidates found and a checksum of their offsets
+static int scanBuffer(int (*find)(const char*, int), const char* data, int length, uint64_t* checksum) {
+    int offset = 0;
+    int count = 0;
+
+    *checksum = 0;
+    while (offset < length) {
+        offset += find(&data[offset], length - offset);
+        if (offset < length) {
+            *checksum += (uint64_t)offset;
+            count++;
+        }
+
+        // Skip past the candidate, like skipping a start sequence
+        offset += 3;
+    }
+
+    return count;
+}
+
+static char* generateSyntheticFrame(int* length) {
+    char* data = (char*)malloc(SYNTHETIC_FRAME_SIZE);
+    int zeros = 0;
+    int i = 0;
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    while (i < SYNTHETIC_FRAME_SIZE - 4) {
+        if (i % SYNTHETIC_SLICE_SIZE == 0) {
+            memcpy(&data[i], "\x00\x00\x00\x01", 4);
+            i += 4;
+            zeros = 0;
+            continue;
+        }
+
+        // Compressed slice data is close to random, but zeros are more common
+        uint8_t value = (nextRandom() % 8) == 0 ? 0 : (uint8_t)nextRandom();
+
+        // Emulation prevention, so the slice data has no start codes of its own
+        if (zeros >= 2 && value <= 3) {
+            data[i++] = 3;
+            zeros = 0;
+            continue;
+        }
+
+        data[i++] = (char)value;
+        zeros = value == 0 ? zeros + 1 : 0;
+    }
+
+    *length = i;
+    return data;
+}
+
+static char* readFile(const char* path, int* length) {
+    FILE* file = fopen(path, "rb");
+    char* data;
+    long size;
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0 || size > 0x7FFFFFFF ||
+            fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    data = (char*)malloc(size);
+    if (data != NULL && fread(data, size, 1, file) != 1) {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    *length = (int)size;
+    return data;
+}
+
+static double runBenchmark(const char* name, int (*find)(const char*, int),
+                           const char* data, int length, int iterations,
+                           int* count, uint64_t* checksum) {
+    uint64_t startTimeUs, elapsedUs;
+    double bytesPerSecond;
+    int i;
+
+    startTimeUs = PltGetMicroseconds();
+    for (i = 0; i < iterations; i++) {
+        *count = scanBuffer(find, data, length, checksum);
+    }
+    elapsedUs = PltGetMicroseconds() - startTimeUs;
+
+    bytesPerSecond = elapsedUs != 0 ? (double)length * iterations * 1000000 / elapsedUs : 0.0;
+    printf("%-9s %8.2f GB/s (%d candidates)\n", name, bytesPerSecond / 1e9, *count);
+    return bytesPerSecond;
+}
+
+int main(int argc, char** argv) {
+    int iterations = DEFAULT_ITERATIONS;
+    char* data;
+    int length;
+    int bytewiseCount, scannerCount;
+    uint64_t bytewiseChecksum, scannerChecksum;
+    double bytewiseSpeed, scannerSpeed;
+
+    if (argc > 1) {
+        iterations = atoi(argv[1]);
+        if (iterations <= 0) {
+            fprintf(stderr, "Usage: %s [iterations] [Annex B file]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc > 2) {
+        data = readFile(argv[2], &length);
+        if (data == NULL) {
+            fprintf(stderr, "Unable to read %s\n", argv[2]);
+            return 1;
+        }
+        printf("%s: %d bytes, %d iterations\n", argv[2], length, iterations);
+    }
+    else {
+        data = generateSyntheticFrame(&length);
+        if (data == NULL) {
+            return 1;
+        }
+        printf("Synthetic IDR frame: %d bytes, %d iterations\n", length, iterations);
+    }
+
+    ScInitializeScanner();
+
+    bytewiseSpeed = runBenchmark("bytewise", findStartCodeBytewise, data, length, iterations,
+                                 &bytewiseCount, &bytewiseChecksum);
+    scannerSpeed = runBenchmark("scanner", ScFindStartCode, data, length, iterations,
+                                &scannerCount, &scannerChecksum);
+    if (bytewiseSpeed != 0.0) {
+        printf("Speedup: %.1fx\n", scannerSpeed / bytewiseSpeed);
+    }
+
+    free(data);
+
+    if (bytewiseCount != scannerCount || bytewiseChecksum != scannerChecksum) {
+        fprintf(stderr, "FAILED: scanner found %d candidates, expected %d\n", scannerCount, bytewiseCount);
+        return 1;
+    }
+
+    return 0;
+}
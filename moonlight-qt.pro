@@ -16,6 +16,23 @@ win32:!winrt {
     app.depends += soundio
 }
 
+# The packet capture replay driver needs FFmpeg
+unix:!macx {
+    packagesExist(libavcodec) {
+        SUBDIRS += replay
+    }
+}
+else:!winrt {
+    SUBDIRS += replay
+}
+replay.depends = moonlight-common-c
+
+# A stand-in for ViGEmClient.dll and a test of the ViGEm report sender against it
+!winrt {
+    SUBDIRS += vigemstub vigemtest
+    vigemtest.depends = vigemstub
+}
+
 # Support debug and release builds from command line for CI
 CONFIG += debug_and_release
 
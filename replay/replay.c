@@ -0,0 +1,238 @@
+// moonlight-replay plays back a packet capture recorded with "moonlight stream --packet-capture"
+// through the moonlight-common-c RTP queues and depacketizer, decodes the video with FFmpeg,
+// and reports decoder throughput and latency. No host or network is required, so the same
+// capture can be used to compare clients or changes to the video pipeline.
+
+#include <Limelight.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavutil/cpu.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Same slice threading limit as the app's FFmpeg decoder
+#define MAX_SLICES 4
+
+static AVCodecContext* decoderCtx;
+static AVPacket* pkt;
+static AVFrame* frame;
+static uint8_t* decodeBuffer;
+static int decodeBufferSize;
+
+static uint32_t submittedFrames;
+static uint32_t decodedFrames;
+static uint32_t failedDecodes;
+static uint64_t totalDecodeTimeMs;
+static uint64_t totalLatencyMs;
+static uint64_t maxLatencyMs;
+static uint32_t audioSamples;
+static uint32_t audioLostSamples;
+
+static void clLogMessage(const char* format, ...) {
+    va_list va;
+
+    va_start(va, format);
+    vfprintf(stderr, format, va);
+    va_end(va);
+}
+
+static int drSetup(int videoFormat, int width, int height, int redrawRate, void* context, int drFlags) {
+    const AVCodec* decoder;
+
+    if (videoFormat & VIDEO_FORMAT_MASK_H264) {
+        decoder = avcodec_find_decoder(AV_CODEC_ID_H264);
+    }
+    else if (videoFormat & VIDEO_FORMAT_MASK_H265) {
+        decoder = avcodec_find_decoder(AV_CODEC_ID_HEVC);
+    }
+    else {
+        decoder = NULL;
+    }
+
+    if (decoder == NULL) {
+        fprintf(stderr, "No decoder for video format %x\n", videoFormat);
+        return -1;
+    }
+
+    decoderCtx = avcodec_alloc_context3(decoder);
+    if (decoderCtx == NULL) {
+        return -1;
+    }
+
+    decoderCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    decoderCtx->flags2 |= AV_CODEC_FLAG2_FAST;
+    decoderCtx->thread_type = FF_THREAD_SLICE;
+    decoderCtx->thread_count = av_cpu_count() < MAX_SLICES ? av_cpu_count() : MAX_SLICES;
+    decoderCtx->width = width;
+    decoderCtx->height = height;
+
+    if (avcodec_open2(decoderCtx, decoder, NULL) < 0) {
+        fprintf(stderr, "Unable to open %s decoder\n", decoder->name);
+        avcodec_free_context(&decoderCtx);
+        return -1;
+    }
+
+    pkt = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (pkt == NULL || frame == NULL) {
+        av_packet_free(&pkt);
+        av_frame_free(&frame);
+        avcodec_free_context(&decoderCtx);
+        return -1;
+    }
+
+    fprintf(stderr, "Decoding %dx%d %dFPS with %s\n", width, height, redrawRate, decoder->name);
+    return 0;
+}
+
+static void drCleanup(void) {
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&decoderCtx);
+    free(decodeBuffer);
+    decodeBuffer = NULL;
+    decodeBufferSize = 0;
+}
+
+static int drSubmitDecodeUnit(PDECODE_UNIT decodeUnit) {
+    PLENTRY entry;
+    uint64_t submitTimeMs;
+    int offset;
+    int err;
+
+    // FFmpeg requires zeroed padding after the frame data
+    if (decodeBufferSize < decodeUnit->fullLength + AV_INPUT_BUFFER_PADDING_SIZE) {
+        uint8_t* newBuffer = realloc(decodeBuffer, decodeUnit->fullLength + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (newBuffer == NULL) {
+            return DR_NEED_IDR;
+        }
+
+        decodeBuffer = newBuffer;
+        decodeBufferSize = decodeUnit->fullLength + AV_INPUT_BUFFER_PADDING_SIZE;
+    }
+
+    offset = 0;
+    for (entry = decodeUnit->bufferList; entry != NULL; entry = entry->next) {
+        memcpy(&decodeBuffer[offset], entry->data, entry->length);
+        offset += entry->length;
+    }
+    memset(&decodeBuffer[offset], 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    pkt->data = decodeBuffer;
+    pkt->size = offset;
+    pkt->flags = decodeUnit->frameType == FRAME_TYPE_IDR ? AV_PKT_FLAG_KEY : 0;
+
+    submittedFrames++;
+    submitTimeMs = LiGetMillis();
+
+    err = avcodec_send_packet(decoderCtx, pkt);
+    if (err < 0) {
+        failedDecodes++;
+        return DR_NEED_IDR;
+    }
+
+    while (avcodec_receive_frame(decoderCtx, frame) == 0) {
+        uint64_t now = LiGetMillis();
+        uint64_t latencyMs = now - decodeUnit->receiveTimeMs;
+
+        // With AV_CODEC_FLAG_LOW_DELAY, each frame comes out of the decoder
+        // as soon as its decode unit goes in.
+        decodedFrames++;
+        totalDecodeTimeMs += now - submitTimeMs;
+        totalLatencyMs += latencyMs;
+        if (latencyMs > maxLatencyMs) {
+            maxLatencyMs = latencyMs;
+        }
+
+        av_frame_unref(frame);
+    }
+
+    return DR_OK;
+}
+
+static void arDecodeAndPlaySample(char* sampleData, int sampleLength) {
+    // Audio isn't decoded, but we still count what made it through the RTP queue
+    if (sampleData == NULL) {
+        audioLostSamples++;
+    }
+    else {
+        audioSamples++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    CONNECTION_LISTENER_CALLBACKS clCallbacks;
+    DECODER_RENDERER_CALLBACKS drCallbacks;
+    AUDIO_RENDERER_CALLBACKS arCallbacks;
+    const char* path = NULL;
+    const char* impairment = NULL;
+    bool realTime = false;
+    uint64_t startTimeMs;
+    uint64_t elapsedMs;
+    int err;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--realtime") == 0) {
+            realTime = true;
+        }
+        else if (strcmp(argv[i], "--impair") == 0 && i + 1 < argc) {
+            impairment = argv[++i];
+        }
+        else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else {
+            path = NULL;
+            break;
+        }
+    }
+
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s [--realtime] [--impair <config>] <capture file>\n", argv[0]);
+        fprintf(stderr, "  --realtime  Submit packets at their recorded arrival times instead of as fast as possible\n");
+        fprintf(stderr, "  --impair    Simulate a lossy network, e.g. loss=1,burst-start=1,burst-end=25,reorder=1,duplicate=1,jitter=5,seed=1\n");
+        fprintf(stderr, "              (jitter is only meaningful with --realtime)\n");
+        return 1;
+    }
+
+    if (!LiSetNetworkImpairment(impairment)) {
+        fprintf(stderr, "Invalid impairment config: %s\n", impairment);
+        return 1;
+    }
+
+    LiInitializeConnectionCallbacks(&clCallbacks);
+    clCallbacks.logMessage = clLogMessage;
+
+    LiInitializeVideoCallbacks(&drCallbacks);
+    drCallbacks.setup = drSetup;
+    drCallbacks.cleanup = drCleanup;
+    drCallbacks.submitDecodeUnit = drSubmitDecodeUnit;
+
+    LiInitializeAudioCallbacks(&arCallbacks);
+    arCallbacks.decodeAndPlaySample = arDecodeAndPlaySample;
+
+    startTimeMs = LiGetMillis();
+    err = LiReplayPacketCapture(path, realTime, &clCallbacks, &drCallbacks, &arCallbacks, NULL, 0, NULL, 0);
+    elapsedMs = LiGetMillis() - startTimeMs;
+    if (err != 0) {
+        fprintf(stderr, "Replay failed: %d\n", err);
+        return 1;
+    }
+
+    printf("Frames submitted: %u\n", submittedFrames);
+    printf("Frames decoded: %u (%u failed)\n", decodedFrames, failedDecodes);
+    printf("Audio packets: %u (%u concealed)\n", audioSamples, audioLostSamples);
+    if (decodedFrames != 0 && elapsedMs != 0) {
+        printf("Throughput: %.2f FPS\n", decodedFrames * 1000.0 / elapsedMs);
+        printf("Average decoding time: %.2f ms\n", (double)totalDecodeTimeMs / decodedFrames);
+        printf("Average receive to decode latency: %.2f ms (max %llu ms)\n",
+               (double)totalLatencyMs / decodedFrames,
+               (unsigned long long)maxLatencyMs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+QT -= core gui
+
+TARGET = moonlight-replay
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+# Include global qmake defs
+include(../globaldefs.pri)
+
+win32 {
+    contains(QT_ARCH, i386) {
+        LIBS += -L$$PWD/../libs/windows/lib/x86
+        INCLUDEPATH += $$PWD/../libs/windows/include/x86
+    }
+    contains(QT_ARCH, x86_64) {
+        LIBS += -L$$PWD/../libs/windows/lib/x64
+        INCLUDEPATH += $$PWD/../libs/windows/include/x64
+    }
+    contains(QT_ARCH, arm64) {
+        LIBS += -L$$PWD/../libs/windows/lib/arm64
+        INCLUDEPATH += $$PWD/../libs/windows/include/arm64
+    }
+
+    INCLUDEPATH += $$PWD/../libs/windows/include
+    LIBS += -llibssl -llibcrypto -lavcodec -lavutil ws2_32.lib winmm.lib
+}
+macx {
+    INCLUDEPATH += $$PWD/../libs/mac/include
+    LIBS += -L$$PWD/../libs/mac/lib
+    LIBS += -lssl -lcrypto -lavcodec -lavutil
+}
+unix:!macx {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += openssl libavcodec libavutil
+}
+
+# Older GCC versions defaulted to GNU89
+*-g++ {
+    QMAKE_CFLAGS += -std=gnu99
+}
+
+SOURCES += \
+    replay.c
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../moonlight-common-c/release/ -lmoonlight-common-c
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../moonlight-common-c/debug/ -lmoonlight-common-c
+else:unix: LIBS += -L$$OUT_PWD/../moonlight-common-c/ -lmoonlight-common-c
+
+INCLUDEPATH += $$PWD/../moonlight-common-c/moonlight-common-c/src
+DEPENDPATH += $$PWD/../moonlight-common-c/moonlight-common-c/src
@@ -0,0 +1,181 @@
+#include "vigemstub.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/* ViGEmClient error codes */
+#define VIGEM_ERROR_NONE 0x20000000
+#define VIGEM_ERROR_BUS_INVALID_HANDLE 0xe0000013
+#define VIGEM_ERROR_INVALID_TARGET 0xe0000003
+
+typedef struct _STUB_CLIENT {
+    int connected;
+} STUB_CLIENT;
+
+typedef struct _STUB_TARGET {
+    int added;
+} STUB_TARGET;
+
+#ifdef _WIN32
+static SRWLOCK lock = SRWLOCK_INIT;
+#define LOCK() AcquireSRWLockExclusive(&lock)
+#define UNLOCK() ReleaseSRWLockExclusive(&lock)
+#else
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK() pthread_mutex_lock(&lock)
+#define UNLOCK() pthread_mutex_unlock(&lock)
+#endif
+
+static VIGEM_STUB_UPDATE updates[VIGEM_STUB_MAX_UPDATES];
+static int updateCount;
+
+VIGEM_STUB_API uint64_t vigem_stub_get_time_us(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return ((counter.QuadPart / frequency.QuadPart) * 1000000) +
+           (((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+#endif
+}
+
+VIGEM_STUB_API void vigem_stub_reset(void)
+{
+    LOCK();
+    updateCount = 0;
+    UNLOCK();
+}
+
+VIGEM_STUB_API int vigem_stub_get_updates(VIGEM_STUB_UPDATE * output, int maxUpdates)
+{
+    int count;
+
+    LOCK();
+    count = updateCount;
+    if (output != NULL && maxUpdates > 0) {
+        int recorded = count < VIGEM_STUB_MAX_UPDATES ? count : VIGEM_STUB_MAX_UPDATES;
+        memcpy(output, updates, sizeof(*output) * (recorded < maxUpdates ? recorded : maxUpdates));
+    }
+    UNLOCK();
+
+    return count;
+}
+
+VIGEM_STUB_API void * vigem_alloc(void)
+{
+    return calloc(1, sizeof(STUB_CLIENT));
+}
+
+VIGEM_STUB_API void vigem_free(void * vigem)
+{
+    free(vigem);
+}
+
+VIGEM_STUB_API unsigned int vigem_connect(void * vigem)
+{
+    STUB_CLIENT * client = (STUB_CLIENT *)vigem;
+
+    if (client == NULL) {
+        return VIGEM_ERROR_BUS_INVALID_HANDLE;
+    }
+
+    client->connected = 1;
+    return VIGEM_ERROR_NONE;
+}
+
+VIGEM_STUB_API void vigem_disconnect(void * vigem)
+{
+    STUB_CLIENT * client = (STUB_CLIENT *)vigem;
+
+    if (client != NULL) {
+        client->connected = 0;
+    }
+}
+
+VIGEM_STUB_API int vigem_target_is_waitable_add_supported(void * target)
+{
+    (void)target;
+    return 0;
+}
+
+VIGEM_STUB_API void * vigem_target_x360_alloc(void)
+{
+    return calloc(1, sizeof(STUB_TARGET));
+}
+
+VIGEM_STUB_API void * vigem_target_ds4_alloc(void)
+{
+    return calloc(1, sizeof(STUB_TARGET));
+}
+
+VIGEM_STUB_API void vigem_target_free(void * target)
+{
+    free(target);
+}
+
+VIGEM_STUB_API unsigned int vigem_target_add(void * vigem, void * target)
+{
+    STUB_CLIENT * client = (STUB_CLIENT *)vigem;
+
+    if (client == NULL || !client->connected) {
+        return VIGEM_ERROR_BUS_INVALID_HANDLE;
+    }
+    if (target == NULL) {
+        return VIGEM_ERROR_INVALID_TARGET;
+    }
+
+    ((STUB_TARGET *)target)->added = 1;
+    return VIGEM_ERROR_NONE;
+}
+
+VIGEM_STUB_API unsigned int vigem_target_remove(void * vigem, void * target)
+{
+    (void)vigem;
+
+    if (target == NULL) {
+        return VIGEM_ERROR_INVALID_TARGET;
+    }
+
+    ((STUB_TARGET *)target)->added = 0;
+    return VIGEM_ERROR_NONE;
+}
+
+VIGEM_STUB_API unsigned int vigem_target_x360_update(void * vigem, void * target, VIGEM_STUB_REPORT report)
+{
+    STUB_CLIENT * client = (STUB_CLIENT *)vigem;
+    uint64_t now = vigem_stub_get_time_us();
+
+    if (client == NULL || !client->connected) {
+        return VIGEM_ERROR_BUS_INVALID_HANDLE;
+    }
+    if (target == NULL || !((STUB_TARGET *)target)->added) {
+        return VIGEM_ERROR_INVALID_TARGET;
+    }
+
+    LOCK();
+    if (updateCount < VIGEM_STUB_MAX_UPDATES) {
+        updates[updateCount].timeUs = now;
+        updates[updateCount].report = report;
+    }
+    updateCount++;
+    UNLOCK();
+
+    return VIGEM_ERROR_NONE;
+}
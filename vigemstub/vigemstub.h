@@ -0,0 +1,58 @@
+#ifndef VIGEMSTUB_H
+#define VIGEMSTUB_H
+
+/*
+ * A stand-in for ViGEmClient.dll that needs no bus driver. It exports the
+ * subset of the ViGEmClient API that VigemClient resolves, accepts every
+ * call, and records each vigem_target_x360_update() with the time it
+ * arrived. Tests load it in place of the real library and inspect the
+ * recorded updates with the functions below.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _WIN32
+#define VIGEM_STUB_API __declspec(dllexport)
+#else
+#define VIGEM_STUB_API __attribute__((visibility("default")))
+#endif
+
+/* Same layout as XUSB_REPORT */
+typedef struct _VIGEM_STUB_REPORT {
+    unsigned short wButtons;
+    unsigned char bLeftTrigger;
+    unsigned char bRightTrigger;
+    short sThumbLX;
+    short sThumbLY;
+    short sThumbRX;
+    short sThumbRY;
+} VIGEM_STUB_REPORT;
+
+typedef struct _VIGEM_STUB_UPDATE {
+    /* Monotonic time the update arrived */
+    uint64_t timeUs;
+    VIGEM_STUB_REPORT report;
+} VIGEM_STUB_UPDATE;
+
+/* Updates beyond this many are counted but not recorded */
+#define VIGEM_STUB_MAX_UPDATES 4096
+
+/* Forgets all recorded updates */
+VIGEM_STUB_API void vigem_stub_reset(void);
+
+/* Copies up to maxUpdates recorded updates and returns the total number of
+ * updates received since the last reset */
+VIGEM_STUB_API int vigem_stub_get_updates(VIGEM_STUB_UPDATE * updates, int maxUpdates);
+
+/* The current monotonic time on the clock updates are stamped with */
+VIGEM_STUB_API uint64_t vigem_stub_get_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VIGEMSTUB_H
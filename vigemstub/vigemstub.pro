@@ -0,0 +1,22 @@
+QT       -= core gui
+
+TARGET = ViGEmClientStub
+TEMPLATE = lib
+
+# Include global qmake defs
+include(../globaldefs.pri)
+
+# Older GCC versions defaulted to GNU89
+*-g++ {
+    QMAKE_CFLAGS += -std=gnu99
+}
+
+unix {
+    LIBS += -lpthread
+}
+
+SOURCES += \
+    vigemstub.c
+
+HEADERS += \
+    vigemstub.h
@@ -0,0 +1,188 @@
+/*
+ * Drives VigemClient and its report sender against the ViGEm stub library
+ * and checks the batching and rate behaviour of the reports that reach the
+ * "driver". Returns non-zero on failure.
+ *
+ * Usage: vigemtest [path to ViGEmClientStub]
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLibrary>
+#include <QThread>
+#include <QVector>
+
+#include <cstdio>
+
+#include "vigemclient.h"
+#include "vigemstub.h"
+
+/* Must match VIGEM_REPORT_INTERVAL_NS in vigemreportsender.cpp */
+#define REPORT_INTERVAL_US 4000
+
+/* The sender should hold its cadence to within this on any platform.
+ * Sleeping on the 15.6 ms Windows system tick would blow through it. */
+#define MAX_MEAN_INTERVAL_US 6000
+
+typedef void (*StubResetFunction)();
+typedef int (*StubGetUpdatesFunction)(VIGEM_STUB_UPDATE *, int);
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "FAILED: " __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static StubResetFunction stubReset;
+static StubGetUpdatesFunction stubGetUpdates;
+
+static int count(const QVector<VIGEM_STUB_UPDATE> & updates)
+{
+    return (int) updates.size();
+}
+
+static QVector<VIGEM_STUB_UPDATE> getUpdates()
+{
+    QVector<VIGEM_STUB_UPDATE> updates(VIGEM_STUB_MAX_UPDATES);
+    int received = stubGetUpdates(updates.data(), VIGEM_STUB_MAX_UPDATES);
+
+    updates.resize(qMin(received, (int) VIGEM_STUB_MAX_UPDATES));
+    return updates;
+}
+
+/* QThread::usleep() is too coarse on Windows to drive the sender faster than it sends */
+static void spinFor(qint64 us)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+    while (timer.nsecsElapsed() < us * 1000);
+}
+
+/* The report rate never exceeds one per interval, give or take a late wakeup */
+static void checkRate(const char * name, const QVector<VIGEM_STUB_UPDATE> & updates)
+{
+    if (count(updates) < 2) {
+        return;
+    }
+
+    quint64 spanUs = updates.last().timeUs - updates.first().timeUs;
+    CHECK((quint64) (count(updates) - 1) * REPORT_INTERVAL_US <= spanUs + REPORT_INTERVAL_US,
+          "%s: %d reports in %llu us exceeds one per %d us",
+          name, count(updates), (unsigned long long) spanUs, REPORT_INTERVAL_US);
+}
+
+/* Tapping a button many times between two reports coalesces into a
+ * press followed by a release, rather than one report per edge */
+static void testBurst(Vigem::VigemClient & client)
+{
+    QElapsedTimer timer;
+
+    /* Let the previous report's interval expire */
+    QThread::msleep(20);
+    stubReset();
+
+    timer.start();
+    for (int i = 0; i < 1000; i++) {
+        client.pressA();
+        client.releaseA();
+    }
+    qint64 burstUs = timer.nsecsElapsed() / 1000;
+
+    QThread::msleep(50);
+
+    QVector<VIGEM_STUB_UPDATE> updates = getUpdates();
+    int maxReports = 2 + (int) (burstUs / REPORT_INTERVAL_US) + 1;
+
+    CHECK(count(updates) >= 2, "burst: expected a press and a release, got %d reports", count(updates));
+    CHECK(count(updates) <= maxReports, "burst: 2000 edges in %lld us produced %d reports, expected at most %d",
+          (long long) burstUs, count(updates), maxReports);
+    if (!updates.isEmpty()) {
+        CHECK(updates.first().report.wButtons & Vigem::VigemClient::GamepadA, "burst: the tap was never reported");
+        CHECK(updates.last().report.wButtons == 0, "burst: A is still reported held");
+    }
+
+    checkRate("burst", updates);
+}
+
+/* A stream of changes faster than the poll interval is sent once per
+ * interval, on a steady cadence, and the final state always arrives */
+static void testSteadyRate(Vigem::VigemClient & client)
+{
+    QThread::msleep(20);
+    stubReset();
+
+    /* Toggle a different button every 500 us for half a second */
+    for (int i = 0; i < 1000; i++) {
+        if (i & 1) {
+            client.releaseB();
+            client.pressX();
+        }
+        else {
+            client.releaseX();
+            client.pressB();
+        }
+        spinFor(500);
+    }
+    client.releaseB();
+    client.releaseX();
+
+    QThread::msleep(50);
+
+    QVector<VIGEM_STUB_UPDATE> updates = getUpdates();
+
+    CHECK(count(updates) >= 2, "steady: only %d reports", count(updates));
+    if (count(updates) >= 2) {
+        quint64 spanUs = updates.last().timeUs - updates.first().timeUs;
+        quint64 meanUs = spanUs / (count(updates) - 1);
+
+        CHECK(meanUs <= MAX_MEAN_INTERVAL_US, "steady: mean report interval %llu us, expected at most %d us",
+              (unsigned long long) meanUs, MAX_MEAN_INTERVAL_US);
+        CHECK(updates.last().report.wButtons == 0, "steady: final release was not reported");
+
+        printf("steady: %d reports, mean interval %llu us\n", count(updates), (unsigned long long) meanUs);
+    }
+
+    checkRate("steady", updates);
+}
+
+int main(int argc, char * argv[])
+{
+    QCoreApplication app(argc, argv);
+    QString path = argc > 1 ? QString::fromLocal8Bit(argv[1]) : QString(VIGEM_STUB_PATH);
+
+    QLibrary stub(path);
+    if (!stub.load()) {
+        fprintf(stderr, "Unable to load %s: %s\n", qPrintable(path), qPrintable(stub.errorString()));
+        return 1;
+    }
+
+    stubReset = (StubResetFunction) stub.resolve("vigem_stub_reset");
+    stubGetUpdates = (StubGetUpdatesFunction) stub.resolve("vigem_stub_get_updates");
+    if (!stubReset || !stubGetUpdates) {
+        fprintf(stderr, "%s is not the ViGEm stub library\n", qPrintable(path));
+        return 1;
+    }
+
+    Vigem::VigemClient client(path);
+    if (!client.loadLibrary() || !client.startup("x360")) {
+        fprintf(stderr, "Unable to start the ViGEm client on the stub\n");
+        return 1;
+    }
+
+    testBurst(client);
+    testSteadyRate(client);
+
+    client.shutdown();
+
+    if (failures == 0) {
+        printf("All tests passed\n");
+    }
+
+    return failures != 0 ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+QT += core gui
+
+TARGET = vigemtest
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+# Include global qmake defs
+include(../globaldefs.pri)
+
+INCLUDEPATH += \
+    $$PWD/../app/vigem \
+    $$PWD/../vigemstub
+
+# The test loads the stub at runtime, just like the app loads ViGEmClient.dll
+win32:CONFIG(release, debug|release): DEFINES += VIGEM_STUB_PATH=\\\"$$OUT_PWD/../vigemstub/release/ViGEmClientStub\\\"
+else:win32:CONFIG(debug, debug|release): DEFINES += VIGEM_STUB_PATH=\\\"$$OUT_PWD/../vigemstub/debug/ViGEmClientStub\\\"
+else: DEFINES += VIGEM_STUB_PATH=\\\"$$OUT_PWD/../vigemstub/ViGEmClientStub\\\"
+
+win32 {
+    LIBS += -lwinmm
+}
+
+SOURCES += \
+    main.cpp \
+    ../app/vigem/vigemclient.cpp \
+    ../app/vigem/vigemkeymapper.cpp \
+    ../app/vigem/vigemreportsender.cpp
+
+HEADERS += \
+    ../app/vigem/vigem_defs.h \
+    ../app/vigem/vigemclient.h \
+    ../app/vigem/vigemkeymapper.h \
+    ../app/vigem/vigemreportsender.h